@@ -45,7 +45,8 @@ typedef enum e_AntiAliasingMethod {
 	AAM_NONE = 0, /*!< No anti-aliasing.*/
 	AAM_GAUSSIANBLUR, /*!< Gaussian Blur.*/
 	AAM_OVERSAMPLING, /*!< Over sampling (compute a bigger image and scale it down).*/
-	AAM_ADAPTIVE /*!< Adaptive (compute more than one value for some pixels).*/
+	AAM_ADAPTIVE, /*!< Adaptive (compute more than one value for some pixels).*/
+	AAM_VARIANCE /*!< Adaptive, with number of values per pixel driven by their variance.*/
 } AntiAliasingMethod;
 
 /**
@@ -76,6 +77,7 @@ extern const char *AntiAliasingMethodDescStr[];
  * - "blur" for AAM_GAUSSIANBLUR
  * - "oversampling" for AAM_OVERSAMPLING
  * - "adaptive" for AAM_ADAPTIVE
+ * - "variance" for AAM_VARIANCE
  * Exit with error in case of failure.
  *
  * \param str String specifying anti-aliasing method.
@@ -36,6 +36,29 @@
 extern "C" {
 #endif
 
+/**
+ * \struct OutputSpec
+ * \brief Additional output image.
+ *
+ * Additional outputs are colorized from the fractal values computed
+ * for the main image, with their own rendering parameters or gradient,
+ * and possibly downscaled.
+ */
+/**
+ * \typedef OutputSpec
+ * \brief Convenient typedef for struct OutputSpec.
+ */
+typedef struct OutputSpec {
+	char *dstFileName;
+ /*!< Output image file name.*/
+	char *renderingFileName;
+ /*!< Rendering or gradient file name (NULL to keep rendering parameters of main image).*/
+	uint_fast32_t width;
+ /*!< Width of output image (0 for width of main image).*/
+	uint_fast32_t height;
+ /*!< Height of output image (0 for height of main image).*/
+} OutputSpec;
+
 /**
  * \struct CommandLineArguments
  * \brief For storing command lines arguments.
@@ -55,8 +78,14 @@ typedef struct CommandLineArguments {
  /*!< Rendering file name.*/
 	char *gradientFileName;
  /*!< Gradient file name.*/
+	char *cacheFileName;
+ /*!< Fractal cache file name (NULL if no cache file is to be used).*/
 	char *dstFileName;
- /*!< Output image file name.*/
+ /*!< Output image file name (may be NULL if there are additional outputs).*/
+	uint_fast32_t nbOutputs;
+ /*!< Number of additional outputs.*/
+	OutputSpec *outputs;
+ /*!< Additional outputs.*/
 	uint_fast32_t width;
  /*!< Width of output float table/image.*/
 	uint_fast32_t height;
@@ -70,11 +99,18 @@ typedef struct CommandLineArguments {
 	AntiAliasingMethod antiAliasingMethod;
  /*!< Anti-aliasing method.*/
 	double antiAliasingSize;
- /*!< Size for anti-aliasing (radius for blur, factor for oversampling and adaptive).*/
+ /*!< Size for anti-aliasing (radius for blur, factor for oversampling and adaptive,
+  maximum factor for variance-driven adaptive).*/
 	double adaptiveAAMThreshold;
  /*!< Threshold used when anti-aliasing method is adaptive.*/
+	double adaptiveAAMNoiseThreshold;
+ /*!< Noise threshold used when anti-aliasing method is variance-driven adaptive.*/
 	FloatPrecision floatPrecision;
  /*!< Float precision.*/
+	int autoMaxIter;
+ /*!< 1 if maximum number of iterations is to be chosen automatically.*/
+	uint_fast32_t bandHeight;
+ /*!< Height of bands image is rendered and written by (0 to render whole image at once).*/
 #ifdef _ENABLE_MP_FLOATS
 	int64_t MPFloatPrecision;
  /*!< Precision (value) of Multiple Precision floats.*/
@@ -91,6 +127,14 @@ typedef struct CommandLineArguments {
  */
 void ParseCommandLineArguments(CommandLineArguments *dst, int argc, char *argv[]);
 
+/**
+ * \fn void FreeCommandLineArguments(CommandLineArguments *arg)
+ * \brief Free command line arguments.
+ *
+ * \param arg Pointer to command line arguments structure to free.
+ */
+void FreeCommandLineArguments(CommandLineArguments *arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,14 +27,16 @@ const char *AntiAliasingMethodStr[] = {
 	(char *)"none",
 	(char *)"blur",
 	(char *)"oversampling",
-	(char *)"adaptive"
+	(char *)"adaptive",
+	(char *)"variance"
 };
 
 const char *AntiAliasingMethodDescStr[] = {
 	(char *)"None",
 	(char *)"Gaussian blur",
 	(char *)"Oversampling",
-	(char *)"Adaptive"
+	(char *)"Adaptive",
+	(char *)"Variance-driven adaptive"
 };
 
 uint_fast32_t nbAntiAliasingMethods = sizeof(AntiAliasingMethodStr) / sizeof(char *);
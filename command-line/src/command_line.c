@@ -37,6 +37,43 @@ int FileExists(const char *fileName)
 	return res;
 }
 
+/* Parse output spec of the form <Output>[,[<RenderingOrGradientFile>][,<Width>x<Height>]].
+ * Spec string is split in place.
+ */
+static void ParseOutputSpec(OutputSpec *dst, char *spec)
+{
+	dst->dstFileName = spec;
+	dst->renderingFileName = NULL;
+	dst->width = 0;
+	dst->height = 0;
+
+	char *field = strchr(spec, ',');
+	if (field != NULL) {
+		*field++ = '\0';
+		char *size = strchr(field, ',');
+		if (size != NULL) {
+			*size++ = '\0';
+			int64_t width, height;
+			char unused;
+			if (sscanf(size, "%"SCNd64"x%"SCNd64"%c", &width, &height, &unused) != 2) {
+				invalid_use_error("Output size \'%s\' is not of the form \
+<Width>x<Height>.\n", size);
+			}
+			if (width < 2 || height < 2) {
+				invalid_use_error("Output image width and height must be >= 2.\n");
+			}
+			dst->width = (uint_fast32_t)width;
+			dst->height = (uint_fast32_t)height;
+		}
+		if (*field != '\0') {
+			dst->renderingFileName = field;
+		}
+	}
+	if (*dst->dstFileName == '\0') {
+		invalid_use_error("No output file name in output \'%s\'.\n", spec);
+	}
+}
+
 void ParseCommandLineArguments(CommandLineArguments *dst, int argc, char *argv[])
 {
 	FractalNow_traceLevel = T_NORMAL;
@@ -52,12 +89,18 @@ void ParseCommandLineArguments(CommandLineArguments *dst, int argc, char *argv[]
 	dst->fractalFileName = NULL;
 	dst->renderingFileName = NULL;
 	dst->gradientFileName = NULL;
+	dst->cacheFileName = NULL;
 	dst->dstFileName = NULL;
+	dst->nbOutputs = 0;
+	dst->outputs = NULL;
 	dst->antiAliasingMethod = AAM_NONE;
 	dst->antiAliasingSize = -1;
 	dst->adaptiveAAMThreshold = -1;
+	dst->adaptiveAAMNoiseThreshold = -1;
 	dst->nbThreads = -1;
 	dst->floatPrecision = FP_DOUBLE;
+	dst->autoMaxIter = 0;
+	dst->bandHeight = 0;
 #ifdef _ENABLE_MP_FLOATS
 	dst->MPFloatPrecision = DEFAULT_MP_PRECISION;
 #endif
@@ -66,7 +109,7 @@ void ParseCommandLineArguments(CommandLineArguments *dst, int argc, char *argv[]
 	dst->width = 0;
 	dst->height = 0;
 	int o;
-	while ((o = getopt(argc, argv, "hqvda:c:f:g:i:j:l:L:o:p:r:s:t:x:y:")) != -1) {
+	while ((o = getopt(argc, argv, "hqvdma:b:c:f:g:i:j:k:l:L:n:o:O:p:r:s:t:x:y:")) != -1) {
 		switch (o) {
 		case 'h':
 			help = 1;
@@ -91,9 +134,22 @@ debug mode.\n");
 			FractalNow_debug = 1;
 #endif
 			break;
+		case 'm':
+			dst->autoMaxIter = 1;
+			break;
 		case 'a':
 			dst->antiAliasingMethod = GetAAM(optarg);
 			break;
+		case 'b':
+			if (sscanf(optarg, "%"SCNd64, &tmp) < 1) {
+				invalid_use_error("Command-line argument \'%s\' is not a number.\n", optarg);
+			}
+			if (tmp <= 0) {
+				invalid_use_error("Band height must be positive.\n");
+			} else {
+				dst->bandHeight = (uint_fast32_t)tmp;
+			}
+			break;
 		case 'c':
 			dst->fractalConfigFileName = optarg;
 			break;
@@ -106,6 +162,9 @@ debug mode.\n");
 		case 'g':
 			dst->gradientFileName = optarg;
 			break;
+		case 'k':
+			dst->cacheFileName = optarg;
+			break;
 		case 'l':
 			if (GetFloatPrecision(&dst->floatPrecision, optarg)) {
 				invalid_use_error("\n");
@@ -146,6 +205,11 @@ debug mode.\n");
 		case 'o':
 			dst->dstFileName = optarg;
 			break;
+		case 'O':
+			dst->outputs = (OutputSpec *)safeRealloc("outputs", dst->outputs,
+						(dst->nbOutputs+1) * sizeof(OutputSpec));
+			ParseOutputSpec(&dst->outputs[dst->nbOutputs++], optarg);
+			break;
 		case 'p':
 			if (sscanf(optarg, "%lf", &dst->adaptiveAAMThreshold) < 1) {
 				invalid_use_error("Command-line argument \'%s\' is not a floating-point number.\n", optarg);
@@ -154,6 +218,14 @@ debug mode.\n");
 				invalid_use_error("Adaptive anti-aliasing threshold must be >= 0.\n");
 			} 
 			break;
+		case 'n':
+			if (sscanf(optarg, "%lf", &dst->adaptiveAAMNoiseThreshold) < 1) {
+				invalid_use_error("Command-line argument \'%s\' is not a floating-point number.\n", optarg);
+			}
+			if (dst->adaptiveAAMNoiseThreshold <= 0.) {
+				invalid_use_error("Adaptive anti-aliasing noise threshold must be > 0.\n");
+			} 
+			break;
 		case 's':
 			if (sscanf(optarg, "%lf", &dst->antiAliasingSize) < 1) {
 				invalid_use_error("Command-line argument \'%s\' is not a floating-point number.\n", optarg);
@@ -214,14 +286,23 @@ debug mode.\n");
 		}
 	}
 
-	if (dst->dstFileName == NULL) {
+	if (dst->dstFileName == NULL && dst->nbOutputs == 0) {
 		invalid_use_error("No output file specified.\n");
 	}
 
+	if (dst->bandHeight != 0 && dst->nbOutputs > 0) {
+		invalid_use_error("Additional outputs ('-O') cannot be rendered by bands ('-b').\n");
+	}
+
 	if (!widthSpecified && !heightSpecified) {
 		invalid_use_error("At least width or height must be specified.\n");
 	}
 
+	if (dst->antiAliasingMethod != AAM_VARIANCE && dst->adaptiveAAMNoiseThreshold != -1) {
+		invalid_use_error("No adaptive anti-aliasing noise threshold ('-n') should be \
+specified when anti-aliasing method is not variance.\n");
+	}
+
 	switch (dst->antiAliasingMethod) {
 	case AAM_NONE:
 		if (dst->antiAliasingSize != -1) {
@@ -272,6 +353,28 @@ must be > 1.\n");
 			dst->adaptiveAAMThreshold = DEFAULT_ADAPTIVE_AAM_THRESHOLD;
 		}
 
+		break;
+	case AAM_VARIANCE:
+		if (dst->antiAliasingSize == -1) {
+			invalid_use_error("No size parameter ('-s') specified for variance-driven \
+adaptive anti-aliasing.\n");
+		}
+		if (modf(dst->antiAliasingSize, &unused) != 0) {
+			invalid_use_error("Size parameter ('-s') for variance-driven adaptive \
+anti-aliasing should be an integer.\n");
+		}
+		if (dst->antiAliasingSize <= 1.) {
+			invalid_use_error("Size parameter ('-s') for variance-driven adaptive \
+anti-aliasing must be > 1.\n");
+		}
+
+		if (dst->adaptiveAAMThreshold == -1) {
+			dst->adaptiveAAMThreshold = DEFAULT_ADAPTIVE_AAM_THRESHOLD;
+		}
+		if (dst->adaptiveAAMNoiseThreshold == -1) {
+			dst->adaptiveAAMNoiseThreshold = DEFAULT_ADAPTIVE_AAM_NOISE_THRESHOLD;
+		}
+
 		break;
 	default:
 		invalid_use_error("Unknown anti-aliasing method.\n");
@@ -293,5 +396,17 @@ must be > 1.\n");
 	if (dst->gradientFileName != NULL && !FileExists(dst->gradientFileName)) {
 		FractalNow_existence_error(dst->gradientFileName);
 	}
+
+	for (uint_fast32_t i = 0; i < dst->nbOutputs; ++i) {
+		char *fileName = dst->outputs[i].renderingFileName;
+		if (fileName != NULL && !FileExists(fileName)) {
+			FractalNow_existence_error(fileName);
+		}
+	}
+}
+
+void FreeCommandLineArguments(CommandLineArguments *arg)
+{
+	free(arg->outputs);
 }
 
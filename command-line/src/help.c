@@ -36,6 +36,9 @@ fractalnow [OPTIONS] -c <Config> [-x <Width>|-y <Height>] -o \
 fractalnow [OPTIONS] -f <Fractal> -r <Rendering> [-x <Width>\
 |-y <Height>] -o <Output>\n\
 \n\
+Output ('-o') may be omitted if additional outputs ('-O') are \
+specified.\n\
+\n\
 OPTIONS:\n"
 #ifdef DEBUG
 "  -d                       Debug mode.\n"
@@ -44,6 +47,24 @@ OPTIONS:\n"
 (%"PRIuFAST32" by default).\n\
   -g <GradientFile>        Specify gradient file, overriding \
 gradient from configuration/rendering file.\n\
+  -b <BandHeight>          Render and write output image by \
+bands of given height, so that memory used does not depend on \
+image height.\n\
+  -k <CacheFile>           Specify fractal cache file (written by \
+the explorer) to take already computed values from.\n\
+                           File is only read, and is ignored \
+if it was made for another fractal or rendering parameters.\n\
+  -m                       Choose maximum number of iterations \
+automatically, from a low-resolution probe.\n\
+                           Maximum number of iterations of \
+fractal is used as an upper bound.\n\
+  -O <Output>[,[<RenderingOrGradientFile>][,<Width>x<Height>]]\n\
+                           Add output image, colorized with \
+another rendering or gradient file, and possibly downscaled.\n\
+                           Can be repeated. Fractal is computed \
+only once for all outputs.\n\
+                           Rendering files must only differ \
+from main rendering parameters by their colors.\n\
   -x <Width>               Specify output image width.\n\
   -y <Height>              Specify output image height.\n\
   -l <FloatType>           Specify float type:\n\
@@ -65,6 +86,8 @@ Precision (MP) floats (%"PRId64" by default).\n"
                                oversampling\n\
                                adaptive      Smart oversampling.\
 \n\
+                               variance      Smart oversampling, \
+with number of samples per pixel driven by their variance.\n\
   -s <AAMSize>             Specify size for anti-aliasing:\n\
                                Radius for blur (values in \
 [2.5, 4] are generally good).\n\
@@ -72,8 +95,14 @@ Precision (MP) floats (%"PRId64" by default).\n"
 , 5] is good for a high quality image).\n\
                                Scale factor for adaptive (\
 integers between 3-5 are good for a high quality image).\n\
+                               Maximum scale factor for \
+variance (integers between 4-8 are good for a high quality image).\n\
   -p <AAMThreshold>        Threshold for adaptive \
 anti-aliasing (%G by default).\n\
+  -n <AAMNoise>            Noise threshold for variance \
+anti-aliasing (%G by default).\n\
+                           Samples of a pixel are computed \
+until noise of its value is below that threshold.\n\
   -i <QuadSize>            Maximum size of quadrilaterals for \
 linear interpolation.\n\
                            %"PRIuFAST32" by default, which is \
@@ -93,6 +122,7 @@ as opposed to interpolated.\n",
 	DEFAULT_MP_PRECISION,
 #endif
 	DEFAULT_ADAPTIVE_AAM_THRESHOLD,
+	DEFAULT_ADAPTIVE_AAM_NOISE_THRESHOLD,
 	DEFAULT_QUAD_INTERPOLATION_SIZE,
 	DEFAULT_COLOR_DISSIMILARITY_THRESHOLD);
 }
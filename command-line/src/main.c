@@ -27,6 +27,245 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+/* Get rendering parameters of additional output: those of main image,
+ * with gradient or rendering parameters read from output rendering file.
+ */
+static RenderingParameters GetOutputRenderingParameters(const OutputSpec *output,
+						const RenderingParameters *render)
+{
+	RenderingParameters res;
+	const char *fileName = output->renderingFileName;
+	if (fileName == NULL) {
+		res = CopyRenderingParameters(render);
+	} else if (isSupportedGradientFile(fileName)) {
+		Gradient gradient;
+		if (ReadGradientFile(&gradient, fileName)) {
+			FractalNow_error("Failed to read gradient file.\n");
+		}
+		res = CopyRenderingParameters(render);
+		ResetGradient(&res, gradient);
+		FreeGradient(gradient);
+	} else {
+		if (ReadRenderingFile(&res, fileName)) {
+			FractalNow_error("Failed to read rendering file.\n");
+		}
+		/* Fractal values are computed only once. */
+		if (res.coloringMethod != render->coloringMethod ||
+			res.iterationCount != render->iterationCount ||
+			(res.coloringMethod == CM_AVERAGECOLORING &&
+			(res.addendFunction != render->addendFunction ||
+			res.stripeDensity != render->stripeDensity ||
+			res.interpolationMethod != render->interpolationMethod))) {
+			FractalNow_error("Rendering file \'%s\' does not compute the same fractal \
+values as main rendering parameters.\n", fileName);
+		}
+	}
+
+	return res;
+}
+
+/* Colorize fractal values with output rendering parameters, then
+ * apply blur (if anti-aliasing method is blur) and downscale.
+ */
+static void RenderOutput(Image *dst, const ValueBuffer *values,
+				const RenderingParameters *render,
+				const CommandLineArguments *arg, Threads *threads)
+{
+	Image valuesImg, tmpImg;
+	CreateImage(&valuesImg, values->width, values->height, render->bytesPerComponent);
+	RecolorImage(&valuesImg, values, render, threads);
+
+	if (arg->antiAliasingMethod == AAM_GAUSSIANBLUR) {
+		CreateImage(&tmpImg, values->width, values->height, render->bytesPerComponent);
+		ApplyGaussianBlur(&tmpImg, &valuesImg, arg->antiAliasingSize, threads);
+		FreeImage(valuesImg);
+		valuesImg = tmpImg;
+	}
+	if (dst->width == valuesImg.width && dst->height == valuesImg.height) {
+		FreeImage(*dst);
+		*dst = valuesImg;
+	} else {
+		DownscaleImage(dst, &valuesImg, threads);
+		FreeImage(valuesImg);
+	}
+}
+
+/* Draw fractal image, and anti-aliase it with method specified on
+ * command line.
+ */
+static void DrawFractalImage(Image *dst, const Fractal *fractal,
+				const RenderingParameters *render,
+				const CommandLineArguments *arg, FractalCache *cache,
+				ValueBuffer *values, Threads *threads)
+{
+	Image tmpImg;
+
+	switch (arg->antiAliasingMethod) {
+	case AAM_NONE:
+		DrawFractal(dst, fractal, render, arg->quadInterpolationSize,
+			arg->colorDissimilarityThreshold, arg->floatPrecision, cache, values, threads);
+		break;
+	case AAM_GAUSSIANBLUR:
+		CreateImage(&tmpImg, dst->width, dst->height, render->bytesPerComponent);
+
+		DrawFractal(&tmpImg, fractal, render, arg->quadInterpolationSize,
+			arg->colorDissimilarityThreshold, arg->floatPrecision, cache, values, threads);
+		ApplyGaussianBlur(dst, &tmpImg, arg->antiAliasingSize, threads);
+
+		FreeImage(tmpImg);
+		break;
+	case AAM_OVERSAMPLING:
+		if (values == NULL) {
+			OversampleFractal(dst, fractal, render, arg->antiAliasingSize,
+				arg->quadInterpolationSize, arg->colorDissimilarityThreshold,
+				arg->floatPrecision, threads);
+		} else {
+			/* Values of the whole oversampled image are needed. */
+			CreateImage(&tmpImg, dst->width * arg->antiAliasingSize,
+					dst->height * arg->antiAliasingSize, render->bytesPerComponent);
+			DrawFractal(&tmpImg, fractal, render, arg->quadInterpolationSize,
+				arg->colorDissimilarityThreshold, arg->floatPrecision, cache,
+				values, threads);
+			DownscaleImage(dst, &tmpImg, threads);
+
+			FreeImage(tmpImg);
+		}
+		break;
+	case AAM_ADAPTIVE:
+		DrawFractal(dst, fractal, render, arg->quadInterpolationSize,
+			arg->colorDissimilarityThreshold, arg->floatPrecision, cache, values, threads);
+		AntiAliaseFractal(dst, fractal, render, arg->antiAliasingSize,
+			arg->adaptiveAAMThreshold, 0, arg->floatPrecision, cache, values, threads);
+		break;
+	case AAM_VARIANCE:
+		DrawFractal(dst, fractal, render, arg->quadInterpolationSize,
+			arg->colorDissimilarityThreshold, arg->floatPrecision, cache, values, threads);
+		AntiAliaseFractal(dst, fractal, render, arg->antiAliasingSize,
+			arg->adaptiveAAMThreshold, arg->adaptiveAAMNoiseThreshold,
+			arg->floatPrecision, cache, values, threads);
+		break;
+	default:
+		FractalNow_error("Unknown anti-aliasing method.\n");
+		break;
+	}
+}
+
+/* Number of rows that must be drawn above and below a band for its
+ * rows to be computed as those of the whole image : rows needed by
+ * blur, downscale (oversampling) and edge detection (adaptive).
+ * Pixel coordinates of a band are computed from band view though, and
+ * may be rounded differently from those of the whole image, so values
+ * may differ slightly (mostly in chaotic zones).
+ */
+static uint_fast32_t GetBandHalo(const CommandLineArguments *arg)
+{
+	uint_fast32_t res;
+	switch (arg->antiAliasingMethod) {
+	case AAM_NONE:
+		res = 0;
+		break;
+	case AAM_GAUSSIANBLUR:
+		/* Recursive gaussian blur has no bounded support: its tail
+		 * is negligible beyond twice the radius.
+		 */
+		res = (arg->antiAliasingSize < RECURSIVE_GAUSSIAN_BLUR_MIN_RADIUS) ?
+			ceil(arg->antiAliasingSize) : ceil(2*arg->antiAliasingSize);
+		break;
+	case AAM_OVERSAMPLING:
+	case AAM_ADAPTIVE:
+	case AAM_VARIANCE:
+		res = 1;
+		break;
+	default:
+		FractalNow_error("Unknown anti-aliasing method.\n");
+		break;
+	}
+
+	return res;
+}
+
+/* Drawn rows of a band start and end on multiples of quad size (or at
+ * image end), so that they are cut into the same quads as whole image:
+ * quads are aligned on a grid starting at first row of (oversampled)
+ * image, and tile size is a multiple of quad size.
+ */
+static uint_fast32_t GetBandAlignment(const CommandLineArguments *arg)
+{
+	return (arg->quadInterpolationSize == 0) ? 1 : arg->quadInterpolationSize;
+}
+
+/* Get fractal subset of rows y to y+nbRows-1 of image of given height. */
+static Fractal GetBandFractal(const Fractal *fractal, uint_fast32_t height,
+				uint_fast32_t y, uint_fast32_t nbRows)
+{
+	Fractal res = CopyFractal(fractal);
+	BiggestFloat tmp;
+	initBiggestF(tmp);
+
+	mul_uiBiggestF(tmp, fractal->spanY, y);
+	div_uiBiggestF(tmp, tmp, height);
+	addBiggestF(res.y1, fractal->y1, tmp);
+	mul_uiBiggestF(res.spanY, fractal->spanY, nbRows);
+	div_uiBiggestF(res.spanY, res.spanY, height);
+	div_uiBiggestF(tmp, res.spanY, 2);
+	addBiggestF(res.centerY, res.y1, tmp);
+
+	clearBiggestF(tmp);
+
+	return res;
+}
+
+/* Render image by bands, each band being written to output file as
+ * soon as it is finished, so that only one band is in memory.
+ */
+static void RenderBands(const char *fileName, uint_fast32_t width, uint_fast32_t height,
+			const Fractal *fractal, const RenderingParameters *render,
+			const CommandLineArguments *arg, FractalCache *cache, Threads *threads)
+{
+	PPMWriter writer;
+	if (OpenPPMWriter(&writer, fileName, width, height, render->bytesPerComponent)) {
+		FractalNow_error("Failed to export image as PPM.\n");
+	}
+
+	uint_fast32_t halo = GetBandHalo(arg);
+	uint_fast32_t alignment = GetBandAlignment(arg);
+	for (uint_fast32_t y = 0; y < height; y += arg->bandHeight) {
+		uint_fast32_t nbRows = (height-y < arg->bandHeight) ? height-y : arg->bandHeight;
+		/* Halo rows are drawn only inside image, as for whole image. */
+		uint_fast32_t y1 = (y < halo) ? 0 : y-halo;
+		uint_fast32_t y2 = (height-(y+nbRows) < halo) ? height : y+nbRows+halo;
+		y1 = (y1 / alignment) * alignment;
+		y2 = ((y2+alignment-1) / alignment) * alignment;
+		if (y2 > height) {
+			y2 = height;
+		}
+		/* An image of less than 2 rows is not drawn: make last band
+		 * start one alignment step earlier if it is only one row high.
+		 */
+		if (y2-y1 < 2 && y1 > 0) {
+			y1 -= alignment;
+		}
+
+		FractalNow_message(stdout, T_NORMAL, "Rendering rows %"PRIuFAST32" to %"
+					PRIuFAST32"...\n", y, y+nbRows-1);
+		Fractal bandFractal = GetBandFractal(fractal, height, y1, y2-y1);
+		Image bandImg;
+		CreateImage(&bandImg, width, y2-y1, render->bytesPerComponent);
+		DrawFractalImage(&bandImg, &bandFractal, render, arg, cache, NULL, threads);
+
+		if (WritePPMRows(&writer, &bandImg, y-y1, nbRows, threads)) {
+			ClosePPMWriter(&writer);
+			FractalNow_error("Failed to export image as PPM.\n");
+		}
+		FreeImage(bandImg);
+		FreeFractal(bandFractal);
+	}
+
+	if (ClosePPMWriter(&writer)) {
+		FractalNow_error("Failed to export image as PPM.\n");
+	}
+}
+
 int main(int argc, char *argv[]) {
 	setlocale(LC_NUMERIC, "C");
 
@@ -99,49 +338,94 @@ int main(int argc, char *argv[]) {
 	Threads *threads = CreateThreads((arg.nbThreads <= 0) ? DEFAULT_NB_THREADS :
 						(uint_fast32_t)arg.nbThreads);
 
-	Image fractalImg, tmpImg;
-	CreateImage(&fractalImg, width, height, render.bytesPerComponent);
+	if (arg.autoMaxIter) {
+		fractal.maxIter = GetAutoMaxIter(&fractal, &render, arg.floatPrecision, threads);
+		FractalNow_message(stdout, T_NORMAL, "Maximum number of iterations chosen : %"
+					PRIuFAST32".\n", fractal.maxIter);
+	}
 
-	switch (arg.antiAliasingMethod) {
-	case AAM_NONE:
-		DrawFractal(&fractalImg, &fractal, &render, arg.quadInterpolationSize,
-			arg.colorDissimilarityThreshold, arg.floatPrecision, NULL, threads);
-		break;
-	case AAM_GAUSSIANBLUR:
-		CreateImage(&tmpImg, width, height, render.bytesPerComponent);
-		
-		DrawFractal(&tmpImg, &fractal, &render, arg.quadInterpolationSize,
-			arg.colorDissimilarityThreshold, arg.floatPrecision, NULL, threads);
-		ApplyGaussianBlur(&fractalImg, &tmpImg, arg.antiAliasingSize, threads);
+	for (uint_fast32_t i = 0; i < arg.nbOutputs; ++i) {
+		if (arg.outputs[i].width > width || arg.outputs[i].height > height) {
+			FractalNow_error("Output image \'%s\' is bigger than main image.\n",
+						arg.outputs[i].dstFileName);
+		}
+	}
 
-		FreeImage(tmpImg);
-		break;
-	case AAM_OVERSAMPLING:
-		CreateImage(&tmpImg, width*arg.antiAliasingSize, height*arg.antiAliasingSize,
-				render.bytesPerComponent);
+	/* Fractal values are kept only if needed by additional outputs. */
+	ValueBuffer valueBuffer;
+	ValueBuffer *values = NULL;
+	if (arg.nbOutputs > 0) {
+		CreateValueBuffer(&valueBuffer, width, height);
+		values = &valueBuffer;
+	}
 
-		DrawFractal(&tmpImg, &fractal, &render, arg.quadInterpolationSize,
-			arg.colorDissimilarityThreshold, arg.floatPrecision, NULL, threads);
-		DownscaleImage(&fractalImg, &tmpImg, threads);
+	/* Cache file is only read: values computed here are not saved. */
+	FractalCache cache;
+	FractalCache *pCache = NULL;
+	if (arg.cacheFileName != NULL) {
+		if (CreateFractalCache(&cache, DEFAULT_FRACTAL_CACHE_SIZE)) {
+			FractalNow_error("Could not allocate memory for cache.\n");
+		}
+		if (ReadFractalCacheFile(&cache, arg.cacheFileName)) {
+			FractalNow_message(stderr, T_QUIET, "Failed to read cache file. \
+Rendering without cache.\n");
+			FreeFractalCache(&cache);
+		} else {
+			/* Values computed here would only evict entries read
+			 * from file before they are looked up.
+			 */
+			cache.readOnly = 1;
+			pCache = &cache;
+		}
+	}
 
-		FreeImage(tmpImg);
-		break;
-	case AAM_ADAPTIVE:
-		DrawFractal(&fractalImg, &fractal, &render, arg.quadInterpolationSize,
-			arg.colorDissimilarityThreshold, arg.floatPrecision, NULL, threads);
-		AntiAliaseFractal(&fractalImg, &fractal, &render, arg.antiAliasingSize,
-			arg.adaptiveAAMThreshold, arg.floatPrecision, NULL, threads);
-		break;
-	default:
-		FractalNow_error("Unknown anti-aliasing method.\n");
-		break;
+	if (arg.bandHeight == 0) {
+		Image fractalImg;
+		CreateImage(&fractalImg, width, height, render.bytesPerComponent);
+		DrawFractalImage(&fractalImg, &fractal, &render, &arg, pCache, values, threads);
+		if (values != NULL && arg.dstFileName != NULL) {
+			/* Main image is colorized from fractal values too, so that it
+			 * is the same as an additional output with the same rendering
+			 * parameters (interpolated pixels are colorized from their
+			 * interpolated value, instead of interpolated colors).
+			 */
+			RenderOutput(&fractalImg, values, &render, &arg, threads);
+		}
+
+		if (arg.dstFileName != NULL && ExportPPM(arg.dstFileName, &fractalImg, threads)) {
+			FractalNow_error("Failed to export image as PPM.\n");
+		}
+		FreeImage(fractalImg);
+	} else {
+		RenderBands(arg.dstFileName, width, height, &fractal, &render, &arg, pCache,
+				threads);
 	}
 
-	if (ExportPPM(arg.dstFileName, &fractalImg)) {
-		FractalNow_error("Failed to export image as PPM.\n");
+	for (uint_fast32_t i = 0; i < arg.nbOutputs; ++i) {
+		const OutputSpec *output = &arg.outputs[i];
+		RenderingParameters outputRender = GetOutputRenderingParameters(output, &render);
+
+		Image outputImg;
+		CreateImage(&outputImg, (output->width == 0) ? width : output->width,
+				(output->height == 0) ? height : output->height,
+				outputRender.bytesPerComponent);
+		RenderOutput(&outputImg, values, &outputRender, &arg, threads);
+		if (ExportPPM(output->dstFileName, &outputImg, threads)) {
+			FractalNow_error("Failed to export image as PPM.\n");
+		}
+
+		FreeImage(outputImg);
+		FreeRenderingParameters(outputRender);
+	}
+	if (values != NULL) {
+		FreeValueBuffer(values);
+	}
+
+	if (pCache != NULL) {
+		FreeFractalCache(pCache);
 	}
 	FreeFractalConfig(fractalConfig);
-	FreeImage(fractalImg);
+	FreeCommandLineArguments(&arg);
 	DestroyThreads(threads);
 
 	FractalNow_message(stdout, T_NORMAL, "All done.\n");
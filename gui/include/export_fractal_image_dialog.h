@@ -59,7 +59,8 @@ class ExportFractalImageDialog : public QDialog
 		AAM_NONE = 0,
 		AAM_GAUSSIANBLUR,
 		AAM_OVERSAMPLING,
-		AAM_ADAPTIVE
+		AAM_ADAPTIVE,
+		AAM_VARIANCE
 	};
 	AntiAliasingMethod getAntiAliasingMethod() const;
 
@@ -77,6 +78,9 @@ class ExportFractalImageDialog : public QDialog
 	QDoubleSpinBox *blurRadiusBox;
 	QRadioButton *adaptiveAAMButton;
 	QSpinBox *adaptiveSizeBox;
+	QRadioButton *varianceAAMButton;
+	QSpinBox *varianceSizeBox;
+	QDoubleSpinBox *varianceNoiseBox;
 	QRadioButton *oversamplingAAMButton;
 	QDoubleSpinBox *oversamplingSizeBox;
 	QSpinBox *imageWidthBox;
@@ -89,6 +93,7 @@ class ExportFractalImageDialog : public QDialog
 	void onAAMNoneToggled(bool);
 	void onAAMBlurToggled(bool);
 	void onAAMAdaptiveToggled(bool);
+	void onAAMVarianceToggled(bool);
 	void onAAMOversamplingToggled(bool);
 	void exportImage();
 };
@@ -36,6 +36,7 @@
 #include <mpc.h>
 
 #include <QAction>
+#include <QElapsedTimer>
 #include <QFutureWatcher>
 #include <QImage>
 #include <QLabel>
@@ -61,9 +62,14 @@ class FractalExplorer : public QLabel
 	const RenderingParameters &getRender() const;
 	bool getFractalCacheEnabled() const;
 	int getFractalCacheSize() const;
+	int loadFractalCache(const QString &fileName);
+	int saveFractalCache(const QString &fileName);
 	bool getSolidGuessingEnabled() const;
+	int getInteractionIdleDelay() const;
+	int getInteractionMaxIterations() const;
 	void launchFractalDrawing();
 	void launchFractalAntiAliasing();
+	void launchFractalRecoloring();
 	void resizeImage(uint_fast32_t width, uint_fast32_t height);
 	QSize sizeHint() const;
 	~FractalExplorer();
@@ -94,6 +100,8 @@ class FractalExplorer : public QLabel
 	void useFractalCache(bool enabled);
 	void resizeFractalCache(int size);
 	void setSolidGuessingEnabled(bool enabled);
+	void setInteractionIdleDelay(int delay);
+	void setInteractionMaxIterations(int maxIter);
 
 	void setFractalFormula(int index);
 	void setPParam(const mpc_t *value);
@@ -136,6 +144,12 @@ class FractalExplorer : public QLabel
 	void adjustSpan();
 	void reInitFractal();
 	void reInitRenderingParameters();
+	void resetFocus();
+	void setDrawnRectAfterMove(const QRect &previousDrawnRect, qreal dx, qreal dy);
+	void recolor();
+	void startInteraction();
+	void launchInteractionDrawing();
+	void upscaleInteractionImage();
 	void moveFractal(const mpfr_t dx, const mpfr_t dy, bool emitFractalChanged = false);
 	void zoomInFractal(const mpfr_t newSpanX, const mpfr_t zoomCenterX,
 			const mpfr_t zoomCenterY, bool emitFractalChanged = false);
@@ -144,7 +158,10 @@ class FractalExplorer : public QLabel
 
 	enum ActionType {
 		A_FractalDrawing = 0,
-		A_FractalAntiAliasing
+		A_FractalAntiAliasing,
+		A_FractalRecoloring,
+		A_FractalInteractionDrawing,
+		A_FractalInteractionDone
 	};
 	enum ActionType lastActionType;
 	bool drawingPaused;
@@ -156,6 +173,10 @@ class FractalExplorer : public QLabel
 	mpfr_t fractalCenterXOnPress, fractalCenterYOnPress;
 	QPointF prevMousePos;
 	QPointF mousePosOnPress;
+	QPointF focusPos; // Point of the image that is drawn first
+	QRect drawnRect; // Part of the image that is drawn for current fractal
+	QRect drawnRectOnPress;
+	QPointF dragOffset;
 	QImage imageCopyOnPress;
 
 	uint_fast32_t initialWidth, initialHeight;
@@ -169,17 +190,42 @@ class FractalExplorer : public QLabel
 	bool solidGuessing;
 	FractalCache cache;
 	FractalCache *pCache;
+	/* Tiles of views already drawn (restored when going back to them). */
+	TileCache tileCache;
 	uint_fast32_t minAntiAliasingSize;
 	uint_fast32_t maxAntiAliasingSize;
 	uint_fast32_t antiAliasingSizeIteration;
+	AntiAliasingAccumulator antiAliasingAccumulator;
+	/* Fractal values of drawn image, so that it can be recolored
+	 * without being redrawn.
+	 */
+	ValueBuffer valueBuffer;
+	bool valuesValid; // Value buffer matches current fractal
+	bool pendingValuesValid; // Value buffer will match once drawing is finished
+	/* Orbits of pixels not escaped yet, so that increasing maximum
+	 * number of iterations does not compute image from scratch.
+	 */
+	OrbitBuffer orbitBuffer;
 	Threads *threads;
 	QImage *fractalQImage;
 	Image fractalImage;
 	Task *task;
 	QTimer *timer;
 
+	/* Reduced quality drawing while interacting. */
+	bool interacting;
+	QTimer *interactionTimer;
+	int interactionIdleDelay;
+	int interactionMaxIterations;
+	uint_fast32_t interactionScale;
+	QElapsedTimer interactionFrameTime;
+	Fractal interactionFractal;
+	QImage *interactionQImage;
+	Image interactionImage;
+
 	private slots:
 	void onTimeout();
+	void onInteractionIdle();
 
 	signals:
 	void wakeUpSignal();
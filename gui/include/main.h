@@ -42,6 +42,29 @@
 //! Default anti-aliasing size iteration.
 #define DEFAULT_ANTIALIASING_SIZE_ITERATION (uint_fast32_t)(2)
 
+/* While the fractal is being moved or zoomed with the mouse, it is drawn
+ * at reduced resolution, so that frames are drawn in the given time range.
+ * Full quality drawing starts once input has been idle for some time.
+ */
+
+//! Default delay (in ms) after last input before drawing at full quality.
+#define DEFAULT_INTERACTION_IDLE_DELAY (int)(250)
+
+//! Default maximum number of iterations while interacting (0 for no limit).
+#define DEFAULT_INTERACTION_MAX_ITERATIONS (int)(0)
+
+//! Minimum resolution divisor while interacting.
+#define MIN_INTERACTION_SCALE (uint_fast32_t)(2)
+
+//! Maximum resolution divisor while interacting.
+#define MAX_INTERACTION_SCALE (uint_fast32_t)(4)
+
+//! Frame time (in ms) under which resolution is increased while interacting.
+#define MIN_INTERACTION_FRAME_TIME (qint64)(16)
+
+//! Frame time (in ms) above which resolution is decreased while interacting.
+#define MAX_INTERACTION_FRAME_TIME (qint64)(33)
+
 //! Default number of decimals.
 #define DEFAULT_DECIMALS_NUMBER (int)(20)
 
@@ -68,6 +68,8 @@ class MainWindow : public QMainWindow
 	QSpinBox *preferredImageWidthSpinBox;
 	QSpinBox *preferredImageHeightSpinBox;
 	QCheckBox *solidGuessingCheckBox;
+	QSpinBox *interactionIdleDelaySpinBox;
+	QSpinBox *interactionMaxIterationsSpinBox;
 	QCheckBox *useCacheCheckBox;
 	QSpinBox *cacheSizeSpinBox;
 	QComboBox *floatTypeComboBox;
@@ -85,7 +87,10 @@ class MainWindow : public QMainWindow
 	QString gradientDir;
 	bool useCache;
 	int cacheSize;
+	QString cacheFileName;
 	bool solidGuessing;
+	int interactionIdleDelay;
+	int interactionMaxIterations;
 	QAction *switchFullScreenAction;
 
 	enum FileType getFileType(QString fileName);
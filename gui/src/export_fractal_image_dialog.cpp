@@ -97,6 +97,19 @@ ExportFractalImageDialog::ExportFractalImageDialog(const FractalConfig &config,
 	adaptiveSizeBox->setRange(2, 7);
 	adaptiveSizeBox->setValue(3);
 
+	varianceAAMButton = new QRadioButton(tr("&Variance-driven adaptive"));
+	connect(varianceAAMButton, SIGNAL(toggled(bool)), this, SLOT(onAAMVarianceToggled(bool)));
+	QLabel *varianceSizeLabel = new QLabel(tr("Maximum size:"));
+	varianceSizeBox = new QSpinBox;
+	varianceSizeBox->setRange(2, 16);
+	varianceSizeBox->setValue(6);
+	QLabel *varianceNoiseLabel = new QLabel(tr("Noise threshold:"));
+	varianceNoiseBox = new QDoubleSpinBox;
+	varianceNoiseBox->setDecimals(4);
+	varianceNoiseBox->setRange(0.0005, 0.05);
+	varianceNoiseBox->setSingleStep(0.001);
+	varianceNoiseBox->setValue(DEFAULT_ADAPTIVE_AAM_NOISE_THRESHOLD);
+
 	oversamplingAAMButton = new QRadioButton(tr("&Oversampling"));
 	connect(oversamplingAAMButton, SIGNAL(toggled(bool)), this, SLOT(onAAMOversamplingToggled(bool)));
 	QLabel *oversamplingSizeLabel = new QLabel(tr("Size:"));
@@ -116,8 +129,13 @@ ExportFractalImageDialog::ExportFractalImageDialog(const FractalConfig &config,
 	gridLayout->addWidget(oversamplingAAMButton, 5, 0);
 	gridLayout->addWidget(oversamplingSizeLabel, 6, 1);
 	gridLayout->addWidget(oversamplingSizeBox, 6, 2);
+	gridLayout->addWidget(varianceAAMButton, 7, 0);
+	gridLayout->addWidget(varianceSizeLabel, 8, 1);
+	gridLayout->addWidget(varianceSizeBox, 8, 2);
+	gridLayout->addWidget(varianceNoiseLabel, 9, 1);
+	gridLayout->addWidget(varianceNoiseBox, 9, 2);
 	gridLayout->setColumnStretch(3, 1);
-	gridLayout->setRowStretch(7, 1);
+	gridLayout->setRowStretch(10, 1);
 	antiAliasingBox->setLayout(gridLayout);
 
 	/* Set dialog main layouts. */
@@ -169,6 +187,8 @@ void ExportFractalImageDialog::onAAMNoneToggled(bool checked)
 		blurRadiusBox->setEnabled(false);
 		adaptiveSizeBox->setEnabled(false);
 		oversamplingSizeBox->setEnabled(false);
+		varianceSizeBox->setEnabled(false);
+		varianceNoiseBox->setEnabled(false);
 	}
 }
 
@@ -178,6 +198,8 @@ void ExportFractalImageDialog::onAAMBlurToggled(bool checked)
 		blurRadiusBox->setEnabled(true);
 		adaptiveSizeBox->setEnabled(false);
 		oversamplingSizeBox->setEnabled(false);
+		varianceSizeBox->setEnabled(false);
+		varianceNoiseBox->setEnabled(false);
 	}
 }
 
@@ -187,6 +209,19 @@ void ExportFractalImageDialog::onAAMAdaptiveToggled(bool checked)
 		blurRadiusBox->setEnabled(false);
 		adaptiveSizeBox->setEnabled(true);
 		oversamplingSizeBox->setEnabled(false);
+		varianceSizeBox->setEnabled(false);
+		varianceNoiseBox->setEnabled(false);
+	}
+}
+
+void ExportFractalImageDialog::onAAMVarianceToggled(bool checked)
+{
+	if (checked) {
+		blurRadiusBox->setEnabled(false);
+		adaptiveSizeBox->setEnabled(false);
+		oversamplingSizeBox->setEnabled(false);
+		varianceSizeBox->setEnabled(true);
+		varianceNoiseBox->setEnabled(true);
 	}
 }
 
@@ -196,6 +231,8 @@ void ExportFractalImageDialog::onAAMOversamplingToggled(bool checked)
 		blurRadiusBox->setEnabled(false);
 		adaptiveSizeBox->setEnabled(false);
 		oversamplingSizeBox->setEnabled(true);
+		varianceSizeBox->setEnabled(false);
+		varianceNoiseBox->setEnabled(false);
 	}
 }
 
@@ -207,6 +244,8 @@ ExportFractalImageDialog::AntiAliasingMethod ExportFractalImageDialog::getAntiAl
 		return AAM_GAUSSIANBLUR;
 	} else if (oversamplingAAMButton->isChecked()) {
 		return AAM_OVERSAMPLING;
+	} else if (varianceAAMButton->isChecked()) {
+		return AAM_VARIANCE;
 	} else {
 		return AAM_ADAPTIVE;
 	}
@@ -295,7 +334,7 @@ void ExportFractalImageDialog::exportImage()
 	case AAM_NONE: {
 		task = CreateDrawFractalTask(&fractalImg, &fractal, &render,
 			DEFAULT_QUAD_INTERPOLATION_SIZE, DEFAULT_COLOR_DISSIMILARITY_THRESHOLD,
-			floatPrecision, NULL, threads->N);
+			floatPrecision, NULL, NULL, NULL, NULL, width / 2, height / 2, threads->N);
 		LaunchTask(task, threads);
 
 		canceled = TaskProgressDialog::progress(task, tr("Drawing fractal..."),
@@ -307,7 +346,7 @@ void ExportFractalImageDialog::exportImage()
 		
 		task = CreateDrawFractalTask(&fractalImg, &fractal, &render,
 			DEFAULT_QUAD_INTERPOLATION_SIZE, DEFAULT_COLOR_DISSIMILARITY_THRESHOLD,
-			floatPrecision, NULL, threads->N);
+			floatPrecision, NULL, NULL, NULL, NULL, width / 2, height / 2, threads->N);
 		LaunchTask(task, threads);
 		canceled = TaskProgressDialog::progress(task, tr("Drawing fractal..."),
 							tr("Abort"), this);
@@ -323,37 +362,33 @@ void ExportFractalImageDialog::exportImage()
 		FreeImage(tmpImg);
 		break;
 	case AAM_OVERSAMPLING:
-		CreateImage(&tmpImg, width*oversamplingSizeBox->value(),
-			height*oversamplingSizeBox->value(), render.bytesPerComponent);
-
-		task = CreateDrawFractalTask(&tmpImg, &fractal, &render,
-			DEFAULT_QUAD_INTERPOLATION_SIZE, DEFAULT_COLOR_DISSIMILARITY_THRESHOLD,
-			floatPrecision, NULL, threads->N);
+		task = CreateOversampleFractalTask(&fractalImg, &fractal, &render,
+			oversamplingSizeBox->value(), DEFAULT_QUAD_INTERPOLATION_SIZE,
+			DEFAULT_COLOR_DISSIMILARITY_THRESHOLD, floatPrecision, threads->N);
 		LaunchTask(task, threads);
 		canceled = TaskProgressDialog::progress(task, tr("Drawing fractal..."),
 							tr("Abort"), this);
-		if (!canceled) {
-			FreeTask(task);
-			task = CreateDownscaleImageTask(&fractalImg, &tmpImg, threads->N);
-			LaunchTask(task, threads);
-			canceled = TaskProgressDialog::progress(task, tr("Downscaling image..."),
-								tr("Abort"), this);
-		}
-
-		FreeImage(tmpImg);
 		break;
 	case AAM_ADAPTIVE:
+	case AAM_VARIANCE:
 		task = CreateDrawFractalTask(&fractalImg, &fractal, &render,
 			DEFAULT_QUAD_INTERPOLATION_SIZE, DEFAULT_COLOR_DISSIMILARITY_THRESHOLD,
-			floatPrecision, NULL, threads->N);
+			floatPrecision, NULL, NULL, NULL, NULL, width / 2, height / 2, threads->N);
 		LaunchTask(task, threads);
 		canceled = TaskProgressDialog::progress(task, tr("Drawing fractal..."),
 							tr("Abort"), this);
 		if (!canceled) {
 			FreeTask(task);
-			task = CreateAntiAliaseFractalTask(&fractalImg, &fractal, &render,
-					adaptiveSizeBox->value(), DEFAULT_ADAPTIVE_AAM_THRESHOLD,
-					floatPrecision, NULL, threads->N);
+			if (getAntiAliasingMethod() == AAM_VARIANCE) {
+				task = CreateAntiAliaseFractalTask(&fractalImg, &fractal, &render,
+					varianceSizeBox->value(), DEFAULT_ADAPTIVE_AAM_THRESHOLD,
+					varianceNoiseBox->value(), floatPrecision, NULL, NULL,
+					NULL, width / 2, height / 2, threads->N);
+			} else {
+				task = CreateAntiAliaseFractalTask(&fractalImg, &fractal, &render,
+					adaptiveSizeBox->value(), DEFAULT_ADAPTIVE_AAM_THRESHOLD, 0,
+					floatPrecision, NULL, NULL, NULL, width / 2, height / 2, threads->N);
+			}
 			LaunchTask(task, threads);
 			canceled = TaskProgressDialog::progress(task,
 					tr("Anti-aliasing fractal..."), tr("Abort"), this);
@@ -375,7 +410,8 @@ void ExportFractalImageDialog::exportImage()
 		/* Export image. */
 		int exportError = 0;
 		if (depth == 2) {
-			if ((exportError = ExportPPM(fileName.toStdString().c_str(), &fractalImg)) != 0) {
+			if ((exportError = ExportPPM(fileName.toStdString().c_str(), &fractalImg,
+							threads)) != 0) {
 				QMessageBox::critical(this, tr("Failed to export image"),
 					tr("Error occured while exporting image."));
 			}
@@ -77,7 +77,13 @@ FractalExplorer::FractalExplorer(const FractalConfig &fractalConfig,
 	fractalQImage = new QImage(width, height, QImage::Format_RGB32);
 	fractalQImage->fill(0);
 	CreateImage2(&fractalImage, fractalQImage->bits(), width, height, 1);
+	InitAntiAliasingAccumulator(&antiAliasingAccumulator, width, height);
+	CreateValueBuffer(&valueBuffer, width, height);
+	valuesValid = false;
+	pendingValuesValid = false;
+	CreateOrbitBuffer(&orbitBuffer);
 	adjustSpan();
+	resetFocus();
 
 	restoreInitialStateAction = new QAction(tr("Restore &initial state"), this);
 	restoreInitialStateAction->setIconText(tr("Initial state"));
@@ -134,6 +140,8 @@ FractalExplorer::FractalExplorer(const FractalConfig &fractalConfig,
 	}
 	pCache = NULL;
 
+	CreateTileCache(&tileCache, DEFAULT_TILE_CACHE_SIZE, DEFAULT_TILE_CACHE_SPILL_SIZE);
+
 	solidGuessing = true;
 	floatPrecision = FP_DOUBLE;
 
@@ -145,6 +153,17 @@ FractalExplorer::FractalExplorer(const FractalConfig &fractalConfig,
 	timer = new QTimer(this);
 	connect(timer, SIGNAL(timeout()), this, SLOT(onTimeout()));
 	timer->start(10);
+
+	/* Create timer to detect end of interaction. */
+	interacting = false;
+	interactionIdleDelay = DEFAULT_INTERACTION_IDLE_DELAY;
+	interactionMaxIterations = DEFAULT_INTERACTION_MAX_ITERATIONS;
+	interactionScale = MIN_INTERACTION_SCALE;
+	interactionFractal = CopyFractal(&fractal);
+	interactionQImage = NULL;
+	interactionTimer = new QTimer(this);
+	interactionTimer->setSingleShot(true);
+	connect(interactionTimer, SIGNAL(timeout()), this, SLOT(onInteractionIdle()));
 }
 
 FractalExplorer::~FractalExplorer()
@@ -155,7 +174,16 @@ FractalExplorer::~FractalExplorer()
 	FreeFractalConfig(fractalConfig);
 	FreeFractalConfig(initialFractalConfig);
 	FreeImage(fractalImage);
+	FreeAntiAliasingAccumulator(&antiAliasingAccumulator);
+	FreeValueBuffer(&valueBuffer);
+	FreeOrbitBuffer(&orbitBuffer);
+	FreeFractal(interactionFractal);
+	if (interactionQImage != NULL) {
+		FreeImage(interactionImage);
+		delete interactionQImage;
+	}
 	FreeFractalCache(&cache);
+	FreeTileCache(&tileCache);
 	mpfr_clear(fractalCenterXOnPress);
 	mpfr_clear(fractalCenterYOnPress);
 	delete fractalQImage;
@@ -187,6 +215,25 @@ int FractalExplorer::getFractalCacheSize() const
 	return (int)cache.size;
 }
 
+int FractalExplorer::loadFractalCache(const QString &fileName)
+{
+	cancelActionIfNotFinished();
+
+	return ReadFractalCacheFile(&cache, fileName.toStdString().c_str());
+}
+
+int FractalExplorer::saveFractalCache(const QString &fileName)
+{
+	cancelActionIfNotFinished();
+
+	/* Nothing to save if cache was never used. */
+	if (cache.firstUse) {
+		return 0;
+	}
+
+	return WriteFractalCacheFile(&cache, fileName.toStdString().c_str());
+}
+
 void FractalExplorer::resizeFractalCache(int size)
 {
 	if (size < 0) {
@@ -217,6 +264,26 @@ void FractalExplorer::setSolidGuessingEnabled(bool enabled)
 	}
 }
 
+int FractalExplorer::getInteractionIdleDelay() const
+{
+	return interactionIdleDelay;
+}
+
+void FractalExplorer::setInteractionIdleDelay(int delay)
+{
+	interactionIdleDelay = std::max(0, delay);
+}
+
+int FractalExplorer::getInteractionMaxIterations() const
+{
+	return interactionMaxIterations;
+}
+
+void FractalExplorer::setInteractionMaxIterations(int maxIter)
+{
+	interactionMaxIterations = std::max(0, maxIter);
+}
+
 void FractalExplorer::setFractalConfig(const FractalConfig &fractalConfig)
 {
 	cancelActionIfNotFinished();
@@ -285,7 +352,7 @@ void FractalExplorer::setGradient(const Gradient &gradient)
 	adjustSpan();
 
 	emit renderingParametersChanged(render);
-	refresh();
+	recolor();
 }
 
 void FractalExplorer::adjustSpan()
@@ -351,6 +418,7 @@ void FractalExplorer::resizeImage(uint_fast32_t width, uint_fast32_t height)
 	reInitFractal();
 
 	cancelActionIfNotFinished();
+	valuesValid = false;
 	Image newImage, oldImage;
 	QImage *newQImage, *oldQImage;
 	newQImage = new QImage(width, height, QImage::Format_RGB32);
@@ -372,6 +440,7 @@ void FractalExplorer::resizeImage(uint_fast32_t width, uint_fast32_t height)
 	fractalQImage = newQImage;
 	FreeImage(oldImage);
 	delete oldQImage;
+	resetFocus();
 
 	updateGeometry();
 
@@ -433,9 +502,84 @@ void FractalExplorer::reInitRenderingParameters()
 				render.multiplier, render.offset, render.gradient);
 }
 
+void FractalExplorer::resetFocus()
+{
+	focusPos = QPointF(fractalImage.width / 2., fractalImage.height / 2.);
+}
+
+static inline bool isWholeNumber(qreal x)
+{
+	return (fabs(x - qRound(x)) < 1E-6);
+}
+
+/* Called when image has been moved by (dx,dy) pixels.
+ * Drawn part of the image (and its values) can be reused only if
+ * the image has been moved by a whole number of pixels.
+ */
+void FractalExplorer::setDrawnRectAfterMove(const QRect &previousDrawnRect, qreal dx, qreal dy)
+{
+	if (isWholeNumber(dx) && isWholeNumber(dy)) {
+		drawnRect = previousDrawnRect.translated(qRound(dx),
+				qRound(dy)).intersected(fractalQImage->rect());
+		if (valuesValid) {
+			MoveValueBuffer(&valueBuffer, qRound(dx), qRound(dy));
+		}
+	} else {
+		drawnRect = QRect();
+		valuesValid = false;
+	}
+}
+
+/* Called when only colors have changed: recolor image from
+ * values of last (finished) drawing if possible, and redraw
+ * it otherwise.
+ */
+void FractalExplorer::recolor()
+{
+	if (!redrawFractal && !fractalMoved && valuesValid) {
+		launchFractalRecoloring();
+		update();
+	} else {
+		refresh();
+	}
+}
+
 /* Assumes that action is finished.*/
 void FractalExplorer::launchFractalDrawing()
 {
+	UIRectangle reuseRegion;
+	bool reuse = !drawnRect.isEmpty();
+	if (reuse) {
+		InitUIRectangle(&reuseRegion, drawnRect.left(), drawnRect.top(),
+				drawnRect.right(), drawnRect.bottom());
+	}
+	drawnRect = QRect();
+	/* Samples of previous anti-aliasing passes are obsolete. */
+	ResetAntiAliasingAccumulator(&antiAliasingAccumulator);
+	/* Values of reused region remain valid (if they were). */
+	pendingValuesValid = !reuse || valuesValid;
+	valuesValid = false;
+
+	if (interacting) {
+		launchInteractionDrawing();
+		return;
+	}
+	/* Restore tiles of views already drawn, and reuse them instead
+	 * of drawn part of image if they cover more of it.
+	 */
+	UIRectangle restoredRegion;
+	if (RestoreImageTiles(&tileCache, &fractalImage, &valueBuffer, &fractal, &render,
+				&restoredRegion)) {
+		QRect restoredRect(QPoint(restoredRegion.x1, restoredRegion.y1),
+				QPoint(restoredRegion.x2, restoredRegion.y2));
+		if (!reuse || restoredRect.width() * restoredRect.height() >
+				(int)((reuseRegion.x2-reuseRegion.x1+1) *
+				(reuseRegion.y2-reuseRegion.y1+1))) {
+			reuse = true;
+			reuseRegion = restoredRegion;
+			pendingValuesValid = true;
+		}
+	}
 	/* Free previous action. Safe even for first launching
 	 * because action has been initialized to doNothingAction().
 	 */
@@ -444,22 +588,114 @@ void FractalExplorer::launchFractalDrawing()
 	lastActionType = A_FractalDrawing;
 	task = CreateDrawFractalTask(&fractalImage, &fractal, &render,
 				solidGuessing ? quadInterpolationSize : 1,
-				colorDissimilarityThreshold, floatPrecision,
-				pCache, threads->N);
+				colorDissimilarityThreshold, floatPrecision, pCache,
+				&valueBuffer, &orbitBuffer, reuse ? &reuseRegion : NULL,
+				std::max(0., focusPos.x()), std::max(0., focusPos.y()), threads->N);
+	LaunchTask(task, threads);
+	if (drawingPaused) {
+		PauseTask(task);
+	}
+}
+
+void FractalExplorer::startInteraction()
+{
+	interacting = true;
+	interactionTimer->start(interactionIdleDelay);
+}
+
+void FractalExplorer::onInteractionIdle()
+{
+	interacting = false;
+	refresh();
+}
+
+/* Draw fractal at reduced resolution (and possibly with fewer iterations)
+ * while interacting.
+ * Assumes that action is finished.
+ */
+void FractalExplorer::launchInteractionDrawing()
+{
+	FreeTask(task);
+	redrawFractal = false;
+	lastActionType = A_FractalInteractionDrawing;
+
+	int width = std::max(2, (int)(fractalImage.width / interactionScale));
+	int height = std::max(2, (int)(fractalImage.height / interactionScale));
+	if (interactionQImage == NULL || interactionQImage->width() != width ||
+		interactionQImage->height() != height) {
+		if (interactionQImage != NULL) {
+			FreeImage(interactionImage);
+			delete interactionQImage;
+		}
+		interactionQImage = new QImage(width, height, QImage::Format_RGB32);
+		CreateImage2(&interactionImage, interactionQImage->bits(), width, height, 1);
+	}
+	/* Start from current (moved) image, so that parts of the image
+	 * not drawn yet still show a preview.
+	 */
+	QPainter painter(interactionQImage);
+	painter.setRenderHint(QPainter::SmoothPixmapTransform);
+	painter.drawImage(interactionQImage->rect(), *fractalQImage, fractalQImage->rect());
+	painter.end();
+
+	FreeFractal(interactionFractal);
+	interactionFractal = CopyFractal(&fractal);
+	if (interactionMaxIterations > 0 &&
+		interactionFractal.maxIter > (uint_fast32_t)interactionMaxIterations) {
+		interactionFractal.maxIter = interactionMaxIterations;
+	}
+
+	/* Solid guessing is always used while interacting, and
+	 * cache is left untouched by low resolution values.
+	 */
+	task = CreateDrawFractalTask(&interactionImage, &interactionFractal, &render,
+				std::max(quadInterpolationSize, (uint_fast32_t)2),
+				colorDissimilarityThreshold, floatPrecision, NULL, NULL, NULL, NULL,
+				std::max(0., focusPos.x() / interactionScale),
+				std::max(0., focusPos.y() / interactionScale), threads->N);
+	interactionFrameTime.start();
 	LaunchTask(task, threads);
 	if (drawingPaused) {
 		PauseTask(task);
 	}
 }
 
+void FractalExplorer::upscaleInteractionImage()
+{
+	QPainter painter(fractalQImage);
+	painter.setRenderHint(QPainter::SmoothPixmapTransform);
+	if (!drawingPaused) {
+		PauseTask(task);
+	}
+	painter.drawImage(fractalQImage->rect(), *interactionQImage, interactionQImage->rect());
+	if (!drawingPaused) {
+		ResumeTask(task);
+	}
+}
+
 /* Assumes that action is finished.*/
 void FractalExplorer::launchFractalAntiAliasing()
 {
 	FreeTask(task);
 	lastActionType = A_FractalAntiAliasing;
 	task = CreateAntiAliaseFractalTask(&fractalImage, &fractal, &render,
-			currentAntiAliasingSize, adaptiveAAMThreshold,
-			floatPrecision, NULL, threads->N);
+			currentAntiAliasingSize, adaptiveAAMThreshold, 0,
+			floatPrecision, pCache, &valueBuffer, &antiAliasingAccumulator,
+			std::max(0., focusPos.x()), std::max(0., focusPos.y()),
+			threads->N);
+	LaunchTask(task, threads);
+	if (drawingPaused) {
+		PauseTask(task);
+	}
+}
+
+/* Assumes that action is finished and that values are valid.*/
+void FractalExplorer::launchFractalRecoloring()
+{
+	FreeTask(task);
+	lastActionType = A_FractalRecoloring;
+	task = CreateRecolorImageTask(&fractalImage, &valueBuffer, &render,
+					&antiAliasingAccumulator, threads->N);
 	LaunchTask(task, threads);
 	if (drawingPaused) {
 		PauseTask(task);
@@ -486,9 +722,46 @@ void FractalExplorer::onTimeout()
 	if (redrawFractal) {
 		cancelActionIfNotFinished();
 		launchFractalDrawing();
+	} else if (lastActionType == A_FractalInteractionDrawing) {
+		bool finished = TaskIsFinished(task);
+		upscaleInteractionImage();
+		if (finished) {
+			/* Adapt resolution so that next frames are drawn in time. */
+			if (GetTaskResult(task) == 0) {
+				qint64 elapsed = interactionFrameTime.elapsed();
+				if (elapsed > MAX_INTERACTION_FRAME_TIME &&
+					interactionScale < MAX_INTERACTION_SCALE) {
+					interactionScale *= 2;
+				} else if (elapsed < MIN_INTERACTION_FRAME_TIME &&
+					interactionScale > MIN_INTERACTION_SCALE) {
+					interactionScale /= 2;
+				}
+			}
+			lastActionType = A_FractalInteractionDone;
+		}
+	} else if (lastActionType == A_FractalInteractionDone) {
+		/* Wait for end of interaction. */
+		updateNeeded = false;
 	} else {
 		if (TaskIsFinished(task) && GetTaskResult(task) == 0) {
 			if (lastActionType == A_FractalDrawing) {
+				drawnRect = fractalQImage->rect();
+				valuesValid = pendingValuesValid;
+				/* Tiles are stored before anti-aliasing: their
+				 * colors can then be recomputed from their values,
+				 * and anti-aliasing of restored tiles is done again
+				 * from drawn colors (not from anti-aliased ones).
+				 */
+				if (valuesValid) {
+					StoreImageTiles(&tileCache, &fractalImage, &valueBuffer,
+							&fractal, &render);
+				}
+				currentAntiAliasingSize = minAntiAliasingSize;
+				launchFractalAntiAliasing();
+			} else if (lastActionType == A_FractalRecoloring) {
+				/* Anti-aliasing goes on from recolored samples
+				 * (edges may have changed with colors).
+				 */
 				currentAntiAliasingSize = minAntiAliasingSize;
 				launchFractalAntiAliasing();
 			} else if (currentAntiAliasingSize < maxAntiAliasingSize) {
@@ -526,6 +799,7 @@ void FractalExplorer::resumeDrawing()
 
 void FractalExplorer::refresh()
 {
+	drawnRect = QRect();
 	redrawFractal = true;
 	update();
 }
@@ -538,6 +812,8 @@ void FractalExplorer::moveFractal(const mpfr_t dx, const mpfr_t dy, bool emitFra
 	mpfr_init(absdy);
 	mpfr_abs(absdx, dx, MPFR_RNDN);
 	mpfr_abs(absdy, dy, MPFR_RNDN);
+	QRect previousDrawnRect;
+	qreal imageDx = 0.5, imageDy = 0.5;
 
 	if (mpfr_cmp_ui(fractal.spanX, 0) == 0 || mpfr_cmp_ui(fractal.spanY, 0) == 0
 		|| mpfr_cmp(absdx, fractal.spanX) >= 0 || mpfr_cmp(absdy, fractal.spanY) >= 0) {
@@ -559,6 +835,9 @@ void FractalExplorer::moveFractal(const mpfr_t dx, const mpfr_t dy, bool emitFra
 		
 		long double ddx = mpfr_get_ld(imgdx, MPFR_RNDN);
 		long double ddy = mpfr_get_ld(imgdy, MPFR_RNDN);
+		previousDrawnRect = drawnRect;
+		imageDx = -ddx;
+		imageDy = -ddy;
 
 		QRectF srcRect = QRectF(std::max((long double)0, ddx), std::max((long double)0, ddy),
 				fractalImage.width-fabsl(ddx), fractalImage.height-fabsl(ddy));
@@ -582,10 +861,12 @@ void FractalExplorer::moveFractal(const mpfr_t dx, const mpfr_t dy, bool emitFra
 		emit fractalChanged(fractal);
 	}
 	refresh();
+	setDrawnRectAfterMove(previousDrawnRect, imageDx, imageDy);
 }
 
 void FractalExplorer::moveLeftFractal()
 {
+	resetFocus();
 	mpfr_t dx, tmp;
 	mpfr_init(dx);
 	mpfr_init(tmp);
@@ -610,6 +891,7 @@ void FractalExplorer::moveLeftFractal()
 
 void FractalExplorer::moveRightFractal()
 {
+	resetFocus();
 	mpfr_t dx, tmp;
 	mpfr_init(dx);
 	mpfr_init(tmp);
@@ -630,6 +912,7 @@ void FractalExplorer::moveRightFractal()
 
 void FractalExplorer::moveUpFractal()
 {
+	resetFocus();
 	mpfr_t dy, tmp;
 	mpfr_init(dy);
 	mpfr_init(tmp);
@@ -650,6 +933,7 @@ void FractalExplorer::moveUpFractal()
 
 void FractalExplorer::moveDownFractal()
 {
+	resetFocus();
 	mpfr_t dy, tmp;
 	mpfr_init(dy);
 	mpfr_init(tmp);
@@ -822,6 +1106,7 @@ void FractalExplorer::zoomOutFractal(const mpfr_t newSpanX, const mpfr_t zoomCen
 
 void FractalExplorer::zoomInFractal()
 {
+	resetFocus();
 	mpfr_t newSpanX, tmp;
 	mpfr_init(newSpanX);
 	mpfr_init(tmp);
@@ -840,16 +1125,20 @@ void FractalExplorer::zoomInFractal()
 
 void FractalExplorer::zoomOutFractal()
 {
+	resetFocus();
 	mpfr_t newSpanX, tmp;
 	mpfr_init(newSpanX);
 	mpfr_init(tmp);
 	if (mpfr_cmp_ui(fractal.spanX,0) == 0) {
 		mpfr_set_ld(newSpanX, MIN_SINGLE_STEP, MPFR_RNDN);
 	} else {
-		mpfr_set_ld(tmp, (1 + 0.3) * fractalImage.width, MPFR_RNDN);
-		mpfr_modf(newSpanX, tmp, tmp, MPFR_RNDN);
-		mpfr_mul(newSpanX, newSpanX, fractal.spanX, MPFR_RNDN);
-		mpfr_div_ui(newSpanX, newSpanX, fractalImage.width, MPFR_RNDN);
+		/* Inverse of zoom in step, so that zooming out goes back
+		 * to views already drawn (whose tiles are cached).
+		 */
+		mpfr_set_ld(tmp, (1 - 0.3) * fractalImage.width, MPFR_RNDN);
+		mpfr_modf(tmp, newSpanX, tmp, MPFR_RNDN);
+		mpfr_mul_ui(newSpanX, fractal.spanX, fractalImage.width, MPFR_RNDN);
+		mpfr_div(newSpanX, newSpanX, tmp, MPFR_RNDN);
 	}
 	zoomOutFractal(newSpanX, fractal.centerX, fractal.centerY, true);
 	mpfr_clear(newSpanX);
@@ -883,6 +1172,7 @@ void FractalExplorer::mousePressEvent(QMouseEvent *event)
 		QLabel::mousePressEvent(event);
 	}
 	prevMousePos = event->localPos();
+	focusPos = event->localPos();
 }
 
 void FractalExplorer::mouseReleaseEvent(QMouseEvent *event)
@@ -893,6 +1183,7 @@ void FractalExplorer::mouseReleaseEvent(QMouseEvent *event)
 			if (fractalMoved) {
 				emit fractalChanged(fractal);
 				refresh();
+				setDrawnRectAfterMove(drawnRectOnPress, dragOffset.x(), dragOffset.y());
 			}
 			movingFractalDeferred = false;
 			fractalMoved = false;
@@ -912,13 +1203,16 @@ void FractalExplorer::mouseReleaseEvent(QMouseEvent *event)
 
 void FractalExplorer::mouseMoveEvent(QMouseEvent *event)
 {
+	focusPos = event->localPos();
 	if (movingFractalDeferred) {
 		if (!fractalMoved) {
 			cancelActionIfNotFinished();
 			imageCopyOnPress = fractalQImage->copy();
+			drawnRectOnPress = drawnRect;
 		}
 		fractalMoved = true;
 		QVector2D vect(event->localPos()-mousePosOnPress);
+		dragOffset = QPointF(vect.x(), vect.y());
 		mpfr_t dx, dy;
 		mpfr_init(dx);
 		mpfr_init(dy);
@@ -949,6 +1243,7 @@ void FractalExplorer::mouseMoveEvent(QMouseEvent *event)
 		reInitFractal();
 		emit fractalChanged(fractal);
 	} else if (movingFractalRealTime) {
+		startInteraction();
 		QVector2D vect(event->localPos()-prevMousePos);
 		mpfr_t dx, dy;
 		mpfr_init(dx);
@@ -971,11 +1266,6 @@ void FractalExplorer::mouseMoveEvent(QMouseEvent *event)
 	update();
 }
 
-static inline double signl(double x)
-{
-	return (x > 0) ? 1 : -1;
-}
-
 void FractalExplorer::wheelEvent(QWheelEvent *event)
 {
 	if (movingFractalDeferred) {
@@ -988,6 +1278,9 @@ void FractalExplorer::wheelEvent(QWheelEvent *event)
 		QApplication::restoreOverrideCursor();
 	}
 
+	focusPos = event->posF();
+	startInteraction();
+
 	double numDegrees = event->delta() / 8.;
 	double numSteps = numDegrees / 15;
 
@@ -997,7 +1290,8 @@ void FractalExplorer::wheelEvent(QWheelEvent *event)
 		if (mpfr_cmp_ui(fractal.spanX, 0) == 0) {
 			mpfr_set_ld(newSpanX, MIN_SINGLE_STEP, MPFR_RNDN);
 		} else {
-			mpfr_mul_d(newSpanX, fractal.spanX, powl(1 - signl(numSteps)*0.3, fabsl(numSteps)), MPFR_RNDN);
+			/* Zooming out is the inverse of zooming in. */
+			mpfr_mul_d(newSpanX, fractal.spanX, powl(1 - 0.3, numSteps), MPFR_RNDN);
 		}
 		mpfr_t zoomCenterX, zoomCenterY;
 		mpfr_init(zoomCenterX);
@@ -1220,7 +1514,7 @@ void FractalExplorer::setTransferFunction(int index)
 	render.transferFunction = (TransferFunction)index;
 	reInitRenderingParameters();
 
-	refresh();
+	recolor();
 }
 
 void FractalExplorer::setColorScaling(double value)
@@ -1230,7 +1524,7 @@ void FractalExplorer::setColorScaling(double value)
 	render.multiplier = value;
 	reInitRenderingParameters();
 
-	refresh();
+	recolor();
 }
 
 void FractalExplorer::setColorOffset(double value)
@@ -1240,7 +1534,7 @@ void FractalExplorer::setColorOffset(double value)
 	render.offset = value;
 	reInitRenderingParameters();
 
-	refresh();
+	recolor();
 }
 
 void FractalExplorer::setSpaceColor(const QColor &color)
@@ -1251,7 +1545,7 @@ void FractalExplorer::setSpaceColor(const QColor &color)
 				(uint16_t)color.green(), (uint16_t)color.blue());
 	reInitRenderingParameters();
 
-	refresh();
+	recolor();
 }
 
 inline static bool pos_less_than(const QGradientStop &s1, const QGradientStop &s2)
@@ -1317,7 +1611,7 @@ void FractalExplorer::setGradient(const QGradientStops &gradientStops)
 	FreeGradient(oldGradient);
 	reInitRenderingParameters();
 
-	refresh();
+	recolor();
 	if (!wellFormed) {
 		emit renderingParametersChanged(render);
 	}
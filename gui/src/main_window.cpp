@@ -28,8 +28,10 @@
 
 #include <QAction>
 #include <QApplication>
+#include <QDir>
 #include <QDockWidget>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QFormLayout>
 #include <QGridLayout>
 #include <QInputDialog>
@@ -97,7 +99,13 @@ void MainWindow::loadSettings()
 	useCache = settings.value("useCache", true).toBool();
 	cacheSize = settings.value("cacheSize",
 			(unsigned int)DEFAULT_FRACTAL_CACHE_SIZE).toUInt();
+	cacheFileName = settings.value("cacheFile", QStandardPaths::writableLocation(
+			QStandardPaths::CacheLocation) + "/fractal.cache").toString();
 	solidGuessing = settings.value("solidGuessing", true).toBool();
+	interactionIdleDelay = settings.value("interactionIdleDelay",
+			DEFAULT_INTERACTION_IDLE_DELAY).toInt();
+	interactionMaxIterations = settings.value("interactionMaxIterations",
+			DEFAULT_INTERACTION_MAX_ITERATIONS).toInt();
 	fractalnow_mp_precision = settings.value("MPFRPrec",
 		(unsigned int)DEFAULT_MP_PRECISION).toUInt();
 }
@@ -116,7 +124,11 @@ void MainWindow::saveSettings()
 	settings.setValue("windowHeight", height());
 	settings.setValue("useCache", fractalExplorer->getFractalCacheEnabled());
 	settings.setValue("cacheSize", fractalExplorer->getFractalCacheSize());
+	settings.setValue("cacheFile", cacheFileName);
 	settings.setValue("solidGuessing", fractalExplorer->getSolidGuessingEnabled());
+	settings.setValue("interactionIdleDelay", fractalExplorer->getInteractionIdleDelay());
+	settings.setValue("interactionMaxIterations",
+		fractalExplorer->getInteractionMaxIterations());
 	settings.setValue("MPFRPrec", MPFloatPrecisionSpinBox->value());
 }
 
@@ -277,8 +289,15 @@ MainWindow::MainWindow(int argc, char *argv[])
 					args.adaptiveAAMThreshold,
 					fractalExplorerNbThreads);
 	fractalExplorer->resizeFractalCache(cacheSize);
+	/* Values computed in previous sessions give an immediate preview. */
+	if (useCache && QFileInfo(cacheFileName).exists() &&
+			fractalExplorer->loadFractalCache(cacheFileName)) {
+		FractalNow_message(stderr, T_QUIET, "Failed to read cache file.\n");
+	}
 	fractalExplorer->useFractalCache(useCache);
 	fractalExplorer->setSolidGuessingEnabled(solidGuessing);
+	fractalExplorer->setInteractionIdleDelay(interactionIdleDelay);
+	fractalExplorer->setInteractionMaxIterations(interactionMaxIterations);
 	fractalExplorer->setFocus();
 
 	/* Make it the central widget with correct size policies. */
@@ -366,6 +385,18 @@ MainWindow::MainWindow(int argc, char *argv[])
 	solidGuessingCheckBox = new QCheckBox;
 	connect(solidGuessingCheckBox, SIGNAL(toggled(bool)),
 		fractalExplorer, SLOT(setSolidGuessingEnabled(bool)));
+	interactionIdleDelaySpinBox = new QSpinBox;
+	interactionIdleDelaySpinBox->setRange(0, 10000);
+	interactionIdleDelaySpinBox->setSuffix(tr(" ms"));
+	interactionIdleDelaySpinBox->setButtonSymbols(QAbstractSpinBox::NoButtons);
+	connect(interactionIdleDelaySpinBox, SIGNAL(valueChanged(int)),
+		fractalExplorer, SLOT(setInteractionIdleDelay(int)));
+	interactionMaxIterationsSpinBox = new QSpinBox;
+	interactionMaxIterationsSpinBox->setRange(0, std::numeric_limits<int>::max());
+	interactionMaxIterationsSpinBox->setSpecialValueText(tr("No limit"));
+	interactionMaxIterationsSpinBox->setButtonSymbols(QAbstractSpinBox::NoButtons);
+	connect(interactionMaxIterationsSpinBox, SIGNAL(valueChanged(int)),
+		fractalExplorer, SLOT(setInteractionMaxIterations(int)));
 	useCacheCheckBox = new QCheckBox;
 	connect(useCacheCheckBox, SIGNAL(toggled(bool)), fractalExplorer, SLOT(useFractalCache(bool)));
 	cacheSizeSpinBox = new QSpinBox;
@@ -407,6 +438,8 @@ MainWindow::MainWindow(int argc, char *argv[])
 	preferredImageWidthSpinBox->setValue((int)lastPreferredExplorerWidth);
 	preferredImageHeightSpinBox->setValue((int)lastPreferredExplorerHeight);
 	solidGuessingCheckBox->setChecked(fractalExplorer->getSolidGuessingEnabled());
+	interactionIdleDelaySpinBox->setValue(fractalExplorer->getInteractionIdleDelay());
+	interactionMaxIterationsSpinBox->setValue(fractalExplorer->getInteractionMaxIterations());
 	useCacheCheckBox->setChecked(fractalExplorer->getFractalCacheEnabled());
 	cacheSizeSpinBox->setValue(fractalExplorer->getFractalCacheSize());
 	floatTypeComboBox->setCurrentIndex((int)args.floatPrecision);
@@ -415,6 +448,8 @@ MainWindow::MainWindow(int argc, char *argv[])
 	otherParamLayout->addRow(tr("Preferred image width:"), preferredImageWidthSpinBox);
 	otherParamLayout->addRow(tr("Preferred image height:"), preferredImageHeightSpinBox);
 	otherParamLayout->addRow(tr("Solid guessing:"), solidGuessingCheckBox);
+	otherParamLayout->addRow(tr("Interaction idle delay:"), interactionIdleDelaySpinBox);
+	otherParamLayout->addRow(tr("Interaction max iterations:"), interactionMaxIterationsSpinBox);
 	otherParamLayout->addRow(tr("Use cache:"), useCacheCheckBox);
 	otherParamLayout->addRow(tr("Cache size:"), cacheSizeSpinBox);
 	otherParamLayout->addRow(tr("Float type:"), floatTypeComboBox);
@@ -606,6 +641,12 @@ void MainWindow::delayedInit()
 MainWindow::~MainWindow()
 {
 	saveSettings();
+	if (fractalExplorer->getFractalCacheEnabled()) {
+		QDir().mkpath(QFileInfo(cacheFileName).absolutePath());
+		if (fractalExplorer->saveFractalCache(cacheFileName)) {
+			FractalNow_message(stderr, T_QUIET, "Failed to write cache file.\n");
+		}
+	}
 	mpfr_free_cache();
 }
 
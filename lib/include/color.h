@@ -100,16 +100,19 @@ extern "C" {
 /**
  * \struct Color
  * \brief Simple RGB color structure.
+ *
+ * Exact-width types are used so that the structure fits in 8 bytes
+ * (colors are passed by value and stored in gradients).
  */
 /**
  * \typedef Color
  * \brief Convenient typedef for struct Color.
  */
 typedef struct Color {
-	uint_fast8_t bytesPerComponent; /*!< Either 1 (RGB8) or 2 (RGB16).*/
-	uint_fast16_t r; /*!< Red component.*/
-	uint_fast16_t g; /*!< Green component.*/
-	uint_fast16_t b; /*!< Blue component.*/
+	uint8_t bytesPerComponent; /*!< Either 1 (RGB8) or 2 (RGB16).*/
+	uint16_t r; /*!< Red component.*/
+	uint16_t g; /*!< Green component.*/
+	uint16_t b; /*!< Blue component.*/
 } Color;
 
 /**
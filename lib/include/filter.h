@@ -228,6 +228,33 @@ int NormalizeFilter(Filter *filter);
 Color ApplyFilterOnSinglePixel(const Image *src, uint_fast32_t x, uint_fast32_t y,
 				const Filter *filter);
 
+/**
+ * \fn void ApplyFilterOnRow(Image *dst, uint_fast32_t dstX, uint_fast32_t dstY, const Image *src, uint_fast32_t x, uint_fast32_t y, uint_fast32_t length, const Filter *filter, double *buffer)
+ * \brief Apply a filter on a row of pixels of an image.
+ *
+ * Result is the same as applying ApplyFilterOnSinglePixel on pixels
+ * (x,y) to (x+length-1,y) of src, and putting them at (dstX,dstY) to
+ * (dstX+length-1,dstY) in dst, but much faster: border handling is
+ * only done at the edges of the image and packed pixels are
+ * accumulated a row at a time.\n
+ * It is safe to pass (x,y) outside image, but pixels of dst must be
+ * within range.\n
+ * buffer must be able to hold at least 3*length doubles.
+ *
+ * \param dst Destination image.
+ * \param dstX X coordinate of first destination pixel.
+ * \param dstY Y coordinate of destination pixels.
+ * \param src Image we apply the filter on.
+ * \param x X coordinate of first pixel we apply the filter on.
+ * \param y Y coordinate of pixels we apply the filter on.
+ * \param length Number of pixels.
+ * \param filter Filter we apply on the image.
+ * \param buffer Temporary buffer.
+ */
+void ApplyFilterOnRow(Image *dst, uint_fast32_t dstX, uint_fast32_t dstY, const Image *src,
+			uint_fast32_t x, uint_fast32_t y, uint_fast32_t length,
+			const Filter *filter, double *buffer);
+
 /**
  * \fn void ApplyFilter(Image *dst, const Image *src, const Filter *filter, Threads *threads)
  * \brief Apply filter on image.
@@ -259,6 +286,42 @@ void ApplyFilter(Image *dst, const Image *src, const Filter *filter, Threads *th
 Task *CreateApplyFilterTask(Image *dst, const Image *src, const Filter *filter,
 				uint_fast32_t nbThreads);
 
+/**
+ * \fn void ApplyRecursiveGaussianBlur(Image *dst, const Image *src, double sigma, Threads *threads)
+ * \brief Apply recursive gaussian blur on image.
+ *
+ * Approximates gaussian blur with a recursive (IIR) filter
+ * horizontally and then vertically, so that cost per pixel does not
+ * depend on sigma.\n
+ * Approximation is good for sigma >= 1, which makes it a better
+ * choice than convolution for large radii only.\n
+ * dst can be the same as src.
+ *
+ * \param dst Pointer to already created destination image.
+ * \param src Pointer to source image (to apply blur on).
+ * \param sigma Gaussian sigma (must be > 0).
+ * \param threads Threads to be used for task.
+ */
+void ApplyRecursiveGaussianBlur(Image *dst, const Image *src, double sigma, Threads *threads);
+
+/**
+ * \fn Task *CreateApplyRecursiveGaussianBlurTask(Image *dst, Image *temp, const Image *src, double sigma, uint_fast32_t nbThreads)
+ * \brief Create task applying a recursive gaussian blur.
+ *
+ * See ApplyRecursiveGaussianBlur.\n
+ * When launching task, Threads structure should provide
+ * enough threads (at least number specified here).
+ *
+ * \param dst Pointer to already created destination image.
+ * \param temp Pointer to temporary image (same size as src).
+ * \param src Pointer to source image (to apply blur on).
+ * \param sigma Gaussian sigma (must be > 0).
+ * \param nbThreads Number of threads that action will need to be launched.
+ * \return Corresponding newly-allocated task.
+ */
+Task *CreateApplyRecursiveGaussianBlurTask(Image *dst, Image *temp, const Image *src,
+						double sigma, uint_fast32_t nbThreads);
+
 /**
  * \fn void FreeFilter(Filter filter)
  * \brief Free filter.
@@ -50,6 +50,7 @@
 #include "fractal_rendering_parameters.h"
 #include "task.h"
 #include "thread.h"
+#include "uirectangle.h"
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -72,6 +73,30 @@ extern "C" {
  */
 #define DEFAULT_COLOR_DISSIMILARITY_THRESHOLD (double)(3.5E-3)
 
+/**
+ * \def AUTO_MAXITER_PROBE_SIZE
+ * \brief Size (largest dimension) of probe grid for automatic maximum number of iterations.
+ *
+ * \see GetAutoMaxIter for more details.
+ */
+#define AUTO_MAXITER_PROBE_SIZE (uint_fast32_t)(128)
+
+/**
+ * \def AUTO_MAXITER_MIN
+ * \brief Lowest automatic maximum number of iterations.
+ *
+ * \see GetAutoMaxIter for more details.
+ */
+#define AUTO_MAXITER_MIN (uint_fast32_t)(64)
+
+/**
+ * \def AUTO_MAXITER_THRESHOLD
+ * \brief Stability threshold for automatic maximum number of iterations.
+ *
+ * \see GetAutoMaxIter for more details.
+ */
+#define AUTO_MAXITER_THRESHOLD (double)(1E-2)
+
 /**
  * \def DEFAULT_ADAPTIVE_AAM_THRESHOLD
  * \brief Default threshold for adaptive anti-aliasing.
@@ -80,6 +105,16 @@ extern "C" {
  */
 #define DEFAULT_ADAPTIVE_AAM_THRESHOLD (double)(5.05E-2)
 
+/**
+ * \def DEFAULT_ADAPTIVE_AAM_NOISE_THRESHOLD
+ * \brief Default noise threshold for variance-driven adaptive anti-aliasing.
+ *
+ * About two and a half levels of an 8-bits color component.
+ *
+ * \see AntiAliaseFractal for more details.
+ */
+#define DEFAULT_ADAPTIVE_AAM_NOISE_THRESHOLD (double)(1E-2)
+
 /**
  * \struct Fractal
  * \brief Description of a subset of some fractal set.
@@ -166,6 +201,19 @@ void InitFractal2(Fractal *fractal, FractalFormula fractalFormula, const mpc_t p
  */
 Fractal CopyFractal(const Fractal *fractal);
 
+/**
+ * \fn int PartCompareFractals(const Fractal *fractal1, const Fractal *fractal2)
+ * \brief Compare the parameters fractal values depend on, apart from view.
+ *
+ * Fractal formula, p, c, escape radius and maximum number of
+ * iterations are compared (center and span are not).
+ *
+ * \param fractal1 First fractal.
+ * \param fractal2 Second fractal.
+ * \return 0 if those parameters are equal, 1 otherwise.
+ */
+int PartCompareFractals(const Fractal *fractal1, const Fractal *fractal2);
+
 /**
  * \fn int isSupportedFractalFile(const char *fileName)
  * \brief Check whether a file is a supported fractal file.
@@ -230,13 +278,184 @@ int WriteFractalFileBody(const Fractal *fractal, const char *fileName, FILE *fil
 int WriteFractalFile(const Fractal *fractal, const char *fileName);
 
 /**
- * \fn void DrawFractal(Image *image, const Fractal *fractal, const RenderingParameters *render, uint_fast32_t quadInterpolationSize, double interpolationThreshold, FloatPrecision floatPrecision, FractalCache *cache, Threads* threads)
+ * \struct SampleValues
+ * \brief Fractal values of the anti-aliasing samples of one pixel.
+ */
+/**
+ * \typedef SampleValues
+ * \brief Convenient typedef for struct SampleValues.
+ */
+typedef struct SampleValues {
+	uint32_t nbSamples;
+ /*!< Number of samples (the first one being pixel center).*/
+	uint32_t capacity;
+ /*!< Number of values allocated.*/
+	double *values;
+ /*!< Sample values, in the order samples were computed.*/
+} SampleValues;
+
+/**
+ * \struct ValueBuffer
+ * \brief Fractal values of the pixels of an image.
+ *
+ * Value buffer keeps the fractal values an image was drawn from, so
+ * that the image can be recolored (see RecolorImage) without computing
+ * fractal again when only the way values are mapped to colors changes
+ * (gradient, transfer function, multiplier, offset or space color).\n
+ * Values are those of pixel centers (negative for fractal space).
+ * Interpolated pixels get values interpolated from quad corners, and
+ * pixels taken from cache get the value of the closest cache entry.\n
+ * Anti-aliased pixels also keep the values of their samples. Memory is
+ * only allocated for the blocks of the image that contain anti-aliased
+ * pixels.
+ */
+/**
+ * \typedef ValueBuffer
+ * \brief Convenient typedef for struct ValueBuffer.
+ */
+typedef struct ValueBuffer {
+	uint_fast32_t width;
+ /*!< Width of image.*/
+	uint_fast32_t height;
+ /*!< Height of image.*/
+	double maxValue;
+ /*!< Upper bound of values (maxIter+1 of fractal last drawn).*/
+	double *values;
+ /*!< Values of pixel centers (row by row).*/
+	uint_fast32_t nbBlocksX;
+ /*!< Number of blocks of pixels horizontally.*/
+	uint_fast32_t nbBlocksY;
+ /*!< Number of blocks of pixels vertically.*/
+	SampleValues **blocks;
+ /*!< Blocks of sample values (NULL for blocks without anti-aliased pixels).*/
+} ValueBuffer;
+
+/**
+ * \fn void CreateValueBuffer(ValueBuffer *buffer, uint_fast32_t width, uint_fast32_t height)
+ * \brief Create value buffer for an image.
+ *
+ * \param buffer Pointer to value buffer structure to create.
+ * \param width Width of image.
+ * \param height Height of image.
+ */
+void CreateValueBuffer(ValueBuffer *buffer, uint_fast32_t width, uint_fast32_t height);
+
+/**
+ * \fn void ResetValueBufferSamples(ValueBuffer *buffer)
+ * \brief Discard values of anti-aliasing samples of value buffer.
+ *
+ * \param buffer Pointer to value buffer.
+ */
+void ResetValueBufferSamples(ValueBuffer *buffer);
+
+/**
+ * \fn void MoveValueBuffer(ValueBuffer *buffer, int_fast32_t dx, int_fast32_t dy)
+ * \brief Move values of value buffer by a whole number of pixels.
+ *
+ * To be used along with the image, when a drawn image is moved to be
+ * partly reused (see CreateDrawFractalTask).\n
+ * Values of pixels uncovered by move are undefined, and values of
+ * anti-aliasing samples are discarded.
+ *
+ * \param buffer Pointer to value buffer.
+ * \param dx Horizontal move (in pixels).
+ * \param dy Vertical move (in pixels).
+ */
+void MoveValueBuffer(ValueBuffer *buffer, int_fast32_t dx, int_fast32_t dy);
+
+/**
+ * \fn void FreeValueBuffer(ValueBuffer *buffer)
+ * \brief Free value buffer.
+ *
+ * \param buffer Pointer to value buffer to free.
+ */
+void FreeValueBuffer(ValueBuffer *buffer);
+
+/**
+ * \def ORBIT_BLOCK_SIZE
+ * \brief Number of orbits per block of orbit buffer.
+ */
+#define ORBIT_BLOCK_SIZE (uint_fast32_t)(4096)
+
+/**
+ * \struct OrbitBuffer
+ * \brief Orbits of the pixels of an image, to resume computation.
+ *
+ * Orbit buffer keeps, for each pixel of an image that was computed,
+ * either its fractal value if it escaped, or the state of its orbit
+ * (current z, number of iterations and coloring sums) if it did not.
+ * When the image is drawn again with a higher maximum number of
+ * iterations (see CreateDrawFractalTask), values of escaped pixels
+ * are reused, and only unescaped pixels are iterated further, going
+ * on from their orbits.\n
+ * Buffer is emptied when it is used to draw another image (different
+ * size, fractal, view, rendering parameters, float precision, or
+ * lower maximum number of iterations).\n
+ * Orbits cannot be kept with multiple precision (buffer is then not
+ * used).
+ */
+/**
+ * \typedef OrbitBuffer
+ * \brief Convenient typedef for struct OrbitBuffer.
+ */
+typedef struct OrbitBuffer {
+	uint_fast32_t width;
+ /*!< Width of image.*/
+	uint_fast32_t height;
+ /*!< Height of image.*/
+	int hasParameters;
+ /*!< 1 if fractal, rendering parameters and float precision below are set.*/
+	Fractal fractal;
+ /*!< Fractal of orbits (maximum number of iterations being the highest one orbits were computed with).*/
+	RenderingParameters render;
+ /*!< Rendering parameters of orbits.*/
+	FloatPrecision floatPrecision;
+ /*!< Float precision of orbits.*/
+	uint32_t *state;
+ /*!< State of pixels (row by row) : 0 if not computed, 1 if escaped, orbit index + 2 otherwise.*/
+	double *values;
+ /*!< Values of escaped pixels (row by row).*/
+	size_t orbitSize;
+ /*!< Size of one orbit (depends on fractal engine).*/
+	uint_fast32_t nbOrbits;
+ /*!< Number of orbits kept.*/
+	uint_fast32_t nbBlocks;
+ /*!< Maximum number of orbit blocks (enough for all pixels).*/
+	uint8_t **blocks;
+ /*!< Blocks of ORBIT_BLOCK_SIZE orbits (NULL for blocks not allocated yet).*/
+	pthread_spinlock_t mutex;
+ /*!< Mutex for adding orbits.*/
+} OrbitBuffer;
+
+/**
+ * \fn void CreateOrbitBuffer(OrbitBuffer *buffer)
+ * \brief Create (empty) orbit buffer.
+ *
+ * Buffer is sized when it is first used to draw an image.
+ *
+ * \param buffer Pointer to orbit buffer structure to create.
+ */
+void CreateOrbitBuffer(OrbitBuffer *buffer);
+
+/**
+ * \fn void FreeOrbitBuffer(OrbitBuffer *buffer)
+ * \brief Free orbit buffer.
+ *
+ * \param buffer Pointer to orbit buffer to free.
+ */
+void FreeOrbitBuffer(OrbitBuffer *buffer);
+
+/**
+ * \fn void DrawFractal(Image *image, const Fractal *fractal, const RenderingParameters *render, uint_fast32_t quadInterpolationSize, double interpolationThreshold, FloatPrecision floatPrecision, FractalCache *cache, ValueBuffer *values, Threads* threads)
  * \brief Draw fractal in a fast, approximate way.
  *
  * Image width and height must be >= 2 (does nothing otherwise).\n
  * Details on the algorithm :
  * The image is cut in quads (rectangles, actually) of size
- * quadInterpolationSize (meaning width AND height <= size).\n
+ * quadInterpolationSize (meaning width AND height <= size).
+ * Quads are aligned on a grid of that size starting at the top-left
+ * corner of the image, so that image does not depend on the number of
+ * threads.\n
  * Then for each quad, its corner colors are computed, and depending
  * on its dissimilarity (average difference of the corner colors to the
  * average color of the corners), the quad is either computed or linearly
@@ -244,10 +463,16 @@ int WriteFractalFile(const Fractal *fractal, const char *fileName);
  * Default values of quadInterpolationSize and interpolationThreshold
  * are good for no visible loss of quality.\n
  * Pointer to cache structure can be NULL if no cache is to be used.\n
- * If cache is not NULL, it must point to a created cache structure,
- * and it is used to generate a preview of the image, and speed-up
- * the task by using values computed by a previous fractal drawing
- * or anti-aliasing.
+ * If cache is not NULL, it must point to a created cache structure.
+ * Pixels whose exact value is in cache (computed by a previous drawing
+ * of the same view with the same image size) are not computed again,
+ * and computed values are added to cache (unless it is read-only).
+ * Since drawing is blocking, no preview is created from cache (unlike
+ * CreateDrawFractalTask), so image is the same as without cache, except
+ * for the rounding of values stored in cache (single precision).\n
+ * Pointer to value buffer can be NULL if values are not to be kept.
+ * Otherwise, it is resized to image size if needed, filled with the
+ * values of the pixels, and its anti-aliasing samples are discarded.
  *
  * \param image Image in which to draw fractal subset.
  * \param fractal Fractal subset to compute.
@@ -256,14 +481,16 @@ int WriteFractalFile(const Fractal *fractal, const char *fileName);
  * \param interpolationThreshold Dissimilarity threshold for interpolation.
  * \param floatPrecision Float precision.
  * \param cache Cache structure to put computed values in.
+ * \param values Value buffer to put pixel values in.
  * \param threads Threads to be used for task.
  */
 void DrawFractal(Image *image, const Fractal *fractal, const RenderingParameters *render,
 			uint_fast32_t quadInterpolationSize, double interpolationThreshold,
-			FloatPrecision floatPrecision, FractalCache *cache, Threads* threads);
+			FloatPrecision floatPrecision, FractalCache *cache, ValueBuffer *values,
+			Threads* threads);
 
 /**
- * \fn Task *CreateDrawFractalTask(Image *image, const Fractal *fractal, const RenderingParameters *render, uint_fast32_t quadInterpolationSize, double interpolationThreshold, FloatPrecision floatPrecision, FractalCache *cache, uint_fast32_t nbThreads)
+ * \fn Task *CreateDrawFractalTask(Image *image, const Fractal *fractal, const RenderingParameters *render, uint_fast32_t quadInterpolationSize, double interpolationThreshold, FloatPrecision floatPrecision, FractalCache *cache, ValueBuffer *values, OrbitBuffer *orbits, const UIRectangle *reuseRegion, uint_fast32_t focusX, uint_fast32_t focusY, uint_fast32_t nbThreads)
  * \brief Create fractal drawing task.
  *
  * Create task and return immediately.\n
@@ -273,6 +500,22 @@ void DrawFractal(Image *image, const Fractal *fractal, const RenderingParameters
  * When launching task, Threads structure should provide
  * enough threads (at least number specified here).
  * Pointer to cache structure can be NULL if no cache is to be used.
+ * Otherwise, a preview of the image is first created from cache, then
+ * pixels whose exact value is in cache are not computed again, and
+ * other pixels are taken from preview when it has a value for them.\n
+ * The image is drawn tile by tile, starting with the tiles closest to
+ * the focus point (typically the image center, or the mouse position
+ * in an interactive session).\n
+ * Pixels inside reuse region are assumed to be already drawn (typically
+ * copied from the previous image, moved by a whole number of pixels) and
+ * are left untouched. Reuse region can be NULL if nothing is to be reused.\n
+ * Value buffer can be NULL (see DrawFractal). If image region is reused,
+ * the values of that region must have been moved along with it (see
+ * MoveValueBuffer).\n
+ * Orbit buffer can be NULL if orbits are not to be kept. Otherwise,
+ * pixels already computed for the same image with a lower (or the
+ * same) maximum number of iterations are not computed from scratch
+ * (see OrbitBuffer).
  *
  * \param image Image in which to draw fractal subset.
  * \param fractal Fractal subset to compute.
@@ -281,16 +524,176 @@ void DrawFractal(Image *image, const Fractal *fractal, const RenderingParameters
  * \param interpolationThreshold Dissimilarity threshold for interpolation.
  * \param floatPrecision Float precision.
  * \param cache Cache structure to put computed values in.
+ * \param values Value buffer to put pixel values in.
+ * \param orbits Orbit buffer to resume computation from and put orbits in.
+ * \param reuseRegion Region of image already drawn.
+ * \param focusX X coordinate (in image) of the point to draw first.
+ * \param focusY Y coordinate (in image) of the point to draw first.
  * \param nbThreads Number of threads that action will need to be launched.
  * \return Corresponding newly-allocated task.
  */
 Task *CreateDrawFractalTask(Image *image, const Fractal *fractal, const RenderingParameters *render,
 				uint_fast32_t quadInterpolationSize, double interpolationThreshold,
 				FloatPrecision floatPrecision,  FractalCache *cache,
+				ValueBuffer *values, OrbitBuffer *orbits,
+				const UIRectangle *reuseRegion,
+				uint_fast32_t focusX, uint_fast32_t focusY,
 				uint_fast32_t nbThreads);
 
 /**
- * \fn void AntiAliaseFractal(Image *image, const Fractal *fractal, const RenderingParameters *render, uint_fast32_t antiAliasingSize, double threshold, FloatPrecision floatPrecision, FractalCache *cache, Threads *threads)
+ * \fn uint_fast32_t GetAutoMaxIter(const Fractal *fractal, const RenderingParameters *render, FloatPrecision floatPrecision, Threads *threads)
+ * \brief Choose maximum number of iterations for fractal.
+ *
+ * Fractal is computed on a sparse probe grid (AUTO_MAXITER_PROBE_SIZE
+ * samples for its largest dimension), with a maximum number of
+ * iterations starting at AUTO_MAXITER_MIN and doubled at each step
+ * (unescaped samples going on from their orbits, see OrbitBuffer).\n
+ * Boundary samples are unescaped samples next to escaped ones.
+ * The smallest maximum number of iterations at which multiplying it
+ * by four makes no more than AUTO_MAXITER_THRESHOLD of boundary
+ * samples escape is returned: boundary of fractal is then stable, and
+ * image drawn with it looks like image drawn with more iterations.\n
+ * Maximum number of iterations of fractal is used as an upper bound
+ * (and returned if no lower value is stable).
+ *
+ * \param fractal Fractal to choose maximum number of iterations for.
+ * \param render Rendering parameters.
+ * \param floatPrecision Float precision.
+ * \param threads Threads to be used for probing.
+ * \return Maximum number of iterations chosen.
+ */
+uint_fast32_t GetAutoMaxIter(const Fractal *fractal, const RenderingParameters *render,
+				FloatPrecision floatPrecision, Threads *threads);
+
+/**
+ * \fn void OversampleFractal(Image *image, const Fractal *fractal, const RenderingParameters *render, double oversamplingSize, uint_fast32_t quadInterpolationSize, double interpolationThreshold, FloatPrecision floatPrecision, Threads *threads)
+ * \brief Draw fractal oversampled and downscaled into image.
+ *
+ * Result is the same as drawing fractal in an image oversamplingSize
+ * times bigger and downscaling it into image, but sub-samples are
+ * computed and filtered tile by tile, so that memory used does not
+ * depend on oversampling size.\n
+ * Oversampling size must be >= 1.\n
+ * Quad interpolation is applied to the oversampled image (see
+ * DrawFractal).
+ *
+ * \param image Image in which to draw fractal subset.
+ * \param fractal Fractal subset to compute.
+ * \param render Rendering parameters.
+ * \param oversamplingSize Oversampling size.
+ * \param quadInterpolationSize Maximum quad size for interpolation.
+ * \param interpolationThreshold Dissimilarity threshold for interpolation.
+ * \param floatPrecision Float precision.
+ * \param threads Threads to be used for task.
+ */
+void OversampleFractal(Image *image, const Fractal *fractal, const RenderingParameters *render,
+			double oversamplingSize, uint_fast32_t quadInterpolationSize,
+			double interpolationThreshold, FloatPrecision floatPrecision,
+			Threads *threads);
+
+/**
+ * \fn Task *CreateOversampleFractalTask(Image *image, const Fractal *fractal, const RenderingParameters *render, double oversamplingSize, uint_fast32_t quadInterpolationSize, double interpolationThreshold, FloatPrecision floatPrecision, uint_fast32_t nbThreads)
+ * \brief Create task drawing fractal oversampled and downscaled into image.
+ *
+ * Created task can be launched and cancelled.\n
+ * See OversampleFractal.
+ *
+ * \param image Image in which to draw fractal subset.
+ * \param fractal Fractal subset to compute.
+ * \param render Rendering parameters.
+ * \param oversamplingSize Oversampling size.
+ * \param quadInterpolationSize Maximum quad size for interpolation.
+ * \param interpolationThreshold Dissimilarity threshold for interpolation.
+ * \param floatPrecision Float precision.
+ * \param nbThreads Number of threads that task will use.
+ * \return Corresponding newly-allocated task.
+ */
+Task *CreateOversampleFractalTask(Image *image, const Fractal *fractal,
+					const RenderingParameters *render, double oversamplingSize,
+					uint_fast32_t quadInterpolationSize,
+					double interpolationThreshold, FloatPrecision floatPrecision,
+					uint_fast32_t nbThreads);
+
+/**
+ * \struct AntiAliasingPixel
+ * \brief Anti-aliasing samples accumulated for one pixel.
+ */
+/**
+ * \typedef AntiAliasingPixel
+ * \brief Convenient typedef for struct AntiAliasingPixel.
+ */
+typedef struct AntiAliasingPixel {
+	float r;
+ /*!< Sum of red components of samples.*/
+	float g;
+ /*!< Sum of green components of samples.*/
+	float b;
+ /*!< Sum of blue components of samples.*/
+	float sqSum;
+ /*!< Sum of squared components (normalized to [0,1]) of samples.*/
+	uint32_t nbSamples;
+ /*!< Number of samples already computed.*/
+} AntiAliasingPixel;
+
+/**
+ * \struct AntiAliasingAccumulator
+ * \brief Anti-aliasing samples accumulated over successive passes.
+ *
+ * Samples of a pixel are taken in a fixed sequence of sub-pixel
+ * positions, so that the samples of an anti-aliasing pass are also
+ * the first samples of any pass with a bigger size. Thus a pass only
+ * needs to compute the samples that previous passes did not compute.\n
+ * Memory is only allocated for the blocks of the image that contain
+ * anti-aliased pixels.
+ */
+/**
+ * \typedef AntiAliasingAccumulator
+ * \brief Convenient typedef for struct AntiAliasingAccumulator.
+ */
+typedef struct AntiAliasingAccumulator {
+	uint_fast32_t width;
+ /*!< Width of image.*/
+	uint_fast32_t height;
+ /*!< Height of image.*/
+	uint_fast32_t nbBlocksX;
+ /*!< Number of blocks of pixels horizontally.*/
+	uint_fast32_t nbBlocksY;
+ /*!< Number of blocks of pixels vertically.*/
+	AntiAliasingPixel **blocks;
+ /*!< Blocks of pixels (NULL for blocks without any sample).*/
+} AntiAliasingAccumulator;
+
+/**
+ * \fn void InitAntiAliasingAccumulator(AntiAliasingAccumulator *accumulator, uint_fast32_t width, uint_fast32_t height)
+ * \brief Initialize (empty) anti-aliasing accumulator.
+ *
+ * \param accumulator Pointer to accumulator structure to initialize.
+ * \param width Width of image to anti-aliase.
+ * \param height Height of image to anti-aliase.
+ */
+void InitAntiAliasingAccumulator(AntiAliasingAccumulator *accumulator, uint_fast32_t width,
+					uint_fast32_t height);
+
+/**
+ * \fn void ResetAntiAliasingAccumulator(AntiAliasingAccumulator *accumulator)
+ * \brief Discard all samples of anti-aliasing accumulator.
+ *
+ * Must be called whenever image is redrawn.
+ *
+ * \param accumulator Pointer to accumulator structure to reset.
+ */
+void ResetAntiAliasingAccumulator(AntiAliasingAccumulator *accumulator);
+
+/**
+ * \fn void FreeAntiAliasingAccumulator(AntiAliasingAccumulator *accumulator)
+ * \brief Free anti-aliasing accumulator.
+ *
+ * \param accumulator Pointer to accumulator structure to free.
+ */
+void FreeAntiAliasingAccumulator(AntiAliasingAccumulator *accumulator);
+
+/**
+ * \fn void AntiAliaseFractal(Image *image, const Fractal *fractal, const RenderingParameters *render, uint_fast32_t antiAliasingSize, double threshold, double noiseThreshold, FloatPrecision floatPrecision, FractalCache *cache, ValueBuffer *values, Threads *threads)
  * \brief AntiAliase fractal image.
  *
  * Image width and height must be >= 2 (does nothing otherwise).\n
@@ -299,54 +702,130 @@ Task *CreateDrawFractalTask(Image *image, const Fractal *fractal, const Renderin
  * Details on the algorithm :
  * Pixels that differ too much from neighbour pixels
  * (difference greater than threshold) are recomputed.\n
- * Several pixels (antiAliasingSize^2 to be precise) are computed
- * for each of these preselected pixels, and averaged (with gaussian
- * filter) to produce the new pixel value.\n
+ * Several samples (antiAliasingSize^2 to be precise) are computed
+ * for each of these preselected pixels, at sub-pixel positions given
+ * by a low-discrepancy sequence (symmetric about pixel center), and
+ * averaged to produce the new pixel value.\n
  * Default threshold value is good to obtain a result similar to
  * oversampling (computing a bigger image and downscaling it) with
  * the same size factor.\n
+ * If noise threshold is > 0, samples are computed by batches, and
+ * computation of a pixel stops as soon as the estimated noise of its
+ * value (standard error of the mean of the samples, per component
+ * normalized to [0,1]) drops below noise threshold: antiAliasingSize^2
+ * is then only the maximum number of samples per pixel. Most pixels
+ * converge with far fewer samples.\n
  * Pointer to cache structure can be NULL if no cache is to be used.\n
- * Note that for anti-aliasing, cache is not used to generate of preview
- * of the image and speed-up task: it is only filled with the values
- * computed when anti-aliasing.
+ * Note that for anti-aliasing, cache is not used to generate a preview
+ * of the image: samples are looked up in cache (samples of a previous
+ * anti-aliasing of the same view), and the ones computed are added to
+ * it. Cache is ignored if it is not usable for fractal (see
+ * isCacheUsable).\n
+ * Pointer to value buffer can be NULL. Otherwise it must have been
+ * filled when drawing image, and values of samples are added to it.
  *
  * \param image Fractal image (already drawn) to anti-aliase.
  * \param fractal Fractal subset to compute.
  * \param render Rendering parameters.
  * \param antiAliasingSize Anti-aliasing size.
  * \param threshold Dissimilarity threshold to determine pixels to recompute.
+ * \param noiseThreshold Noise below which a pixel needs no more samples (0 to disable).
  * \param floatPrecision Float precision.
  * \param cache Cache structure to put computed values in.
+ * \param values Value buffer of image.
  * \param threads Threads to be used for task.
  */
 void AntiAliaseFractal(Image *image, const Fractal *fractal, const RenderingParameters *render,
-			uint_fast32_t antiAliasingSize, double threshold,
-			FloatPrecision floatPrecision, FractalCache *cache, Threads *threads);
+			uint_fast32_t antiAliasingSize, double threshold, double noiseThreshold,
+			FloatPrecision floatPrecision, FractalCache *cache, ValueBuffer *values,
+			Threads *threads);
 
 /**
- * \fn Task *CreateAntiAliaseFractalTask(Image *image, const Fractal *fractal, const RenderingParameters *render, uint_fast32_t antiAliasingSize, double threshold, FloatPrecision floatPrecision, FractalCache *cache, uint_fast32_t nbThreads)
+ * \fn Task *CreateAntiAliaseFractalTask(Image *image, const Fractal *fractal, const RenderingParameters *render, uint_fast32_t antiAliasingSize, double threshold, double noiseThreshold, FloatPrecision floatPrecision, FractalCache *cache, ValueBuffer *values, AntiAliasingAccumulator *accumulator, uint_fast32_t focusX, uint_fast32_t focusY, uint_fast32_t nbThreads)
  * \brief Create task anti-aliasing fractal image
  *
  * Create task and return immediately.\n
  * Image width and height must be >= 2 (does nothing otherwise).\n
  * Anti-aliasing size must be >= 2 to have an effect (does nothing otherwise).\n
  * When launching task, Threads structure should provide
- * enough threads (at least number specified here).
+ * enough threads (at least number specified here).\n
+ * Task first selects the pixels to anti-aliase (edge detection),
+ * and then computes their samples, with threads sharing the selected
+ * pixels dynamically.\n
+ * As for drawing, tiles closest to the focus point are anti-aliased
+ * first.\n
+ * Samples are accumulated in accumulator, so that anti-aliasing
+ * the same image again with a bigger size only computes the new
+ * samples: successive passes with increasing size cost about as
+ * much as the last one alone.\n
+ * Accumulator can be NULL, in which case samples are discarded at
+ * the end of the task. Otherwise it must not be used by any other
+ * task while this one is running, and must be reset whenever image
+ * is redrawn.\n
+ * Value buffer can be NULL (see AntiAliaseFractal).\n
+ * Cache can be NULL (see AntiAliaseFractal).
  *
  * \param image Fractal image (already drawn) to anti-aliase.
  * \param fractal Fractal subset to compute.
  * \param render Rendering parameters.
  * \param antiAliasingSize Anti-aliasing size.
  * \param threshold Dissimilarity threshold to determine pixels to recompute.
+ * \param noiseThreshold Noise below which a pixel needs no more samples (0 to disable).
  * \param floatPrecision Float precision.
- * \param cache Cache structure to put computed values in.
+ * \param cache Cache structure to look up samples in and put computed ones in.
+ * \param values Value buffer of image.
+ * \param accumulator Samples computed by previous passes on same image.
+ * \param focusX X coordinate (in image) of the point to anti-aliase first.
+ * \param focusY Y coordinate (in image) of the point to anti-aliase first.
  * \param nbThreads Number of threads that action will need to be launched.
  * \return Corresponding newly-allocated task.
  */
 Task *CreateAntiAliaseFractalTask(Image *image, const Fractal *fractal,
 					const RenderingParameters *render, uint_fast32_t antiAliasingSize,
-					double threshold, FloatPrecision floatPrecision,
-					FractalCache *cache, uint_fast32_t nbThreads);
+					double threshold, double noiseThreshold,
+					FloatPrecision floatPrecision, FractalCache *cache,
+					ValueBuffer *values, AntiAliasingAccumulator *accumulator,
+					uint_fast32_t focusX, uint_fast32_t focusY,
+					uint_fast32_t nbThreads);
+
+/**
+ * \fn void RecolorImage(Image *image, const ValueBuffer *values, const RenderingParameters *render, Threads *threads)
+ * \brief Recolor image from the fractal values it was drawn from.
+ *
+ * Value buffer must have been filled when drawing (and possibly
+ * anti-aliasing) image, and have the same size.\n
+ * Anti-aliased pixels are recolored from the values of their samples,
+ * averaged as when anti-aliasing.
+ *
+ * \param image Image to recolor.
+ * \param values Values of image pixels.
+ * \param render New rendering parameters.
+ * \param threads Threads to be used for task.
+ */
+void RecolorImage(Image *image, const ValueBuffer *values, const RenderingParameters *render,
+			Threads *threads);
+
+/**
+ * \fn Task *CreateRecolorImageTask(Image *image, const ValueBuffer *values, const RenderingParameters *render, AntiAliasingAccumulator *accumulator, uint_fast32_t nbThreads)
+ * \brief Create task recoloring image from the fractal values it was drawn from.
+ *
+ * Created task can be launched and cancelled.\n
+ * See RecolorImage.\n
+ * Accumulator can be NULL. Otherwise, it must have been filled by the
+ * same anti-aliasing tasks as value buffer, and its colors are
+ * recomputed too, so that further anti-aliasing passes go on with
+ * the new colors.
+ *
+ * \param image Image to recolor.
+ * \param values Values of image pixels.
+ * \param render New rendering parameters.
+ * \param accumulator Anti-aliasing samples of image.
+ * \param nbThreads Number of threads that task will use.
+ * \return Corresponding newly-allocated task.
+ */
+Task *CreateRecolorImageTask(Image *image, const ValueBuffer *values,
+				const RenderingParameters *render,
+				AntiAliasingAccumulator *accumulator, uint_fast32_t nbThreads);
 
 /**
  * \fn void FreeFractal(Fractal fractal)
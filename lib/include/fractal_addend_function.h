@@ -208,6 +208,25 @@ if (data->n >= m+size-1) {\
 	}\
 }\
 }
+
+#define ORBIT_DECL_VAR_AF_TRIANGLEINEQUALITY(size,fprec) \
+uint_least32_t zeros_AF[size];\
+uint_least8_t currentIndex_AF;\
+uint_least8_t previousIndex_AF;
+
+#define ORBIT_SAVE_AF_TRIANGLEINEQUALITY(size,fprec) \
+for (uint_fast32_t i = 0; i < size; ++i) {\
+	orbitData->zeros_AF[i] = data->zeros_AF[i];\
+}\
+orbitData->currentIndex_AF = data->currentIndex_AF;\
+orbitData->previousIndex_AF = data->previousIndex_AF;
+
+#define ORBIT_RESTORE_AF_TRIANGLEINEQUALITY(size,fprec) \
+for (uint_fast32_t i = 0; i < size; ++i) {\
+	data->zeros_AF[i] = orbitData->zeros_AF[i];\
+}\
+data->currentIndex_AF = orbitData->currentIndex_AF;\
+data->previousIndex_AF = orbitData->previousIndex_AF;
 /*********************************************************/
 
 /***********************AF_CURVATURE**********************/
@@ -304,6 +323,31 @@ if (data->n >= m+size) {\
 	}\
 }\
 }
+
+#define ORBIT_DECL_VAR_AF_CURVATURE(size,fprec) \
+COMPLEX_FLOATTYPE(fprec) znm1_AF;\
+COMPLEX_FLOATTYPE(fprec) znm2_AF;\
+uint_least32_t zeros_AF[size];\
+uint_least8_t currentIndex_AF;\
+uint_least8_t previousIndex_AF;
+
+#define ORBIT_SAVE_AF_CURVATURE(size,fprec) \
+cassignF(fprec, orbitData->znm1_AF, data->znm1_AF);\
+cassignF(fprec, orbitData->znm2_AF, data->znm2_AF);\
+for (uint_fast32_t i = 0; i < size; ++i) {\
+	orbitData->zeros_AF[i] = data->zeros_AF[i];\
+}\
+orbitData->currentIndex_AF = data->currentIndex_AF;\
+orbitData->previousIndex_AF = data->previousIndex_AF;
+
+#define ORBIT_RESTORE_AF_CURVATURE(size,fprec) \
+cassignF(fprec, data->znm1_AF, orbitData->znm1_AF);\
+cassignF(fprec, data->znm2_AF, orbitData->znm2_AF);\
+for (uint_fast32_t i = 0; i < size; ++i) {\
+	data->zeros_AF[i] = orbitData->zeros_AF[i];\
+}\
+data->currentIndex_AF = orbitData->currentIndex_AF;\
+data->previousIndex_AF = orbitData->previousIndex_AF;
 /*********************************************************/
 
 /************************AF_STRIPE************************/
@@ -364,6 +408,18 @@ if (data->n >= m+size-1) {\
 	}\
 }\
 }
+
+#define ORBIT_DECL_VAR_AF_STRIPE(size,fprec) \
+uint_least8_t currentIndex_AF;\
+uint_least8_t previousIndex_AF;
+
+#define ORBIT_SAVE_AF_STRIPE(size,fprec) \
+orbitData->currentIndex_AF = data->currentIndex_AF;\
+orbitData->previousIndex_AF = data->previousIndex_AF;
+
+#define ORBIT_RESTORE_AF_STRIPE(size,fprec) \
+data->currentIndex_AF = orbitData->currentIndex_AF;\
+data->previousIndex_AF = orbitData->previousIndex_AF;
 /*********************************************************/
 
 #ifdef __cplusplus
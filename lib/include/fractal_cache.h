@@ -42,7 +42,7 @@ extern "C" {
  * \def DEFAULT_FRACTAL_CACHE_SIZE
  * \brief Default fractal cache size (number of entries).
  */
-#define DEFAULT_FRACTAL_CACHE_SIZE (uint_least64_t)(300000)
+#define DEFAULT_FRACTAL_CACHE_SIZE (uint_least64_t)(1000000)
 
 /**
  * \def DEFAULT_CACHE_WEIGHT_THRESHOLD
@@ -52,44 +52,152 @@ extern "C" {
  */
 #define DEFAULT_CACHE_WEIGHT_THRESHOLD (FLOATTYPE(FP_LDOUBLE))(0.)
 
+/**
+ * \struct CacheView
+ * \brief View (fractal and image size) cache entries were computed in.
+ *
+ * Entries only store the pixel they were computed at, and a view
+ * identifier : their full precision coordinates are given by the
+ * view.\n
+ * Views are shared by all entries computed in the same view, and are
+ * recycled once no entry nor insertion buffer refers to them.
+ */
+/**
+ * \typedef CacheView
+ * \brief Convenient typedef for struct CacheView.
+ */
+typedef struct CacheView {
+	BiggestFloat x1;
+ /*!< x coordinate of view top-left corner.*/
+	BiggestFloat y1;
+ /*!< y coordinate of view top-left corner.*/
+	BiggestFloat spanX;
+ /*!< View x span.*/
+	BiggestFloat spanY;
+ /*!< View y span.*/
+	uint_fast32_t width;
+ /*!< Width of image (in pixels) computed in view.*/
+	uint_fast32_t height;
+ /*!< Height of image (in pixels) computed in view.*/
+	double x1d;
+ /*!< x1 rounded to double.*/
+	double y1d;
+ /*!< y1 rounded to double.*/
+	double pixelSpanXd;
+ /*!< Pixel x span rounded to double.*/
+	double pixelSpanYd;
+ /*!< Pixel y span rounded to double.*/
+	uint_least64_t nbEntries;
+ /*!< Number of cache entries in view.*/
+	uint_fast32_t nbUsers;
+ /*!< Number of insertion buffers adding entries in view.*/
+} CacheView;
+
 /**
  * \struct CacheEntry
  * \brief Cache entry.
+ *
+ * Entry was computed at center of pixel (x,y) of its view.
  */
 /**
  * \typedef CacheEntry
  * \brief Convenient typedef for struct CacheEntry.
  */
 typedef struct CacheEntry {
-	FloatPrecision floatPrecision;
- /*!< Float precision for x and y values.*/
-	MultiFloat x;
- /*!< x coordinate.*/
-	MultiFloat y;
- /*!< y coordinate.*/
-	double value;
- /*!< Value at point (x,y).*/
+	uint_least32_t view;
+ /*!< Index of entry view in cache views.*/
+	uint_least32_t x;
+ /*!< Pixel x coordinate in view.*/
+	uint_least32_t y;
+ /*!< Pixel y coordinate in view.*/
+	float value;
+ /*!< Value at pixel (x,y).*/
 } CacheEntry;
 
+/**
+ * \def CACHE_BLOCK_SIZE
+ * \brief Number of consecutive cache entries sharing a bounding box.
+ */
+#define CACHE_BLOCK_SIZE (uint_fast32_t)(256)
+
+/**
+ * \struct CacheBlockBounds
+ * \brief Bounding box of a block of consecutive cache entries.
+ *
+ * Bounds are rounded to double, which is enough to skip blocks lying
+ * outside of a view (rounding preserves order).\n
+ * Consecutive entries were computed close to each other in time, so
+ * they generally are close to each other in space too.
+ */
+/**
+ * \typedef CacheBlockBounds
+ * \brief Convenient typedef for struct CacheBlockBounds.
+ */
+typedef struct CacheBlockBounds {
+	double minX;
+ /*!< Minimum x coordinate of block entries.*/
+	double maxX;
+ /*!< Maximum x coordinate of block entries.*/
+	double minY;
+ /*!< Minimum y coordinate of block entries.*/
+	double maxY;
+ /*!< Maximum y coordinate of block entries.*/
+} CacheBlockBounds;
+
+/**
+ * \def CACHE_BLOCK_MAX_USAGE
+ * \brief Maximum usage count of a cache block.
+ */
+#define CACHE_BLOCK_MAX_USAGE (uint_fast32_t)(3)
+
+/**
+ * \struct CacheBlock
+ * \brief Block of CACHE_BLOCK_SIZE consecutive cache entries.
+ *
+ * Cache blocks are evicted following a CLOCK policy : when cache is
+ * full, the clock hand skips (and decrements usage of) blocks that
+ * were used since it last went past them, so that entries around
+ * current and recently previewed regions are kept.\n
+ * Block usage is reset when block starts being filled with new
+ * entries, and incremented (up to CACHE_BLOCK_MAX_USAGE) each time
+ * some of its entries are used for a preview.
+ */
+/**
+ * \typedef CacheBlock
+ * \brief Convenient typedef for struct CacheBlock.
+ */
+typedef struct CacheBlock {
+	CacheBlockBounds bounds;
+ /*!< Bounding box of block entries.*/
+	uint_fast32_t usage;
+ /*!< Usage count of block (for eviction).*/
+} CacheBlock;
+
 /**
  * \struct ArrayValue
  * \brief Type of cache array elements.
+ *
+ * Sums are single precision : array is only used for previews.
  */
 /**
  * \typedef ArrayValue
  * \brief Convenient typedef for struct ArrayValue.
  */
 typedef struct ArrayValue {
-	uint_fast32_t state;
+	uint_least32_t state;
  /*!< Value state, used to test validity.*/
-	double r;
+	float r;
  /*!< Sum of weighted red values.*/
-	double g;
+	float g;
  /*!< Sum of weighted green values.*/
-	double b;
+	float b;
  /*!< Sum of weighted blue values.*/
-	double totalWeight;
+	float totalWeight;
  /*!< Total weight.*/
+	float value;
+ /*!< Fractal value of the entry with the biggest weight.*/
+	float valueWeight;
+ /*!< Weight of that entry.*/
 } ArrayValue;
 
 struct Fractal;
@@ -110,11 +218,13 @@ struct Fractal;
 typedef struct FractalCache {
 	int firstUse;
  /*!< Indicates whether or not cache has already been used.*/
+	int readOnly;
+ /*!< If set, entries are looked up but no entry is added (0 by default).*/
 	struct Fractal *fractal;
  /*!< Current fractal cached.*/
 	RenderingParameters *render;
  /*!< Current rendering parameters cached.*/
-	uint_fast32_t currentState;
+	uint_least32_t currentState;
  /*!< Current cache state (used for testing array values validity.*/
 	uint_least64_t nbInitialized;
  /*!< Number of entries already initialized (if cache is not full yet).*/
@@ -122,8 +232,22 @@ typedef struct FractalCache {
  /*!< Cache size (total number of entries it can contain).*/
 	CacheEntry *entry;
  /*!< Array of entries.*/
+	uint_fast32_t nbViews;
+ /*!< Number of views (used or not).*/
+	CacheView *view;
+ /*!< Array of views.*/
+	CacheBlock *block;
+ /*!< Blocks of CACHE_BLOCK_SIZE entries.*/
+	uint_least64_t indexMask;
+ /*!< Lookup index size minus one (size is a power of 2).*/
+	uint_least64_t *index;
+ /*!< Lookup index (lossy) : index of last entry added per (view, x, y) hash.*/
 	uint_least64_t currentIndex;
  /*!< Current entry index.*/
+	uint_least64_t nbPreviewLookups;
+ /*!< Number of entries looked up for previews.*/
+	uint_least64_t nbPreviewHits;
+ /*!< Number of entries looked up for previews that were inside preview.*/
 	uint_fast32_t arrayWidth;
  /*!< Array width.*/
 	uint_fast32_t arrayHeight;
@@ -136,6 +260,36 @@ typedef struct FractalCache {
  /*!< Mutex for cache entries.*/
 } FractalCache;
 
+/**
+ * \def CACHE_INSERTION_BUFFER_SIZE
+ * \brief Number of entries a cache insertion buffer holds before being flushed.
+ */
+#define CACHE_INSERTION_BUFFER_SIZE (uint_fast32_t)(256)
+
+/**
+ * \struct CacheInsertionBuffer
+ * \brief Per-thread buffer of entries to be added to cache.
+ *
+ * Threads computing fractal values gather their entries in their own
+ * insertion buffer, which is added to cache in one go when full, so
+ * that cache entries mutex is taken once per buffer instead of once
+ * per entry.
+ */
+/**
+ * \typedef CacheInsertionBuffer
+ * \brief Convenient typedef for struct CacheInsertionBuffer.
+ */
+typedef struct CacheInsertionBuffer {
+	FractalCache *cache;
+ /*!< Cache entries are to be added to.*/
+	uint_least32_t view;
+ /*!< View of buffered entries.*/
+	uint_fast32_t nbEntries;
+ /*!< Number of entries in buffer.*/
+	CacheEntry *entry;
+ /*!< Buffered entries.*/
+} CacheInsertionBuffer;
+
 /**
  * \fn int CreateFractalCache(FractalCache *cache, uint_least64_t size)
  * \brief Create fractal cache.
@@ -164,6 +318,7 @@ int ResizeCacheThreadSafe(FractalCache *cache, uint_least64_t size);
  * \fn void AddToCache(FractalCache *cache, CacheEntry entry)
  * \brief Add entry to cache.
  *
+ * Entry view must be in use (by an insertion buffer, typically).\n
  * This function is not thread-safe (like most of the
  * functions in this library).\n
  * \see AddToCacheThreadSafe
@@ -177,6 +332,7 @@ void AddToCache(FractalCache *cache, CacheEntry entry);
  * \fn void AddToCacheThreadSafe(FractalCache *cache, CacheEntry)
  * \brief Add entry to cache (thread-safe).
  *
+ * Entry view must be in use (by an insertion buffer, typically).\n
  * This function is thread-safe (unlike most of the
  * functions in this library).\n
  * \see AddToCache
@@ -186,6 +342,80 @@ void AddToCache(FractalCache *cache, CacheEntry entry);
  */
 void AddToCacheThreadSafe(FractalCache *cache, CacheEntry entry);
 
+/**
+ * \fn void CreateCacheInsertionBuffer(CacheInsertionBuffer *buffer, FractalCache *cache, const struct Fractal *fractal, uint_fast32_t width, uint_fast32_t height)
+ * \brief Create insertion buffer for cache.
+ *
+ * Entries added to buffer are pixels of an image of size width x height
+ * representing fractal.\n
+ * Buffer keeps that view in use until it is freed.
+ *
+ * \param buffer Pointer to insertion buffer structure to initialize.
+ * \param cache Pointer to cache.
+ * \param fractal Fractal entries are computed for.
+ * \param width Width of image entries are computed for.
+ * \param height Height of image entries are computed for.
+ */
+void CreateCacheInsertionBuffer(CacheInsertionBuffer *buffer, FractalCache *cache,
+				const struct Fractal *fractal, uint_fast32_t width,
+				uint_fast32_t height);
+
+/**
+ * \fn void AddToCacheInsertionBuffer(CacheInsertionBuffer *buffer, uint_fast32_t x, uint_fast32_t y, double value)
+ * \brief Add entry to insertion buffer.
+ *
+ * Buffer is flushed (thread-safe) when full.\n
+ * Entry is dropped if cache is read-only.\n
+ * An insertion buffer must not be shared between threads.
+ *
+ * \param buffer Pointer to insertion buffer.
+ * \param x Pixel x coordinate.
+ * \param y Pixel y coordinate.
+ * \param value Fractal value at pixel (x,y).
+ */
+void AddToCacheInsertionBuffer(CacheInsertionBuffer *buffer, uint_fast32_t x,
+				uint_fast32_t y, double value);
+
+/**
+ * \fn uint_fast32_t FindInCache(CacheInsertionBuffer *buffer, uint_fast32_t nbPixels, const uint_fast32_t *x, const uint_fast32_t *y, double *value, int *found)
+ * \brief Look up values of several pixels in cache (thread-safe).
+ *
+ * Look up entries at pixels (x[i],y[i]) of insertion buffer view.\n
+ * Cache entries mutex is taken once for all pixels, so pixels should
+ * be looked up together rather than one by one (all samples of an
+ * anti-aliased pixel, for example).\n
+ * Lookup may fail even though entry was added to cache (lookup index
+ * is lossy), and never finds entries still in insertion buffer.\n
+ * Found entries count as used for eviction.
+ *
+ * \param buffer Pointer to insertion buffer (giving view).
+ * \param nbPixels Number of pixels to look up.
+ * \param x Pixels x coordinates.
+ * \param y Pixels y coordinates.
+ * \param value Values to set for pixels that are found.
+ * \param found Set to 1 for pixels that are found, 0 otherwise.
+ * \return Number of pixels found.
+ */
+uint_fast32_t FindInCache(CacheInsertionBuffer *buffer, uint_fast32_t nbPixels,
+				const uint_fast32_t *x, const uint_fast32_t *y, double *value,
+				int *found);
+
+/**
+ * \fn void FlushCacheInsertionBuffer(CacheInsertionBuffer *buffer)
+ * \brief Add entries of insertion buffer to cache (thread-safe).
+ *
+ * \param buffer Pointer to insertion buffer.
+ */
+void FlushCacheInsertionBuffer(CacheInsertionBuffer *buffer);
+
+/**
+ * \fn void FreeCacheInsertionBuffer(CacheInsertionBuffer *buffer)
+ * \brief Flush and free insertion buffer.
+ *
+ * \param buffer Pointer to insertion buffer to free.
+ */
+void FreeCacheInsertionBuffer(CacheInsertionBuffer *buffer);
+
 /**
  * \fn ArrayValue GetArrayValue(FractalCache *cache, uint_fast32_t x, uint_fast32_t y)
  * \brief Get value from cache array.
@@ -234,6 +464,23 @@ int isArrayValueValid(ArrayValue aVal, FractalCache *cache);
  */
 Color GetColorFromAVal(ArrayValue aVal, const RenderingParameters *render);
 
+/**
+ * \fn int isCacheUsable(const FractalCache *cache, const struct Fractal *fractal, const RenderingParameters *render)
+ * \brief Check whether cache entries are valid for fractal.
+ *
+ * Cache entries are valid if they were computed with the same fractal
+ * formula and parameters, and the same rendering parameters (except
+ * color related parameters), i.e. if last cache preview was made for
+ * such a fractal.
+ *
+ * \param cache Cache.
+ * \param fractal Fractal.
+ * \param render Rendering parameters.
+ * \return 1 if cache entries are valid for fractal, 0 otherwise.
+ */
+int isCacheUsable(const FractalCache *cache, const struct Fractal *fractal,
+			const RenderingParameters *render);
+
 /**
  * \fn Task *CreateFractalCachePreviewTask(Image *dst, FractalCache *cache, const struct Fractal *fractal, const RenderingParameters *render, int fillImageOnTheFly, uint_fast32_t nbThreads)
  * \brief Create task generating an image preview from cache.
@@ -279,20 +526,46 @@ void FractalCachePreview(Image *dst, FractalCache *cache, const struct Fractal *
 				Threads *threads);
 
 /**
- * \fn void FreeFractalCache(FractalCache *cache)
- * \brief Free fractal cache.
+ * \fn int ReadFractalCacheFile(FractalCache *cache, const char *fileName)
+ * \brief Read fractal cache file.
  *
- * \param cache Pointer to cache structure to be free'd.
+ * Cache is reset for the fractal and rendering parameters of the
+ * file (see isCacheUsable), and filled with its entries.\n
+ * If file has more entries than cache size, only the most recent
+ * ones are kept.\n
+ * Cache must not be used by any task while reading file.
+ *
+ * \param cache Cache to fill.
+ * \param fileName Cache file name.
+ * \return 0 in case of success, 1 in case of failure.
  */
-void FreeFractalCache(FractalCache *cache);
+int ReadFractalCacheFile(FractalCache *cache, const char *fileName);
+
+/**
+ * \fn int WriteFractalCacheFile(const FractalCache *cache, const char *fileName)
+ * \brief Write fractal cache file.
+ *
+ * File contains fractal and rendering parameters of cache entries,
+ * followed by entries themselves (in binary form, so cache files
+ * are not portable between platforms).\n
+ * File is written under a temporary name, and then renamed, so that
+ * processes reading it at the same time never see it partially
+ * written.\n
+ * Cache must not be used by any task while writing file.
+ *
+ * \param cache Cache to write.
+ * \param fileName Cache file name.
+ * \return 0 in case of success, 1 in case of failure.
+ */
+int WriteFractalCacheFile(const FractalCache *cache, const char *fileName);
 
 /**
- * \fn void FreeCacheEntry(CacheEntry entry)
- * \brief Free a cache entry.
+ * \fn void FreeFractalCache(FractalCache *cache)
+ * \brief Free fractal cache.
  *
- * \param entry CacheEntry structure to be freed.
+ * \param cache Pointer to cache structure to be free'd.
  */
-void FreeCacheEntry(CacheEntry entry);
+void FreeFractalCache(FractalCache *cache);
 
 #ifdef __cplusplus
 }
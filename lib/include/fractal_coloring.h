@@ -175,6 +175,14 @@ ENGINE_CLEAR_VAR_##iterationcount(fprec)
 
 #define LOOP_END_CM_ITERATIONCOUNT(iterationcount,addend,interpolation,fprec) \
 COMPUTE_##iterationcount(fprec);\
+
+#define ORBIT_DECL_VAR_CM_ITERATIONCOUNT(iterationcount,addend,interpolation,fprec)
+
+#define ORBIT_SAVE_CM_ITERATIONCOUNT(iterationcount,addend,interpolation,fprec) \
+(void)NULL;
+
+#define ORBIT_RESTORE_CM_ITERATIONCOUNT(iterationcount,addend,interpolation,fprec) \
+(void)NULL;
 /*********************************************************/
 
 /********************CM_AVERAGECOLORING*******************/
@@ -195,6 +203,15 @@ LOOP_ITERATION_##interpolation(addend,fprec)
 
 #define LOOP_END_CM_AVERAGECOLORING(iterationcount,addend,interpolation,fprec) \
 LOOP_END_##interpolation(addend,fprec)
+
+#define ORBIT_DECL_VAR_CM_AVERAGECOLORING(iterationcount,addend,interpolation,fprec) \
+ORBIT_DECL_VAR_##interpolation(addend,fprec)
+
+#define ORBIT_SAVE_CM_AVERAGECOLORING(iterationcount,addend,interpolation,fprec) \
+ORBIT_SAVE_##interpolation(addend,fprec)
+
+#define ORBIT_RESTORE_CM_AVERAGECOLORING(iterationcount,addend,interpolation,fprec) \
+ORBIT_RESTORE_##interpolation(addend,fprec)
 /*********************************************************/
 
 /*************************IM_NONE*************************/
@@ -219,6 +236,18 @@ LOOP_ITERATION_##addend(1,fprec)
 #define LOOP_END_IM_NONE(addend,fprec) \
 LOOP_END_##addend(1,fprec)\
 assignF(fprec,data->res,data->SN_IM[0]);
+
+#define ORBIT_DECL_VAR_IM_NONE(addend,fprec) \
+FLOATTYPE(fprec) SN_IM[1];\
+ORBIT_DECL_VAR_##addend(1,fprec)
+
+#define ORBIT_SAVE_IM_NONE(addend,fprec) \
+assignF(fprec,orbitData->SN_IM[0],data->SN_IM[0]);\
+ORBIT_SAVE_##addend(1,fprec)
+
+#define ORBIT_RESTORE_IM_NONE(addend,fprec) \
+assignF(fprec,data->SN_IM[0],orbitData->SN_IM[0]);\
+ORBIT_RESTORE_##addend(1,fprec)
 /*********************************************************/
 
 /************************IM_LINEAR************************/
@@ -256,6 +285,20 @@ sub_uiF(fprec, data->tmp_IM, data->res, 1);\
 mulF(fprec, data->tmp_IM, data->tmp_IM, data->SN_IM[1]);\
 mulF(fprec, data->res, data->res, data->SN_IM[0]);\
 subF(fprec, data->res, data->res, data->tmp_IM);
+
+#define ORBIT_DECL_VAR_IM_LINEAR(addend,fprec) \
+FLOATTYPE(fprec) SN_IM[2];\
+ORBIT_DECL_VAR_##addend(2,fprec)
+
+#define ORBIT_SAVE_IM_LINEAR(addend,fprec) \
+assignF(fprec,orbitData->SN_IM[0],data->SN_IM[0]);\
+assignF(fprec,orbitData->SN_IM[1],data->SN_IM[1]);\
+ORBIT_SAVE_##addend(2,fprec)
+
+#define ORBIT_RESTORE_IM_LINEAR(addend,fprec) \
+assignF(fprec,data->SN_IM[0],orbitData->SN_IM[0]);\
+assignF(fprec,data->SN_IM[1],orbitData->SN_IM[1]);\
+ORBIT_RESTORE_##addend(2,fprec)
 /*********************************************************/
 
 /************************IM_SPLINE************************/
@@ -339,6 +382,22 @@ addF(fprec,data->res,data->res,data->s1_IM);\
 addF(fprec,data->res,data->res,data->s2_IM);\
 addF(fprec,data->res,data->res,data->s3_IM);\
 div_uiF(fprec,data->res,data->res,2);
+
+#define ORBIT_DECL_VAR_IM_SPLINE(addend,fprec) \
+FLOATTYPE(fprec) SN_IM[4];\
+ORBIT_DECL_VAR_##addend(4,fprec)
+
+#define ORBIT_SAVE_IM_SPLINE(addend,fprec) \
+for (uint_fast32_t i = 0; i < 4; ++i) {\
+	assignF(fprec,orbitData->SN_IM[i],data->SN_IM[i]);\
+}\
+ORBIT_SAVE_##addend(4,fprec)
+
+#define ORBIT_RESTORE_IM_SPLINE(addend,fprec) \
+for (uint_fast32_t i = 0; i < 4; ++i) {\
+	assignF(fprec,data->SN_IM[i],orbitData->SN_IM[i]);\
+}\
+ORBIT_RESTORE_##addend(4,fprec)
 /*********************************************************/
 
 #ifdef __cplusplus
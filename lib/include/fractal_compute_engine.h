@@ -46,26 +46,27 @@ struct Fractal;
  * \brief Engine to compute fractal engine (specific compiled loop and data).
  *
  * A FractalEngine structure contains a pointer to a function that computes
- * fractal for given parameters efficiently, as well as all the data it needs.\n
- *
- * The cache entry returned by fractal loop can be added to a cache, in which
- * case it will be free'd automatically (when new entries come, or when cache
- * is free'd), or just free'd if cache is disabled.
+ * fractal for given parameters efficiently, as well as all the data it needs.
  */
 /**
  * \typedef FractalEngine
  * \brief Convenient typedef for struct FractalEngine.
  */
 typedef struct FractalEngine {
-	CacheEntry (*fractalLoop)(void *data, const struct Fractal *fractal,
+	double (*fractalLoop)(void *data, const struct Fractal *fractal,
 				const RenderingParameters *render,
 				uint_fast32_t x, uint_fast32_t y,
-				uint_fast32_t width, uint_fast32_t height);
+				uint_fast32_t width, uint_fast32_t height,
+				void *orbit, int resume);
 	/*!< Fractal loop function.*/
 	void (*freeEngineData)(void *data);
 	/*!< Function to free engine data.*/
 	void *data;
 	/*!< Engine data (used by fractal loop).*/
+	size_t orbitSize;
+	/*!< Size of orbit state saved by fractal loop (0 if orbits cannot be saved).*/
+	ColorMap colorMap;
+	/*!< Color map for fractal values computed by engine.*/
 } FractalEngine;
 
 /**
@@ -90,11 +91,10 @@ int CreateFractalEngine(FractalEngine *engine, const struct Fractal *fractal,
 void FreeFractalEngine(FractalEngine *engine);
 
 /**
- * \fn CacheEntry RunFractalEngine(const FractalEngine *engine, const struct Fractal *fractal, const RenderingParameters *render, uint_fast32_t x, uint_fast32_t y, uint_fast32_t width, uint_fast32_t height)
+ * \fn double RunFractalEngine(const FractalEngine *engine, const struct Fractal *fractal, const RenderingParameters *render, uint_fast32_t x, uint_fast32_t y, uint_fast32_t width, uint_fast32_t height)
  * \brief Run fractal engine at given point.
  *
  * Compute pixel (x,y) of an image of size (width, height).
- * \see CacheEntry
  *
  * \param engine Fractal engine to be run.
  * \param fractal Fractal to be computed.
@@ -103,12 +103,40 @@ void FreeFractalEngine(FractalEngine *engine);
  * \param y Pixel Y coordinate.
  * \param width Image width.
  * \param height Image height.
- * \return Cache entry that can be added to cache or just used and free'd.
+ * \return Fractal value at pixel (x,y).
  */
-CacheEntry RunFractalEngine(const FractalEngine *engine, const struct Fractal *fractal,
+double RunFractalEngine(const FractalEngine *engine, const struct Fractal *fractal,
 			const RenderingParameters *render, uint_fast32_t x, uint_fast32_t y,
 			uint_fast32_t width, uint_fast32_t height);
 
+/**
+ * \fn double RunFractalEngineOrbit(const FractalEngine *engine, const struct Fractal *fractal, const RenderingParameters *render, uint_fast32_t x, uint_fast32_t y, uint_fast32_t width, uint_fast32_t height, void *orbit, int resume)
+ * \brief Run fractal engine at given point, saving or resuming orbit.
+ *
+ * If resume is not 0, iteration goes on from orbit state (saved by
+ * a previous run for the same pixel with a lower maximum number of
+ * iterations) instead of starting from scratch.\n
+ * If point does not escape, its orbit state is saved in orbit, so
+ * that it can be resumed later with a higher maximum number of
+ * iterations.\n
+ * Orbit must point to orbitSize bytes of engine, and must be NULL
+ * (with resume set to 0) if orbitSize is 0.
+ *
+ * \param engine Fractal engine to be run.
+ * \param fractal Fractal to be computed.
+ * \param render Rendering parameters.
+ * \param x Pixel X coordinate.
+ * \param y Pixel Y coordinate.
+ * \param width Image width.
+ * \param height Image height.
+ * \param orbit Orbit state to resume from and save to (can be NULL).
+ * \param resume 1 if computation must go on from orbit state, 0 otherwise.
+ * \return Fractal value at pixel (x,y).
+ */
+double RunFractalEngineOrbit(const FractalEngine *engine, const struct Fractal *fractal,
+			const RenderingParameters *render, uint_fast32_t x, uint_fast32_t y,
+			uint_fast32_t width, uint_fast32_t height, void *orbit, int resume);
+
 #ifdef __cplusplus
 }
 #endif
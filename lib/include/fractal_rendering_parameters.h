@@ -81,6 +81,69 @@ typedef struct RenderingParameters {
  /*!< Real offset (scaled according to gradient size).*/
 } RenderingParameters;
 
+/**
+ * \def COLOR_MAP_CELL_BITS
+ * \brief Log2 of number of color map cells per power of two of (1+value).
+ */
+#define COLOR_MAP_CELL_BITS (10)
+
+/**
+ * \def COLOR_MAP_MAX_ERROR
+ * \brief Maximum interpolation error (in gradient entries) of color map cells.
+ *
+ * Values falling in cells that are less accurate than that are mapped
+ * by evaluating transfer function directly.
+ */
+#define COLOR_MAP_MAX_ERROR (double)(0.125)
+
+/**
+ * \struct ColorMapCell
+ * \brief Cell of a color map.
+ */
+/**
+ * \typedef ColorMapCell
+ * \brief Convenient typedef for struct ColorMapCell.
+ */
+typedef struct ColorMapCell {
+	double position;
+ /*!< Gradient position of first value of cell.*/
+	double slope;
+ /*!< Gradient position increase per unit in last place of (1+value).*/
+	double error;
+ /*!< Bound of interpolation error (in gradient entries) in cell.*/
+	int exact;
+ /*!< 1 if values of cell must be mapped directly, 0 if they can be interpolated.*/
+} ColorMapCell;
+
+/**
+ * \struct ColorMap
+ * \brief Table mapping fractal values to colors.
+ *
+ * A color map fuses transfer function, multiplier, offset and gradient
+ * of rendering parameters into a piecewise linear table.\n
+ * Cells are spaced uniformly inside each power of two of (1+value), so
+ * that a value's cell is given by the top bits of its floating point
+ * representation, and transfer functions with strong curvature near 0
+ * (logarithms, cube root) are still sampled finely enough.\n
+ * Values beyond the table, values in cells where interpolation would
+ * be off by more than COLOR_MAP_MAX_ERROR gradient entries, and values
+ * whose interpolated position is within interpolation error of the
+ * boundary of a gradient entry, are mapped the usual way, so that
+ * colors are exactly those of direct evaluation.
+ */
+/**
+ * \typedef ColorMap
+ * \brief Convenient typedef for struct ColorMap.
+ */
+typedef struct ColorMap {
+	const RenderingParameters *render;
+ /*!< Rendering parameters the color map was built for.*/
+	uint_fast32_t nbCells;
+ /*!< Number of cells.*/
+	ColorMapCell *cells;
+ /*!< Cells.*/
+} ColorMap;
+
 /**
  * \fn void InitRenderingParameters(RenderingParameters *param, uint_fast8_t bytesPerComponent, Color spaceColor, IterationCount iterationCount, ColoringMethod coloringMethod, AddendFunction addendFunction, uint_fast32_t stripeDensity, InterpolationMethod interpolationMethod, TransferFunction transferFunction, double multiplier, double offset, Gradient gradient)
  * \brief Initialize rendering parameters.
@@ -118,6 +181,21 @@ void InitRenderingParameters(RenderingParameters *param, uint_fast8_t bytesPerCo
  */
 RenderingParameters CopyRenderingParameters(const RenderingParameters *param);
 
+/**
+ * \fn int PartCompareRenderingParameters(const RenderingParameters *param1, const RenderingParameters *param2)
+ * \brief Compare the rendering parameters fractal values depend on.
+ *
+ * Parameters that only change the way values are mapped to colors
+ * (gradient, transfer function, multiplier and offset) are not
+ * compared.
+ *
+ * \param param1 First rendering parameters.
+ * \param param2 Second rendering parameters.
+ * \return 0 if those parameters are equal, 1 otherwise.
+ */
+int PartCompareRenderingParameters(const RenderingParameters *param1,
+					const RenderingParameters *param2);
+
 /**
  * \fn void ResetGradient(RenderingParameters *param, Gradient gradient)
  * \brief Reset gradient.
@@ -195,6 +273,51 @@ int WriteRenderingFileBody(const RenderingParameters *param, const char *fileNam
  */
 int WriteRenderingFile(const RenderingParameters *param, const char *fileName);
 
+/**
+ * \fn void CreateColorMap(ColorMap *colorMap, const RenderingParameters *render, double maxValue)
+ * \brief Create color map for rendering parameters.
+ *
+ * Rendering parameters must not be changed or free'd as long as
+ * color map is in use.
+ *
+ * \param colorMap Pointer to color map structure to initialize.
+ * \param render Rendering parameters.
+ * \param maxValue Upper bound of values to be tabulated.
+ */
+void CreateColorMap(ColorMap *colorMap, const RenderingParameters *render, double maxValue);
+
+/**
+ * \fn Color GetColorMapColor(const ColorMap *colorMap, double value)
+ * \brief Get color of fractal value.
+ *
+ * Negative values are mapped to space color.
+ *
+ * \param colorMap Color map.
+ * \param value Fractal value.
+ * \return Color of value.
+ */
+Color GetColorMapColor(const ColorMap *colorMap, double value);
+
+/**
+ * \fn void GetColorMapColors(const ColorMap *colorMap, const double *values, Color *colors, uint_fast32_t nbValues)
+ * \brief Get colors of a span of fractal values.
+ *
+ * \param colorMap Color map.
+ * \param values Fractal values.
+ * \param colors Colors destination (nbValues colors).
+ * \param nbValues Number of values.
+ */
+void GetColorMapColors(const ColorMap *colorMap, const double *values, Color *colors,
+			uint_fast32_t nbValues);
+
+/**
+ * \fn void FreeColorMap(ColorMap *colorMap)
+ * \brief Free color map.
+ *
+ * \param colorMap Pointer to color map to be free'd.
+ */
+void FreeColorMap(ColorMap *colorMap);
+
 /**
  * \fn void FreeRenderingParameters(RenderingParameters param)
  * \brief Free a RenderingParameters structure.
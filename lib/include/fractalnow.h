@@ -50,6 +50,7 @@
 #include "uirectangle.h"
 #include "task.h"
 #include "thread.h"
+#include "tile_cache.h"
 
 #ifdef __cplusplus
 extern "C" {
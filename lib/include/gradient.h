@@ -47,12 +47,36 @@ extern "C" {
  */
 #define DEFAULT_GRADIENT_SIZE (uint_fast32_t)(200000)
 
+/**
+ * \struct GradientSegment
+ * \brief Linear transition between two colors of a gradient.
+ */
+/**
+ * \typedef GradientSegment
+ * \brief Convenient typedef for struct GradientSegment.
+ */
+typedef struct GradientSegment {
+	uint_fast64_t begin;
+ /*!< Index of first color of segment in gradient.*/
+	uint_fast64_t end;
+ /*!< Index of last color of segment in gradient.*/
+	double invLength;
+ /*!< 1/(end-begin), or 0 if segment is a single color.*/
+	Color C1;
+ /*!< Color at the beginning of segment.*/
+	Color C2;
+ /*!< Color at the end of segment.*/
+} GradientSegment;
+
 /**
  * \struct Gradient
  * \brief Simple gradient structure.
  *
  * This structure is to represent a gradient, i.e. continous
- * transitions between colors.
+ * transitions between colors.\n
+ * Colors are not stored but computed from the segments between
+ * stops, which are few enough to stay in L1 cache whatever the
+ * gradient size.
  */
 /**
  * \typedef Gradient
@@ -63,8 +87,12 @@ typedef struct Gradient {
  /*!< Colors bytes per component.*/
 	uint_fast64_t size;
  /*!< Gradient size (total number of colors).*/
-	Color *data;
- /*!< Gradient data.*/
+	uint_fast64_t sizeReciprocal;
+ /*!< Fixed-point reciprocal of size (to compute index mod size without division).*/
+	uint_fast32_t nbSegments;
+ /*!< Number of segments (nbStops-1).*/
+	GradientSegment *segments;
+ /*!< Segments between consecutive stops.*/
 	uint_fast32_t nbStops;
  /*!< Number of stops i.e. (pos,color) pairs used to build the gradient.*/
 	double *positionStop;
@@ -214,8 +242,9 @@ Gradient Gradient8(const Gradient *gradient);
  * \fn Color GetGradientColor(const Gradient *gradient, uint_fast64_t index)
  * \brief Get a color in the gradient.
  *
- * Get the color in gradient at position index mod gradient_size
- * 
+ * Get the color in gradient at position index mod gradient_size.\n
+ * Color is the same as if gradient colors were all stored, but it is
+ * interpolated from the segment index falls in.
  * \param gradient Pointer to the gradient to get the color from.
  * \param index (mod.) Index of the color to get.
  * \return Color in gradient at position (index mod gradient_size).
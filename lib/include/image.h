@@ -36,6 +36,14 @@
 extern "C" {
 #endif
 
+/**
+ * \def RECURSIVE_GAUSSIAN_BLUR_MIN_RADIUS
+ * \brief Blur radius from which a recursive gaussian filter is used.
+ *
+ * Below that radius, convolution is both exact and fast enough.
+ */
+#define RECURSIVE_GAUSSIAN_BLUR_MIN_RADIUS (double)(9)
+
 /**
  * \struct Image
  * \brief Simple RGB image.
@@ -123,6 +131,21 @@ Image CloneImage(const Image *image);
  */
 uint8_t *ImageToBytesArray(const Image *image);
 
+/**
+ * \fn void ImageRowsToBytes(uint8_t *dst, const Image *image, uint_fast32_t y, uint_fast32_t nbRows)
+ * \brief Convert rows of image to bytes.
+ *
+ * Same format as ImageToBytesArray, for rows y to y+nbRows-1 only.\n
+ * Destination must hold width*nbRows*3*bytesPerComponent bytes.
+ *
+ * \param dst Bytes array to write rows in.
+ * \param image Image to convert rows of.
+ * \param y First row to convert.
+ * \param nbRows Number of rows to convert.
+ */
+void ImageRowsToBytes(uint8_t *dst, const Image *image, uint_fast32_t y,
+			uint_fast32_t nbRows);
+
 /**
  * \fn Color iGetPixelUnsafe(const Image *image, uint_fast32_t x, uint_fast32_t y)
  * \brief Get some pixel of image.
@@ -176,7 +199,9 @@ void PutPixelUnsafe(Image *image, uint_fast32_t x, uint_fast32_t y, Color color)
  *
  * This function does no work in place.\n
  * Applies successively a horizontal and vertical gaussian filter
- * to avoid quadratic computation cost.
+ * to avoid quadratic computation cost.\n
+ * From RECURSIVE_GAUSSIAN_BLUR_MIN_RADIUS, a recursive gaussian
+ * filter is used instead, whose cost does not depend on radius.
  *
  * \param dst Pointer to already created destination image.
  * \param src Pointer to source image (to apply blur on).
@@ -28,24 +28,114 @@
 #define __PPM_H__
 
 #include "image.h"
+#include "thread.h"
 #include  <stdint.h>
+#include  <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * \fn int ExportPPM(const char *fileName, const Image *image)
+ * \def PPM_CHUNK_SIZE
+ * \brief Approximate size (in bytes) of chunks of PPM rows.
+ *
+ * Rows are converted and written by chunks of that size (at least
+ * one row), each thread converting its own chunk while another one
+ * is being written.
+ */
+#define PPM_CHUNK_SIZE (size_t)(1048576)
+
+/**
+ * \fn int ExportPPM(const char *fileName, const Image *image, Threads *threads)
  * \brief Export image as PPM;
  *
  * If file specified by fileName already exists, it will
- * be overwritten.
+ * be overwritten.\n
+ * Image is not copied : rows are converted by chunks (in parallel)
+ * and written as they are converted (see WritePPMRows).
  *
  * \param fileName Name of the PPM file to export the image in.
  * \param image Pointer to image structure to export.
+ * \param threads Threads to be used for conversion.
  * \return 0 in case of success, 0 in case of error.
  */
-int ExportPPM(const char *fileName, const Image *image);
+int ExportPPM(const char *fileName, const Image *image, Threads *threads);
+
+/**
+ * \struct PPMWriter
+ * \brief PPM file written progressively, a few rows at a time.
+ *
+ * Lets an image be exported without ever being entirely in memory.
+ */
+/**
+ * \typedef PPMWriter
+ * \brief Convenient typedef for struct PPMWriter.
+ */
+typedef struct PPMWriter {
+	const char *fileName;
+ /*!< Name of PPM file.*/
+	FILE *file;
+ /*!< PPM file.*/
+	uint_fast32_t width;
+ /*!< Image width.*/
+	uint_fast32_t height;
+ /*!< Image height.*/
+	uint_fast8_t bytesPerComponent;
+ /*!< Colors bytes per component.*/
+	uint_fast32_t nbRows;
+ /*!< Number of rows written so far.*/
+} PPMWriter;
+
+/**
+ * \fn int OpenPPMWriter(PPMWriter *writer, const char *fileName, uint_fast32_t width, uint_fast32_t height, uint_fast8_t bytesPerComponent)
+ * \brief Open PPM file and write its header.
+ *
+ * If file specified by fileName already exists, it will
+ * be overwritten.\n
+ * File name must stay alive until writer is closed.
+ *
+ * \param writer Pointer to writer structure to initialize.
+ * \param fileName Name of the PPM file to export the image in.
+ * \param width Width of image.
+ * \param height Height of image.
+ * \param bytesPerComponent Colors bytes per component of image.
+ * \return 0 in case of success, 1 in case of error.
+ */
+int OpenPPMWriter(PPMWriter *writer, const char *fileName, uint_fast32_t width,
+			uint_fast32_t height, uint_fast8_t bytesPerComponent);
+
+/**
+ * \fn int WritePPMRows(PPMWriter *writer, const Image *image, uint_fast32_t y, uint_fast32_t nbRows, Threads *threads)
+ * \brief Append rows of image to PPM file.
+ *
+ * Image must have the width and bytes per component given when
+ * opening writer. Rows y to y+nbRows-1 of image become the next
+ * rows of PPM file.\n
+ * Rows are split into chunks of about PPM_CHUNK_SIZE bytes, that
+ * threads convert in parallel and write in turn : extra memory is
+ * one chunk per thread, whatever the number of rows.
+ *
+ * \param writer PPM writer.
+ * \param image Image to take rows from.
+ * \param y First row of image to write.
+ * \param nbRows Number of rows to write.
+ * \param threads Threads to be used for conversion.
+ * \return 0 in case of success, 1 in case of error.
+ */
+int WritePPMRows(PPMWriter *writer, const Image *image, uint_fast32_t y,
+			uint_fast32_t nbRows, Threads *threads);
+
+/**
+ * \fn int ClosePPMWriter(PPMWriter *writer)
+ * \brief Close PPM file.
+ *
+ * Fails if not all rows of image have been written.
+ *
+ * \param writer Pointer to writer structure to close.
+ * \return 0 in case of success, 1 in case of error.
+ */
+int ClosePPMWriter(PPMWriter *writer);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,276 @@
+/*
+ *  tile_cache.h -- part of FractalNow
+ *
+ *  Copyright (c) 2012 Marc Pegon <pe.marc@free.fr>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+ /**
+  * \file tile_cache.h
+  * \brief Header file related to tile cache.
+  *
+  * Tile cache keeps the tiles of the images already drawn (colors
+  * and fractal values), so that going back to a view already seen
+  * does not require to compute fractal again.
+  */
+
+#ifndef __TILE_CACHE_H__
+#define __TILE_CACHE_H__
+
+#include "float_precision.h"
+#include "fractal.h"
+#include "fractal_rendering_parameters.h"
+#include "image.h"
+#include "uirectangle.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \def TILE_SIZE
+ * \brief Width and height of tiles (in pixels).
+ */
+#define TILE_SIZE (uint_fast32_t)(64)
+
+/**
+ * \def NO_TILE
+ * \brief Tile index meaning no tile.
+ */
+#define NO_TILE UINT_FAST32_MAX
+
+/**
+ * \def DEFAULT_TILE_CACHE_SIZE
+ * \brief Default maximum number of tiles kept in memory.
+ */
+#define DEFAULT_TILE_CACHE_SIZE (uint_fast32_t)(1024)
+
+/**
+ * \def DEFAULT_TILE_CACHE_SPILL_SIZE
+ * \brief Default maximum number of tiles kept in spill file.
+ */
+#define DEFAULT_TILE_CACHE_SPILL_SIZE (uint_fast32_t)(8192)
+
+/**
+ * \struct TileLevel
+ * \brief Grid of tiles sharing the same pixel span.
+ *
+ * A view belongs to a level if it has the same pixel span, and if
+ * its top-left corner is a whole number of pixels away from level
+ * origin : images of views of the same level are then made of the
+ * same pixels.\n
+ * Levels are recycled once no tile refers to them.
+ */
+/**
+ * \typedef TileLevel
+ * \brief Convenient typedef for struct TileLevel.
+ */
+typedef struct TileLevel {
+	BiggestFloat x1;
+ /*!< x coordinate of level origin (top-left corner of tile (0,0)).*/
+	BiggestFloat y1;
+ /*!< y coordinate of level origin (top-left corner of tile (0,0)).*/
+	BiggestFloat pixelSpanX;
+ /*!< Pixel x span.*/
+	BiggestFloat pixelSpanY;
+ /*!< Pixel y span.*/
+	uint_fast32_t nbTiles;
+ /*!< Number of tiles in level.*/
+} TileLevel;
+
+/**
+ * \struct Tile
+ * \brief Colors and values of a square of pixels of some level.
+ *
+ * Tile data is made of TILE_SIZE*TILE_SIZE pixels (same format as
+ * image data), followed by the TILE_SIZE*TILE_SIZE values of these
+ * pixels (double).
+ */
+/**
+ * \typedef Tile
+ * \brief Convenient typedef for struct Tile.
+ */
+typedef struct Tile {
+	uint_fast32_t level;
+ /*!< Index of tile level in cache levels.*/
+	int_fast64_t x;
+ /*!< Tile x coordinate in level (in tiles).*/
+	int_fast64_t y;
+ /*!< Tile y coordinate in level (in tiles).*/
+	uint_fast32_t previous;
+ /*!< Index of previously used tile in LRU list of tile (NO_TILE if none).*/
+	uint_fast32_t next;
+ /*!< Index of next used tile in LRU list of tile (NO_TILE if none).*/
+	uint_fast32_t nextInBucket;
+ /*!< Index of next tile in hash bucket of tile (NO_TILE if none).*/
+	uint_fast64_t colorGeneration;
+ /*!< Color generation tile colors were computed with.*/
+	uint8_t *data;
+ /*!< Tile data (NULL if tile has been spilled).*/
+	uint_fast32_t spillSlot;
+ /*!< Slot of tile in spill file (if data is NULL).*/
+} Tile;
+
+/**
+ * \struct TileList
+ * \brief List of tiles, from least to most recently used.
+ */
+/**
+ * \typedef TileList
+ * \brief Convenient typedef for struct TileList.
+ */
+typedef struct TileList {
+	uint_fast32_t first;
+ /*!< Index of least recently used tile (NO_TILE if list is empty).*/
+	uint_fast32_t last;
+ /*!< Index of most recently used tile (NO_TILE if list is empty).*/
+} TileList;
+
+/**
+ * \struct TileCache
+ * \brief Cache of image tiles.
+ *
+ * Tiles are only valid for one fractal and one set of rendering
+ * parameters (apart from view and colors, see PartCompareFractals
+ * and PartCompareRenderingParameters) : cache is emptied when
+ * tiles are stored for other parameters.\n
+ * When colors change, tiles are recolored from their values when
+ * they are restored.\n
+ * Least recently used tiles are moved to spill file (a temporary
+ * file) when there are too many tiles in memory, and dropped when
+ * spill file is full.
+ */
+/**
+ * \typedef TileCache
+ * \brief Convenient typedef for struct TileCache.
+ */
+typedef struct TileCache {
+	uint_fast32_t size;
+ /*!< Maximum number of tiles in memory.*/
+	uint_fast32_t spillSize;
+ /*!< Maximum number of tiles in spill file.*/
+	int hasParameters;
+ /*!< 1 if fractal and rendering parameters below are set.*/
+	Fractal fractal;
+ /*!< Fractal of cached tiles.*/
+	RenderingParameters render;
+ /*!< Rendering parameters of current color generation.*/
+	uint_fast8_t bytesPerComponent;
+ /*!< Bytes per component of cached tiles colors.*/
+	uint_fast64_t colorGeneration;
+ /*!< Current color generation.*/
+	uint_fast32_t nbLevels;
+ /*!< Number of levels allocated.*/
+	TileLevel *level;
+ /*!< Tile levels.*/
+	uint_fast32_t nbTiles;
+ /*!< Number of tiles.*/
+	Tile *tile;
+ /*!< Tiles.*/
+	uint_fast32_t bucketMask;
+ /*!< Number of hash buckets minus one (number is a power of 2).*/
+	uint_fast32_t *bucket;
+ /*!< Hash buckets of tiles, keyed by (level, x, y) : index of first tile.*/
+	TileList memoryTiles;
+ /*!< Tiles whose data is in memory.*/
+	TileList spilledTiles;
+ /*!< Tiles whose data is in spill file.*/
+	uint_fast32_t nbTilesInMemory;
+ /*!< Number of tiles whose data is in memory.*/
+	FILE *spillFile;
+ /*!< Spill file (NULL if spilling is disabled).*/
+	uint_fast32_t nbSpillSlots;
+ /*!< Number of slots used so far in spill file.*/
+	uint_fast32_t nbFreeSpillSlots;
+ /*!< Number of free slots in spill file.*/
+	uint_fast32_t *freeSpillSlot;
+ /*!< Free slots of spill file.*/
+} TileCache;
+
+/**
+ * \fn int CreateTileCache(TileCache *cache, uint_fast32_t size, uint_fast32_t spillSize)
+ * \brief Create tile cache.
+ *
+ * If spillSize is not 0, a temporary spill file is created. In case
+ * of failure, spilling is disabled (cache can still be used).
+ *
+ * \param cache Pointer to cache structure to initialize.
+ * \param size Maximum number of tiles in memory.
+ * \param spillSize Maximum number of tiles in spill file.
+ * \return 0 in case of success, 1 if spill file could not be created.
+ */
+int CreateTileCache(TileCache *cache, uint_fast32_t size, uint_fast32_t spillSize);
+
+/**
+ * \fn void StoreImageTiles(TileCache *cache, const Image *image, const ValueBuffer *values, const Fractal *fractal, const RenderingParameters *render)
+ * \brief Store tiles of image.
+ *
+ * Only tiles lying entirely inside image are stored. Tiles already
+ * in cache are replaced.\n
+ * Values must match image (finished drawing of fractal, before
+ * anti-aliasing, so that colors can be recomputed from values).
+ *
+ * \param cache Tile cache.
+ * \param image Image drawn.
+ * \param values Values image was drawn from.
+ * \param fractal Fractal image was drawn for.
+ * \param render Rendering parameters image was drawn with.
+ */
+void StoreImageTiles(TileCache *cache, const Image *image, const ValueBuffer *values,
+			const Fractal *fractal, const RenderingParameters *render);
+
+/**
+ * \fn int RestoreImageTiles(TileCache *cache, Image *image, ValueBuffer *values, const Fractal *fractal, const RenderingParameters *render, UIRectangle *region)
+ * \brief Restore tiles of image from cache.
+ *
+ * Every cached tile of view is copied into image and value buffer,
+ * and region is set to the largest rectangle of image made of
+ * restored tiles only. It can be given as reuse region to
+ * CreateDrawFractalTask, so that only the rest of image is
+ * computed.\n
+ * Value buffer is resized to image size if necessary, and its
+ * anti-aliasing samples are reset. Values outside region are
+ * undefined.\n
+ * Tiles of another color generation are recolored from their
+ * values.
+ *
+ * \param cache Tile cache.
+ * \param image Image to restore tiles in.
+ * \param values Value buffer to restore values in.
+ * \param fractal Fractal of image.
+ * \param render Rendering parameters of image.
+ * \param region Pointer to rectangle to set to restored region.
+ * \return 1 if some region was restored, 0 otherwise.
+ */
+int RestoreImageTiles(TileCache *cache, Image *image, ValueBuffer *values,
+			const Fractal *fractal, const RenderingParameters *render,
+			UIRectangle *region);
+
+/**
+ * \fn void FreeTileCache(TileCache *cache)
+ * \brief Free tile cache.
+ *
+ * \param cache Pointer to cache structure to be free'd.
+ */
+void FreeTileCache(TileCache *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -104,6 +104,42 @@ int CutUIRectangleInHalf(UIRectangle rectangle, UIRectangle *out1, UIRectangle *
  */
 void CutUIRectangleMaxSize(UIRectangle src, uint_fast32_t size, UIRectangle **out, uint_fast32_t *out_size);
 
+/**
+ * \fn void CutUIRectangleMaxSizeFocus(UIRectangle src, uint_fast32_t size, uint_fast32_t focusX, uint_fast32_t focusY, UIRectangle **out, uint_fast32_t *out_size)
+ * \brief Cut rectangle into smaller rectangles, ordered around focus point.
+ *
+ * Cut rectangle into smaller rectangles exactly like CutUIRectangleMaxSize,
+ * but order them by increasing distance to the focus point.\n
+ * Rectangles are grouped in square rings centered on the rectangle that
+ * contains the focus point, and ordered along a Hilbert curve inside each
+ * ring, so that consecutive rectangles stay close to each other.\n
+ * Focus point coordinates are clamped to the source rectangle.
+ *
+ * \param src Rectangle to be cut into smaller rectangles.
+ * \param size Maximum size of the small rectangles produced.
+ * \param focusX X coordinate of focus point.
+ * \param focusY Y coordinate of focus point.
+ * \param out Pointer to a (not yet allocated) array of rectangles for the output.
+ * \param out_size Pointer to an integer to store the number of small rectangles produced.
+ */
+void CutUIRectangleMaxSizeFocus(UIRectangle src, uint_fast32_t size, uint_fast32_t focusX,
+				uint_fast32_t focusY, UIRectangle **out, uint_fast32_t *out_size);
+
+/**
+ * \fn uint_fast32_t SubtractUIRectangle(UIRectangle rectangle, const UIRectangle *hole, UIRectangle *out)
+ * \brief Cut hole out of rectangle.
+ *
+ * Cut rectangle into (at most 4) rectangles that cover all points of
+ * rectangle that are not inside hole.\n
+ * Hole does not need to be inside rectangle.
+ *
+ * \param rectangle Rectangle to cut hole out of.
+ * \param hole Rectangle to cut out.
+ * \param out Pointer to the (allocated) array of (at least) 4 rectangles for the output.
+ * \return Number of rectangles produced.
+ */
+uint_fast32_t SubtractUIRectangle(UIRectangle rectangle, const UIRectangle *hole, UIRectangle *out);
+
 /**
  * \fn int CutUIRectangleInN(UIRectangle rectangle, uint_fast32_t N, UIRectangle *out)
  * \brief Cut rectangle in N parts.
@@ -111,18 +111,23 @@ Color MixColors(Color C1, double weight1, Color C2, double weight2)
 	return res;
 }
 
-inline double ColorManhattanDistance(Color C1, Color C2)
+static inline uint_fast32_t ColorManhattanDistanceUnnormalized(Color C1, Color C2)
+{
+	return (C1.r > C2.r ? C1.r-C2.r : C2.r-C1.r) +
+		(C1.g > C2.g ? C1.g-C2.g : C2.g-C1.g) +
+		(C1.b > C2.b ? C1.b-C2.b : C2.b-C1.b);
+}
+
+static inline double GetManhattanDistanceNormalization(uint_fast8_t bytesPerComponent)
 {
 	double res = 0;
-	uint_fast32_t sum = (labs(C1.r-(long int)C2.r)+labs(C1.g-(long int)C2.g)+
-			labs(C1.b-(long int)C2.b));
 
-	switch (C1.bytesPerComponent) {
+	switch (bytesPerComponent) {
 	case 1:
-		res = sum / (double)(3*UINT8_MAX);
+		res = 3*UINT8_MAX;
 		break;
 	case 2:
-		res = sum / (double)(3*UINT16_MAX);
+		res = 3*UINT16_MAX;
 		break;
 	default:
 		FractalNow_error("Invalid bytes per component.\n");
@@ -132,16 +137,23 @@ inline double ColorManhattanDistance(Color C1, Color C2)
 	return res;
 }
 
+inline double ColorManhattanDistance(Color C1, Color C2)
+{
+	return ColorManhattanDistanceUnnormalized(C1, C2) /
+		GetManhattanDistanceNormalization(C1.bytesPerComponent);
+}
+
 inline double QuadAvgDissimilarity(const Color C[4])
 {
 	Color avg;
 	avg.r = (C[0].r + C[1].r + C[2].r + C[3].r) / 4;
 	avg.g = (C[0].g + C[1].g + C[2].g + C[3].g) / 4;
 	avg.b = (C[0].b + C[1].b + C[2].b + C[3].b) / 4;
-	return (ColorManhattanDistance(C[0],avg)+
-		ColorManhattanDistance(C[1],avg)+
-		ColorManhattanDistance(C[2],avg)+
-		ColorManhattanDistance(C[3],avg)) / 4;
+	double norm = GetManhattanDistanceNormalization(C[0].bytesPerComponent);
+	return (ColorManhattanDistanceUnnormalized(C[0],avg) / norm +
+		ColorManhattanDistanceUnnormalized(C[1],avg) / norm +
+		ColorManhattanDistanceUnnormalized(C[2],avg) / norm +
+		ColorManhattanDistanceUnnormalized(C[3],avg) / norm) / 4;
 }
 
 inline Color QuadLinearInterpolation(const Color C[4], double x, double y)
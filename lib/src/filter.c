@@ -226,6 +226,17 @@ int NormalizeFilter(Filter *filter)
 	}
 }
 
+static inline Color GetFilteredColor(const Image *src, double r, double g, double b)
+{
+	Color color;
+	color.bytesPerComponent = src->bytesPerComponent;
+	color.r = r;
+	color.g = g;
+	color.b = b;
+
+	return color;
+}
+
 Color ApplyFilterOnSinglePixel(const Image *src, uint_fast32_t x, uint_fast32_t y,
 				const Filter *filter)
 {
@@ -237,22 +248,179 @@ Color ApplyFilterOnSinglePixel(const Image *src, uint_fast32_t x, uint_fast32_t
 	r = 0;
 	g = 0;
 	b = 0;
+	int_fast64_t x0 = (int_fast64_t)(x-filter->cx);
+	int_fast64_t y0 = (int_fast64_t)(y-filter->cy);
+	if (x0 < 0 || y0 < 0 || x0+filter->sx > src->width || y0+filter->sy > src->height) {
+		/* Near the edges : let iGetPixel duplicate border pixels. */
+		for (uint_fast32_t i = 0; i < filter->sx; ++i) {
+			for (uint_fast32_t j = 0; j < filter->sy; ++j) {
+				color = iGetPixel(src, x-filter->cx+i, y-filter->cy+j);
+				value = GetFilterValueUnsafe(filter, i, j);
+				r += color.r * value;
+				g += color.g * value;
+				b += color.b * value;
+			}
+		}
+		return GetFilteredColor(src, r, g, b);
+	}
+
+	/* Interior : read packed pixels directly. */
+	switch (src->bytesPerComponent) {
+	case 1:
+		{
+		const uint32_t *data32 = (const uint32_t *)src->data + y0*src->width + x0;
+		uint32_t pixel;
+		for (uint_fast32_t i = 0; i < filter->sx; ++i) {
+			for (uint_fast32_t j = 0; j < filter->sy; ++j) {
+				pixel = data32[j*src->width+i];
+				value = GetFilterValueUnsafe(filter, i, j);
+				r += GET_R8(pixel) * value;
+				g += GET_G8(pixel) * value;
+				b += GET_B8(pixel) * value;
+			}
+		}
+		break;
+		}
+	case 2:
+		{
+		const uint64_t *data64 = (const uint64_t *)src->data + y0*src->width + x0;
+		uint64_t pixel;
+		for (uint_fast32_t i = 0; i < filter->sx; ++i) {
+			for (uint_fast32_t j = 0; j < filter->sy; ++j) {
+				pixel = data64[j*src->width+i];
+				value = GetFilterValueUnsafe(filter, i, j);
+				r += GET_R16(pixel) * value;
+				g += GET_G16(pixel) * value;
+				b += GET_B16(pixel) * value;
+			}
+		}
+		break;
+		}
+	default:
+		FractalNow_error("Invalid bytes per component.\n");
+		break;
+	}
+
+	return GetFilteredColor(src, r, g, b);
+}
+
+/* Accumulate weight times pixels x to x+length-1 of row into r, g and b.
+ * Pixels outside row (x can be negative) are duplicates of the border
+ * pixels, so that the inner loop does not need any test and can be
+ * vectorized by the compiler.
+ */
+#define DEFINE_ACCUMULATE_ROW(bits, type) \
+static inline void AccumulateRowRGB##bits(double *r, double *g, double *b, const type *row,\
+				int_fast64_t x, uint_fast32_t length, uint_fast32_t width,\
+				double weight)\
+{\
+	uint_fast32_t k = 0;\
+	type pixel = row[0];\
+	for (; k < length && x+(int_fast64_t)k < 0; ++k) {\
+		r[k] += GET_R##bits(pixel) * weight;\
+		g[k] += GET_G##bits(pixel) * weight;\
+		b[k] += GET_B##bits(pixel) * weight;\
+	}\
+	int_fast64_t interiorEnd = (int_fast64_t)width - x;\
+	uint_fast32_t end = (interiorEnd < (int_fast64_t)k) ? k :\
+				(interiorEnd > (int_fast64_t)length) ? length : (uint_fast32_t)interiorEnd;\
+	for (; k < end; ++k) {\
+		pixel = row[x+(int_fast64_t)k];\
+		r[k] += GET_R##bits(pixel) * weight;\
+		g[k] += GET_G##bits(pixel) * weight;\
+		b[k] += GET_B##bits(pixel) * weight;\
+	}\
+	pixel = row[width-1];\
+	for (; k < length; ++k) {\
+		r[k] += GET_R##bits(pixel) * weight;\
+		g[k] += GET_G##bits(pixel) * weight;\
+		b[k] += GET_B##bits(pixel) * weight;\
+	}\
+}
+
+DEFINE_ACCUMULATE_ROW(8, uint32_t)
+DEFINE_ACCUMULATE_ROW(16, uint64_t)
+
+void ApplyFilterOnRow(Image *dst, uint_fast32_t dstX, uint_fast32_t dstY, const Image *src,
+			uint_fast32_t x, uint_fast32_t y, uint_fast32_t length,
+			const Filter *filter, double *buffer)
+{
+	if (length == 0) {
+		return;
+	}
+	if (src->width == 0 || src->height == 0) {
+		memset(dst->data + (dstY*dst->width+dstX)*4*dst->bytesPerComponent, 0,
+			length*4*dst->bytesPerComponent);
+		return;
+	}
+
+	double *r = buffer;
+	double *g = buffer + length;
+	double *b = buffer + 2*length;
+	memset(buffer, 0, 3*length*sizeof(double));
+
+	/* Same summation order as ApplyFilterOnSinglePixel, so that results
+	 * are identical.
+	 */
+	int_fast64_t rowIndex;
+	double value;
 	for (uint_fast32_t i = 0; i < filter->sx; ++i) {
+		int_fast64_t x0 = (int_fast64_t)(x-filter->cx+i);
 		for (uint_fast32_t j = 0; j < filter->sy; ++j) {
-			color = iGetPixel(src, x-filter->cx+i, y-filter->cy+j);
+			rowIndex = (int_fast64_t)(y-filter->cy+j);
+			if (rowIndex < 0) {
+				rowIndex = 0;
+			} else if (rowIndex >= (int_fast64_t)src->height) {
+				rowIndex = src->height-1;
+			}
 			value = GetFilterValueUnsafe(filter, i, j);
-			r += color.r * value;
-			g += color.g * value;
-			b += color.b * value;
+
+			switch (src->bytesPerComponent) {
+			case 1:
+				AccumulateRowRGB8(r, g, b, (const uint32_t *)src->data +
+						rowIndex*src->width, x0, length, src->width,
+						value);
+				break;
+			case 2:
+				AccumulateRowRGB16(r, g, b, (const uint64_t *)src->data +
+						rowIndex*src->width, x0, length, src->width,
+						value);
+				break;
+			default:
+				FractalNow_error("Invalid bytes per component.\n");
+				break;
+			}
 		}
 	}
 
-	color.bytesPerComponent = src->bytesPerComponent;
-	color.r = r;
-	color.g = g;
-	color.b = b;
-
-	return color;
+	uint_fast16_t cr, cg, cb;
+	switch (dst->bytesPerComponent) {
+	case 1:
+		{
+		uint32_t *data32 = (uint32_t *)dst->data + dstY*dst->width + dstX;
+		for (uint_fast32_t k = 0; k < length; ++k) {
+			cr = r[k];
+			cg = g[k];
+			cb = b[k];
+			data32[k] = RGB8_TO_UINT32(cr, cg, cb);
+		}
+		break;
+		}
+	case 2:
+		{
+		uint64_t *data64 = (uint64_t *)dst->data + dstY*dst->width + dstX;
+		for (uint_fast32_t k = 0; k < length; ++k) {
+			cr = r[k];
+			cg = g[k];
+			cb = b[k];
+			data64[k] = RGB16_TO_UINT64(cr, cg, cb);
+		}
+		break;
+		}
+	default:
+		FractalNow_error("Invalid bytes per component.\n");
+		break;
+	}
 }
 
 void *ApplyFilterThreadRoutine(void *arg)
@@ -265,26 +433,36 @@ void *ApplyFilterThreadRoutine(void *arg)
 
 	uint_fast32_t nbRectangles = c_arg->nbRectangles;
 	UIRectangle *dstRect;
-	uint_fast32_t rectHeight;
+	uint_fast32_t rectWidth, rectHeight;
+	uint_fast32_t maxWidth = 0;
+	for (uint_fast32_t i = 0; i < nbRectangles; ++i) {
+		rectWidth = c_arg->rectangles[i].x2+1 - c_arg->rectangles[i].x1;
+		if (rectWidth > maxWidth) {
+			maxWidth = rectWidth;
+		}
+	}
+	double *buffer = (double *)safeMalloc("filter buffer", 3*maxWidth*sizeof(double));
+
 	uint_fast32_t counter = 0;
 	int cancelRequested = CancelTaskRequested(threadArgHeader);
 	for (uint_fast32_t i = 0; i < nbRectangles && !cancelRequested; ++i) {
 		dstRect = &c_arg->rectangles[i];
+		rectWidth = dstRect->x2+1 - dstRect->x1;
 		rectHeight = dstRect->y2+1 - dstRect->y1;
 
 		for (uint_fast32_t j = dstRect->y1; j <= dstRect->y2 && !cancelRequested; ++j) {
 			SetThreadProgress(threadArgHeader, 100 * (i * rectHeight + (j-dstRect->y1)) /
 								(rectHeight * nbRectangles));
-			for (uint_fast32_t k = dstRect->x1; k <= dstRect->x2
-					&& !cancelRequested; ++k) {
-				HandleRequests(32);
+			HandleRequests(0);
 
-				PutPixelUnsafe(dst, k, j, ApplyFilterOnSinglePixel(src, k, j, filter));
-			}
+			ApplyFilterOnRow(dst, dstRect->x1, j, src, dstRect->x1, j, rectWidth, filter,
+						buffer);
 		}
 	}
 	SetThreadProgress(threadArgHeader, 100);
 
+	free(buffer);
+
 	int canceled = CancelTaskRequested(threadArgHeader);
 
 	return (canceled ? PTHREAD_CANCELED : NULL);
@@ -347,6 +525,336 @@ void ApplyFilter(Image *dst, const Image *src, const Filter *filter, Threads *th
 	UNUSED(unused);
 }
 
+/* Recursive gaussian filter (Young & van Vliet, "Recursive implementation
+ * of the Gaussian filter", 1995) : a causal and an anti-causal 3rd order
+ * IIR pass, whose cost does not depend on sigma.
+ */
+typedef struct s_RecursiveGaussianCoefficients {
+	double B;
+	double b1;
+	double b2;
+	double b3;
+	uint_fast32_t padding;
+} RecursiveGaussianCoefficients;
+
+/* The anti-causal pass is started that far (times sigma) after the
+ * end of the data, the data being extended by its last value, so that
+ * the causal pass has reached its steady state.
+ */
+#define RECURSIVE_GAUSSIAN_PADDING_FACTOR (double)(4)
+
+static void InitRecursiveGaussianCoefficients(RecursiveGaussianCoefficients *coeffs, double sigma)
+{
+	double q;
+	if (sigma >= 2.5) {
+		q = 0.98711*sigma - 0.96330;
+	} else {
+		q = 3.97156 - 4.14554*sqrt(1-0.26891*sigma);
+	}
+	double q2 = q*q;
+	double q3 = q2*q;
+	double b0 = 1.57825 + 2.44413*q + 1.4281*q2 + 0.422205*q3;
+	coeffs->b1 = (2.44413*q + 2.85619*q2 + 1.26661*q3) / b0;
+	coeffs->b2 = -(1.4281*q2 + 1.26661*q3) / b0;
+	coeffs->b3 = 0.422205*q3 / b0;
+	coeffs->B = 1 - (coeffs->b1+coeffs->b2+coeffs->b3);
+	coeffs->padding = ceil(RECURSIVE_GAUSSIAN_PADDING_FACTOR*sigma);
+}
+
+/* Filter n values in place.
+ * Borders are handled as if border values were repeated infinitely.
+ */
+static inline void ApplyRecursiveGaussian(double *data, uint_fast32_t n,
+					const RecursiveGaussianCoefficients *coeffs)
+{
+	double B = coeffs->B, b1 = coeffs->b1, b2 = coeffs->b2, b3 = coeffs->b3;
+	double w1, w2, w3;
+
+	w1 = w2 = w3 = data[0];
+	for (uint_fast32_t i = 0; i < n; ++i) {
+		double w = B*data[i] + b1*w1 + b2*w2 + b3*w3;
+		data[i] = w;
+		w3 = w2;
+		w2 = w1;
+		w1 = w;
+	}
+	w1 = w2 = w3 = data[n-1];
+	for (uint_fast32_t i = n; i-- > 0;) {
+		double w = B*data[i] + b1*w1 + b2*w2 + b3*w3;
+		data[i] = w;
+		w3 = w2;
+		w2 = w1;
+		w1 = w;
+	}
+}
+
+/* Filter each of the width columns of n rows in place, all columns at
+ * once so that rows are accessed contiguously.
+ */
+static inline void ApplyRecursiveGaussianOnColumns(double *data, uint_fast32_t n,
+						uint_fast32_t width, double *history,
+						const RecursiveGaussianCoefficients *coeffs)
+{
+	double B = coeffs->B, b1 = coeffs->b1, b2 = coeffs->b2, b3 = coeffs->b3;
+	double *w1 = history, *w2 = history+width, *w3 = history+2*width;
+	double *row;
+
+	for (uint_fast32_t c = 0; c < width; ++c) {
+		w1[c] = w2[c] = w3[c] = data[c];
+	}
+	for (uint_fast32_t i = 0; i < n; ++i) {
+		row = data + i*width;
+		for (uint_fast32_t c = 0; c < width; ++c) {
+			double w = B*row[c] + b1*w1[c] + b2*w2[c] + b3*w3[c];
+			row[c] = w;
+			w3[c] = w2[c];
+			w2[c] = w1[c];
+			w1[c] = w;
+		}
+	}
+	for (uint_fast32_t c = 0; c < width; ++c) {
+		w1[c] = w2[c] = w3[c] = data[(n-1)*width+c];
+	}
+	for (uint_fast32_t i = n; i-- > 0;) {
+		row = data + i*width;
+		for (uint_fast32_t c = 0; c < width; ++c) {
+			double w = B*row[c] + b1*w1[c] + b2*w2[c] + b3*w3[c];
+			row[c] = w;
+			w3[c] = w2[c];
+			w2[c] = w1[c];
+			w1[c] = w;
+		}
+	}
+}
+
+static inline void UnpackPixels(double *r, double *g, double *b, const Image *image,
+				uint_fast32_t x, uint_fast32_t y, uint_fast32_t n)
+{
+	switch (image->bytesPerComponent) {
+	case 1:
+		{
+		const uint32_t *data32 = (const uint32_t *)image->data + y*image->width + x;
+		for (uint_fast32_t i = 0; i < n; ++i) {
+			uint32_t pixel = data32[i];
+			r[i] = GET_R8(pixel);
+			g[i] = GET_G8(pixel);
+			b[i] = GET_B8(pixel);
+		}
+		break;
+		}
+	case 2:
+		{
+		const uint64_t *data64 = (const uint64_t *)image->data + y*image->width + x;
+		for (uint_fast32_t i = 0; i < n; ++i) {
+			uint64_t pixel = data64[i];
+			r[i] = GET_R16(pixel);
+			g[i] = GET_G16(pixel);
+			b[i] = GET_B16(pixel);
+		}
+		break;
+		}
+	default:
+		FractalNow_error("Invalid bytes per component.\n");
+		break;
+	}
+}
+
+static inline uint_fast16_t ClampComponent(double value, uint_fast16_t max)
+{
+	if (value <= 0) {
+		return 0;
+	} else if (value >= max) {
+		return max;
+	} else {
+		return (uint_fast16_t)(value+0.5);
+	}
+}
+
+static inline void PackPixels(Image *image, uint_fast32_t x, uint_fast32_t y, uint_fast32_t n,
+				const double *r, const double *g, const double *b)
+{
+	switch (image->bytesPerComponent) {
+	case 1:
+		{
+		uint32_t *data32 = (uint32_t *)image->data + y*image->width + x;
+		for (uint_fast32_t i = 0; i < n; ++i) {
+			data32[i] = RGB8_TO_UINT32(ClampComponent(r[i], 0xFF),
+						ClampComponent(g[i], 0xFF),
+						ClampComponent(b[i], 0xFF));
+		}
+		break;
+		}
+	case 2:
+		{
+		uint64_t *data64 = (uint64_t *)image->data + y*image->width + x;
+		for (uint_fast32_t i = 0; i < n; ++i) {
+			data64[i] = RGB16_TO_UINT64(ClampComponent(r[i], 0xFFFF),
+						ClampComponent(g[i], 0xFFFF),
+						ClampComponent(b[i], 0xFFFF));
+		}
+		break;
+		}
+	default:
+		FractalNow_error("Invalid bytes per component.\n");
+		break;
+	}
+}
+
+/* Columns are filtered by strips, so that rows of a strip are read and
+ * written contiguously.
+ */
+#define RECURSIVE_GAUSSIAN_STRIP_WIDTH (uint_fast32_t)(16)
+
+typedef struct s_ApplyRecursiveGaussianFilterArguments {
+	Image *dst;
+	const Image *src;
+	int vertical;
+	uint_fast32_t first;
+	uint_fast32_t last;
+	RecursiveGaussianCoefficients coeffs;
+} ApplyRecursiveGaussianFilterArguments;
+
+void *ApplyRecursiveGaussianFilterThreadRoutine(void *arg)
+{
+	ThreadArgHeader *threadArgHeader = GetThreadArgHeader(arg);
+	ApplyRecursiveGaussianFilterArguments *c_arg =
+		(ApplyRecursiveGaussianFilterArguments *)GetThreadArgBody(arg);
+	Image *dst = c_arg->dst;
+	const Image *src = c_arg->src;
+	uint_fast32_t first = c_arg->first;
+	uint_fast32_t last = c_arg->last;
+
+	uint_fast32_t counter = 0;
+	int cancelRequested = CancelTaskRequested(threadArgHeader);
+	if (!c_arg->vertical) {
+		/* Each row is filtered on its own. */
+		uint_fast32_t n = src->width;
+		uint_fast32_t size = n + c_arg->coeffs.padding;
+		double *buffer = (double *)safeMalloc("filter buffer", 3*size*sizeof(double));
+		for (uint_fast32_t j = first; j < last && !cancelRequested; ++j) {
+			SetThreadProgress(threadArgHeader, 100 * (j-first) / (last-first));
+			HandleRequests(0);
+
+			UnpackPixels(buffer, buffer+size, buffer+2*size, src, 0, j, n);
+			for (uint_fast32_t c = 0; c < 3; ++c) {
+				double *data = buffer+c*size;
+				for (uint_fast32_t i = n; i < size; ++i) {
+					data[i] = data[n-1];
+				}
+				ApplyRecursiveGaussian(data, size, &c_arg->coeffs);
+			}
+			PackPixels(dst, 0, j, n, buffer, buffer+size, buffer+2*size);
+		}
+		free(buffer);
+	} else {
+		uint_fast32_t n = src->height;
+		uint_fast32_t stride = 3*RECURSIVE_GAUSSIAN_STRIP_WIDTH;
+		uint_fast32_t size = n + c_arg->coeffs.padding;
+		double *buffer = (double *)safeCalloc("filter buffer", size*stride, sizeof(double));
+		double history[3*3*RECURSIVE_GAUSSIAN_STRIP_WIDTH];
+		for (uint_fast32_t x = first; x < last && !cancelRequested;
+				x += RECURSIVE_GAUSSIAN_STRIP_WIDTH) {
+			SetThreadProgress(threadArgHeader, 100 * (x-first) / (last-first));
+			HandleRequests(0);
+
+			uint_fast32_t stripWidth = last-x;
+			if (stripWidth > RECURSIVE_GAUSSIAN_STRIP_WIDTH) {
+				stripWidth = RECURSIVE_GAUSSIAN_STRIP_WIDTH;
+			}
+			double *r = buffer;
+			double *g = buffer + RECURSIVE_GAUSSIAN_STRIP_WIDTH;
+			double *b = buffer + 2*RECURSIVE_GAUSSIAN_STRIP_WIDTH;
+			for (uint_fast32_t j = 0; j < n; ++j) {
+				UnpackPixels(r+j*stride, g+j*stride, b+j*stride, src, x, j,
+						stripWidth);
+			}
+			for (uint_fast32_t j = n; j < size; ++j) {
+				memcpy(buffer+j*stride, buffer+(n-1)*stride, stride*sizeof(double));
+			}
+			ApplyRecursiveGaussianOnColumns(buffer, size, stride, history,
+							&c_arg->coeffs);
+			for (uint_fast32_t j = 0; j < n; ++j) {
+				PackPixels(dst, x, j, stripWidth, r+j*stride, g+j*stride,
+						b+j*stride);
+			}
+		}
+		free(buffer);
+	}
+	SetThreadProgress(threadArgHeader, 100);
+
+	int canceled = CancelTaskRequested(threadArgHeader);
+
+	return (canceled ? PTHREAD_CANCELED : NULL);
+}
+
+char applyRecursiveGaussianFilterMessage[] = "Applying recursive gaussian filter";
+
+static Task *CreateApplyRecursiveGaussianFilterTask(Image *dst, const Image *src, double sigma,
+							int vertical, uint_fast32_t nbThreads)
+{
+	uint_fast32_t n = vertical ? (src->width + RECURSIVE_GAUSSIAN_STRIP_WIDTH-1) /
+					RECURSIVE_GAUSSIAN_STRIP_WIDTH : src->height;
+	uint_fast32_t nbThreadsNeeded = (n < nbThreads) ? n : nbThreads;
+
+	ApplyRecursiveGaussianFilterArguments *arg;
+	arg = (ApplyRecursiveGaussianFilterArguments *)safeMalloc("arguments",
+			nbThreadsNeeded * sizeof(ApplyRecursiveGaussianFilterArguments));
+	for (uint_fast32_t i = 0; i < nbThreadsNeeded; ++i) {
+		arg[i].dst = dst;
+		arg[i].src = src;
+		arg[i].vertical = vertical;
+		arg[i].first = i * n / nbThreadsNeeded;
+		arg[i].last = (i+1) * n / nbThreadsNeeded;
+		if (vertical) {
+			/* Threads work on whole strips. */
+			arg[i].first *= RECURSIVE_GAUSSIAN_STRIP_WIDTH;
+			arg[i].last *= RECURSIVE_GAUSSIAN_STRIP_WIDTH;
+			if (arg[i].last > src->width) {
+				arg[i].last = src->width;
+			}
+		}
+		InitRecursiveGaussianCoefficients(&arg[i].coeffs, sigma);
+	}
+	Task *res = CreateTask(applyRecursiveGaussianFilterMessage, nbThreadsNeeded, arg,
+				sizeof(ApplyRecursiveGaussianFilterArguments),
+				ApplyRecursiveGaussianFilterThreadRoutine, NULL);
+
+	free(arg);
+
+	return res;
+}
+
+char applyRecursiveGaussianBlurMessage[] = "Applying recursive gaussian blur";
+
+Task *CreateApplyRecursiveGaussianBlurTask(Image *dst, Image *temp, const Image *src,
+						double sigma, uint_fast32_t nbThreads)
+{
+	if (sigma <= 0) {
+		FractalNow_error("Sigma must be > 0.\n");
+	}
+	if (src->width == 0 || src->height == 0) {
+		return DoNothingTask();
+	}
+
+	Task *subTasks[2];
+	subTasks[0] = CreateApplyRecursiveGaussianFilterTask(temp, src, sigma, 0, nbThreads);
+	subTasks[1] = CreateApplyRecursiveGaussianFilterTask(dst, temp, sigma, 1, nbThreads);
+
+	return CreateCompositeTask(applyRecursiveGaussianBlurMessage, 2, subTasks);
+}
+
+void ApplyRecursiveGaussianBlur(Image *dst, const Image *src, double sigma, Threads *threads)
+{
+	Image temp;
+	CreateImage(&temp, src->width, src->height, src->bytesPerComponent);
+
+	Task *task = CreateApplyRecursiveGaussianBlurTask(dst, &temp, src, sigma, threads->N);
+	int unused = ExecuteTaskBlocking(task, threads);
+	UNUSED(unused);
+
+	FreeImage(temp);
+}
+
 void FreeFilter(Filter filter)
 {
 	free(filter.data);
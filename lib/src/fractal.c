@@ -41,15 +41,103 @@ if (counter == max_counter) {\
 	++counter;\
 }
 
+/* Maximum size of the tiles that threads take from the tile queue.
+ * Tiles are small enough for the work to be balanced dynamically
+ * between threads, and for the tiles around the focus point to
+ * be finished first.
+ */
+#define DEFAULT_TILE_SIZE (uint_fast32_t)(64)
+
+/* Tiles shared by all threads of a task, ordered around focus point.
+ * Each thread takes the next tile until the queue is empty.
+ */
+typedef struct s_TileQueue {
+	uint_fast32_t nbTiles;
+	UIRectangle *tiles;
+	uint_fast32_t next;
+	pthread_spinlock_t mutex;
+} TileQueue;
+
+/* Pixels inside reuse region (if not NULL) are left out of the tiles.
+ */
+static TileQueue *CreateTileQueue(const Image *image, uint_fast32_t tileSize,
+					const UIRectangle *reuseRegion,
+					uint_fast32_t focusX, uint_fast32_t focusY)
+{
+	TileQueue *res = (TileQueue *)safeMalloc("tile queue", sizeof(TileQueue));
+	UIRectangle rectangle;
+	InitUIRectangle(&rectangle, 0, 0, image->width-1, image->height-1);
+	CutUIRectangleMaxSizeFocus(rectangle, tileSize, focusX, focusY, &res->tiles,
+					&res->nbTiles);
+	if (reuseRegion != NULL) {
+		UIRectangle *tiles = res->tiles;
+		uint_fast32_t nbTiles = res->nbTiles;
+		res->tiles = (UIRectangle *)safeMalloc("tiles", 4 * nbTiles * sizeof(UIRectangle));
+		res->nbTiles = 0;
+		for (uint_fast32_t i = 0; i < nbTiles; ++i) {
+			res->nbTiles += SubtractUIRectangle(tiles[i], reuseRegion,
+								&res->tiles[res->nbTiles]);
+		}
+		free(tiles);
+	}
+	res->next = 0;
+	safePThreadSpinInit(&res->mutex, SPIN_INIT_ATTR);
+
+	return res;
+}
+
+/* Get next tile from queue, and the task progress (in percent) at the time
+ * it is taken.
+ * Returns 0 if queue is empty, 1 otherwise.
+ */
+static inline int GetNextTile(TileQueue *queue, UIRectangle *tile, int *progress)
+{
+	int res;
+	safePThreadSpinLock(&queue->mutex);
+	if (queue->next < queue->nbTiles) {
+		*progress = (int)(100 * queue->next / queue->nbTiles);
+		*tile = queue->tiles[queue->next++];
+		res = 1;
+	} else {
+		*progress = 100;
+		res = 0;
+	}
+	safePThreadSpinUnlock(&queue->mutex);
+
+	return res;
+}
+
+static void FreeTileQueue(TileQueue *queue)
+{
+	safePThreadSpinDestroy(&queue->mutex);
+	free(queue->tiles);
+	free(queue);
+}
+
+/* Pixels of a rectangle looked up in cache (see FindRectangleInCache). */
+typedef struct s_CacheLookup {
+	UIRectangle rectangle;
+	uint_fast32_t nbFound;
+	uint_fast32_t capacity;
+	uint_fast32_t *x;
+	uint_fast32_t *y;
+	double *value;
+	int *found;
+} CacheLookup;
+
 typedef struct s_DrawFractalArguments {
 	uint_fast32_t threadId;
 	FractalCache *cache;
+	CacheInsertionBuffer *cacheBuffer; /* Set by each thread (if cache is not NULL). */
+	CacheLookup *lookup; /* Set by each thread (if cache is not NULL). */
+	int usePreview;
 	Image *image;
-	Image *copyImage;
+	ValueBuffer *values;
+	OrbitBuffer *orbits;
+	void *orbit; /* Set by each thread (if orbits is not NULL). */
 	const Fractal *fractal;
 	const RenderingParameters *render;
-	uint_fast32_t nbRectangles;
-	UIRectangle *rectangles;
+	TileQueue *tiles;
 	uint_fast32_t size;
 	double threshold;
 	FloatPrecision floatPrecision;
@@ -59,11 +147,7 @@ void FreeDrawFractalArguments(void *arg)
 {
 	DrawFractalArguments *c_arg = (DrawFractalArguments *)arg;
 	if (c_arg->threadId == 0) {
-		free(c_arg->rectangles);
-		if (c_arg->copyImage != NULL) {
-			FreeImage(*c_arg->copyImage);
-			free(c_arg->copyImage);
-		}
+		FreeTileQueue(c_arg->tiles);
 	}
 }
 
@@ -192,6 +276,15 @@ Fractal CopyFractal(const Fractal *fractal)
 	return res;
 }
 
+int PartCompareFractals(const Fractal *fractal1, const Fractal *fractal2)
+{
+	return (fractal1->fractalFormula != fractal2->fractalFormula ||
+		!ceqBiggestF(fractal1->p, fractal2->p) ||
+		!ceqBiggestF(fractal1->c, fractal2->c) ||
+		fractal1->escapeRadius != fractal2->escapeRadius ||
+		fractal1->maxIter != fractal2->maxIter);
+}
+
 int ReadFractalFileV075(Fractal *fractal, const char *fileName, FILE *file)
 {
 	int res = 0;
@@ -593,26 +686,18 @@ static inline Color aux_ComputeFractalColor(const Fractal *fractal, const Render
 						const FractalEngine *engine,
 						uint_fast32_t x, uint_fast32_t y,
 						uint_fast32_t width, uint_fast32_t height,
-						FractalCache *cache)
+						CacheInsertionBuffer *cacheBuffer,
+						void *orbit, int resume, double *value)
 {
-	CacheEntry entry = RunFractalEngine(engine, fractal, render, x, y, width, height);
-	double value = entry.value;
+	*value = RunFractalEngineOrbit(engine, fractal, render, x, y, width, height,
+					orbit, resume);
 
 	Color res;
 
-	if (cache != NULL) {
-		AddToCacheThreadSafe(cache, entry);
-	} else {
-		FreeCacheEntry(entry);
-	}
-	if (value < 0) {
-		res = render->spaceColor;
-	} else {
-
-		value = render->transferFunctionPtr(value)*render->realMultiplier+
-			render->realOffset;
-		res = GetGradientColor(&render->gradient, (uint_fast64_t)(value));
+	if (cacheBuffer != NULL) {
+		AddToCacheInsertionBuffer(cacheBuffer, x, y, *value);
 	}
+	res = GetColorMapColor(&engine->colorMap, *value);
 
 	return res;
 }
@@ -622,72 +707,262 @@ static inline Color aux_ComputeFractalImagePixel(const Fractal *fractal,
 							const FractalEngine *fractalEngine,
 							uint_fast32_t x, uint_fast32_t y,
 							uint_fast32_t width, uint_fast32_t height,
-							FractalCache *cache)
+							CacheInsertionBuffer *cacheBuffer,
+							void *orbit, int resume, double *value)
 {
 	/* We call auxiliary function because we don't need (and thus want) to
 	 * to re-get the FractalLoop to use for each pixel. It is already stored
 	 * in arg.
 	 */
 	return aux_ComputeFractalColor(fractal, render, fractalEngine,
-					x, y, width, height, cache);
+					x, y, width, height, cacheBuffer, orbit, resume, value);
+}
+
+static inline void *GetOrbit(const OrbitBuffer *buffer, uint_fast32_t index)
+{
+	return buffer->blocks[index / ORBIT_BLOCK_SIZE] +
+		(index % ORBIT_BLOCK_SIZE) * buffer->orbitSize;
+}
+
+/* Copy orbit into orbit buffer, and return its index. */
+static uint_fast32_t AddOrbit(OrbitBuffer *buffer, const void *orbit, size_t orbitSize)
+{
+	safePThreadSpinLock(&buffer->mutex);
+	if (buffer->orbitSize == 0) {
+		buffer->orbitSize = orbitSize;
+	}
+	uint_fast32_t res = buffer->nbOrbits++;
+	uint8_t **block = &buffer->blocks[res / ORBIT_BLOCK_SIZE];
+	if (*block == NULL) {
+		*block = (uint8_t *)safeMalloc("orbits block", ORBIT_BLOCK_SIZE * orbitSize);
+	}
+	safePThreadSpinUnlock(&buffer->mutex);
+	memcpy(GetOrbit(buffer, res), orbit, orbitSize);
+
+	return res;
+}
+
+/* Compute pixel, going on from its orbit if it has one in orbit buffer
+ * (state >= 2), and keep its value if it escapes, or its orbit
+ * otherwise.
+ */
+static inline Color ComputeFractalImagePixelOrbit(const DrawFractalArguments *arg,
+							const FractalEngine *engine,
+							uint_fast32_t width, uint_fast32_t height,
+							uint_fast32_t x, uint_fast32_t y,
+							uint32_t state, double *value)
+{
+	OrbitBuffer *orbits = arg->orbits;
+	uint_fast32_t index = y*width+x;
+	void *orbit = (state == 0) ? arg->orbit : GetOrbit(orbits, state-2);
+
+	Color res = aux_ComputeFractalImagePixel(arg->fractal, arg->render, engine, x, y,
+						width, height, arg->cacheBuffer, orbit,
+						state != 0, value);
+	if (*value >= 0) {
+		orbits->values[index] = *value;
+		orbits->state[index] = 1;
+	} else if (state == 0) {
+		orbits->state[index] = (uint32_t)AddOrbit(orbits, orbit, engine->orbitSize) + 2;
+	}
+
+	return res;
+}
+
+/* Look up all pixels of rectangle in cache at once, so that cache
+ * entries mutex is taken once per rectangle instead of once per pixel.
+ * Does nothing if cache is not used.
+ */
+static void FindRectangleInCache(const DrawFractalArguments *arg, const UIRectangle *rectangle)
+{
+	CacheLookup *lookup = arg->lookup;
+	if (lookup == NULL) {
+		return;
+	}
+	uint_fast32_t width = rectangle->x2+1-rectangle->x1;
+	uint_fast32_t nbPixels = width * (rectangle->y2+1-rectangle->y1);
+	if (lookup->capacity < nbPixels) {
+		lookup->capacity = nbPixels;
+		lookup->x = (uint_fast32_t *)safeRealloc("lookup x", lookup->x,
+						nbPixels * sizeof(uint_fast32_t));
+		lookup->y = (uint_fast32_t *)safeRealloc("lookup y", lookup->y,
+						nbPixels * sizeof(uint_fast32_t));
+		lookup->value = (double *)safeRealloc("lookup values", lookup->value,
+						nbPixels * sizeof(double));
+		lookup->found = (int *)safeRealloc("lookup found", lookup->found,
+						nbPixels * sizeof(int));
+	}
+	for (uint_fast32_t i = 0; i < nbPixels; ++i) {
+		lookup->x[i] = rectangle->x1 + i % width;
+		lookup->y[i] = rectangle->y1 + i / width;
+	}
+	lookup->rectangle = *rectangle;
+	lookup->nbFound = FindInCache(arg->cacheBuffer, nbPixels, lookup->x, lookup->y,
+					lookup->value, lookup->found);
+}
+
+/* Get value of pixel if it was found in cache by last rectangle lookup. */
+static inline int GetPixelFoundInCache(const CacheLookup *lookup, uint_fast32_t x,
+					uint_fast32_t y, double *value)
+{
+	int res = 0;
+	if (lookup != NULL && lookup->nbFound > 0 && x >= lookup->rectangle.x1 &&
+			x <= lookup->rectangle.x2 && y >= lookup->rectangle.y1 &&
+			y <= lookup->rectangle.y2) {
+		uint_fast32_t i = (y-lookup->rectangle.y1) *
+			(lookup->rectangle.x2+1-lookup->rectangle.x1) + x-lookup->rectangle.x1;
+		if (lookup->found[i]) {
+			*value = lookup->value[i];
+			res = 1;
+		}
+	}
+
+	return res;
 }
 
+/* Fractal value of pixel is put in value.
+ * Pixels whose exact value is in cache (found by last rectangle lookup)
+ * are not computed. Otherwise, if preview is used, cache array value is
+ * used if valid.
+ */
 static inline Color ComputeFractalImagePixel(const DrawFractalArguments *arg,
 						const FractalEngine *engine,
 						uint_fast32_t width, uint_fast32_t height,
 						uint_fast32_t x, uint_fast32_t y,
-						int useCache, FractalCache *cache)
+						int useCache, FractalCache *cache,
+						double *value)
 {
 	const Fractal *fractal = arg->fractal;
 	const RenderingParameters *render = arg->render;
+	uint32_t state = (arg->orbits == NULL) ? 0 : arg->orbits->state[y*width+x];
 
 	Color res;
-	if (useCache && cache != NULL) {
-		ArrayValue aVal = GetArrayValue(cache, x, y);
+	ArrayValue aVal;
+	int exactInCache = 0, inCache = 0;
+	if (state == 0 && useCache && cache != NULL) {
+		exactInCache = GetPixelFoundInCache(arg->lookup, x, y, value);
+		if (!exactInCache && arg->usePreview) {
+			aVal = GetArrayValue(cache, x, y);
+			inCache = isArrayValueValid(aVal, cache);
+		}
+	}
 
-		if (isArrayValueValid(aVal, cache)) {
-			res = GetColorFromAVal(aVal, render);
-		} else {
-			res = aux_ComputeFractalImagePixel(fractal, render, engine, x, y,
-								width, height, cache);
+	if (exactInCache) {
+		res = GetColorMapColor(&engine->colorMap, *value);
+	} else if (state == 1) {
+		/* Pixel escaped when drawn with a lower maximum number of iterations. */
+		*value = arg->orbits->values[y*width+x];
+		if (arg->cacheBuffer != NULL) {
+			AddToCacheInsertionBuffer(arg->cacheBuffer, x, y, *value);
 		}
+		res = GetColorMapColor(&engine->colorMap, *value);
+	} else if (inCache) {
+		res = GetColorFromAVal(aVal, render);
+		*value = aVal.value;
+	} else if (arg->orbits != NULL) {
+		res = ComputeFractalImagePixelOrbit(arg, engine, width, height, x, y, state, value);
 	} else {
 		res = aux_ComputeFractalImagePixel(fractal, render, engine, x, y,
-							width, height, cache);
+							width, height, arg->cacheBuffer, NULL, 0, value);
 	}
 
 
 	return res;
 }
 
-/* Compute (all) fractal values of given rectangle and render in image.
+/* Copy of the region of an image that is to be reused, so that it can be
+ * restored after being overwritten by cache preview.
+ */
+typedef struct s_RestoreImageRegionArguments {
+	Image *image;
+	Image *savedImage;
+	UIRectangle region;
+} RestoreImageRegionArguments;
+
+static void CopyImageRegion(Image *dst, uint_fast32_t dstX, uint_fast32_t dstY,
+				const Image *src, uint_fast32_t srcX, uint_fast32_t srcY,
+				uint_fast32_t width, uint_fast32_t height)
+{
+	uint_fast32_t pixelSize = 4 * src->bytesPerComponent;
+	for (uint_fast32_t j = 0; j < height; ++j) {
+		memcpy(dst->data + ((dstY+j) * dst->width + dstX) * pixelSize,
+			src->data + ((srcY+j) * src->width + srcX) * pixelSize,
+			width * pixelSize);
+	}
+}
+
+void FreeRestoreImageRegionArguments(void *arg)
+{
+	RestoreImageRegionArguments *c_arg = (RestoreImageRegionArguments *)arg;
+	FreeImage(*c_arg->savedImage);
+	free(c_arg->savedImage);
+}
+
+void *RestoreImageRegionThreadRoutine(void *arg)
+{
+	RestoreImageRegionArguments *c_arg =
+		(RestoreImageRegionArguments *)GetThreadArgBody(arg);
+	UIRectangle *region = &c_arg->region;
+
+	CopyImageRegion(c_arg->image, region->x1, region->y1, c_arg->savedImage, 0, 0,
+			c_arg->savedImage->width, c_arg->savedImage->height);
+
+	return NULL;
+}
+
+char restoreImageRegionMessage[] = "Restoring reused image region";
+
+static Task *CreateRestoreImageRegionTask(Image *image, const UIRectangle *region)
+{
+	RestoreImageRegionArguments arg;
+
+	arg.image = image;
+	arg.region = *region;
+	arg.savedImage = (Image *)safeMalloc("saved image", sizeof(Image));
+	CreateImage(arg.savedImage, region->x2+1-region->x1, region->y2+1-region->y1,
+			image->bytesPerComponent);
+	CopyImageRegion(arg.savedImage, 0, 0, image, region->x1, region->y1,
+			arg.savedImage->width, arg.savedImage->height);
+
+	Task *task = CreateTask(restoreImageRegionMessage, 1, &arg,
+				sizeof(RestoreImageRegionArguments),
+				RestoreImageRegionThreadRoutine,
+				FreeRestoreImageRegionArguments);
+
+	return task;
+}
+
+/* Compute (all) fractal values of tiles and render in image.
  */
 static void aux1_DrawFractalThreadRoutine(ThreadArgHeader *threadArgHeader,
 						const DrawFractalArguments *arg,
 						const FractalEngine *engine)
 {
 	Image *image = arg->image;
-	uint_fast32_t nbRectangles = arg->nbRectangles;
 	FractalCache *cache = arg->cache;
-	UIRectangle *rectangle;
-	uint_fast32_t rectHeight;
+	UIRectangle rectangle;
+	int progress;
 	int cancelRequested = CancelTaskRequested(threadArgHeader);
 
 	uint_fast32_t counter = 0;
-	for (uint_fast32_t i = 0; i < nbRectangles && !cancelRequested; ++i) {
-		rectangle = &arg->rectangles[i];
-		rectHeight = rectangle->y2+1 - rectangle->y1;
+	while (!cancelRequested && GetNextTile(arg->tiles, &rectangle, &progress)) {
+		/* Updating progress after each tile should be precise enough. */
+		SetThreadProgress(threadArgHeader, progress);
 
 		Color color;
-		for (uint_fast32_t j=rectangle->y1; j<=rectangle->y2 && !cancelRequested; j++) {
-			/* Updating progress after each line should be precise enough. */
-			SetThreadProgress(threadArgHeader, 100 * (i * rectHeight + (j-rectangle->y1)) /
-								(rectHeight * nbRectangles));
-			for (uint_fast32_t k=rectangle->x1; k<=rectangle->x2 && !cancelRequested; k++) {
+		double value;
+		UIRectangle row;
+		for (uint_fast32_t j=rectangle.y1; j<=rectangle.y2 && !cancelRequested; j++) {
+			InitUIRectangle(&row, rectangle.x1, j, rectangle.x2, j);
+			FindRectangleInCache(arg, &row);
+			for (uint_fast32_t k=rectangle.x1; k<=rectangle.x2 && !cancelRequested; k++) {
 				HandleRequests(32);
 				color = ComputeFractalImagePixel(arg, engine, image->width, image->height,
-									k, j, 1, cache);
+									k, j, 1, cache, &value);
 				PutPixelUnsafe(image,k,j,color);
+				if (arg->values != NULL) {
+					arg->values->values[j*image->width+k] = value;
+				}
 			}
 		}
 	}
@@ -709,62 +984,91 @@ static inline int_fast8_t GetCornerIndex(const UIRectangle *rectangle, uint_fast
 	}
 }
 
+/* Value of interpolated pixel at (x,y) (relative coordinates in quad).
+ * Values are interpolated like colors, unless some corner is in fractal
+ * space (negative value), in which case value of nearest corner is taken.
+ */
+static inline double QuadValueInterpolation(const double value[4], double x, double y)
+{
+	double res;
+	if (value[0] < 0 || value[1] < 0 || value[2] < 0 || value[3] < 0) {
+		res = value[((x < 0.5) ? 0 : 1) + ((y < 0.5) ? 0 : 2)];
+	} else {
+		res = (value[0]*(1.-x)+value[1]*x)*(1.-y) + (value[2]*(1.-x)+value[3]*x)*y;
+	}
+
+	return res;
+}
+
 /* Compute fractal values of given rectangle into fractal_table, according to
    its dissimilarity and the given dissimilarity threshold (i.e. either
    computes it really, or interpolate linearly from the corners), and render
    in image.
+   Width and height are those of the (possibly virtual) image being drawn;
+   pixel (x,y) is put at (x-originX,y-originY) in dst (and in value buffer,
+   if any).
  */
 static inline void aux2_DrawFractalThreadRoutine(const DrawFractalArguments *arg, const FractalEngine *engine,
-							const UIRectangle *rectangle)
+							uint_fast32_t width, uint_fast32_t height,
+							const UIRectangle *rectangle, Image *dst,
+							uint_fast32_t originX, uint_fast32_t originY)
 {
-	Image *image = arg->image;
-	uint_fast32_t width = image->width;
-	uint_fast32_t height = image->height;
 	double interpolationThreshold = arg->threshold;
 	FractalCache *cache = arg->cache;
+	double *values = (arg->values == NULL) ? NULL : arg->values->values;
 
 	Color corner[4];
+	double cornerValue[4];
+	FindRectangleInCache(arg, rectangle);
 	if (rectangle->x1 == rectangle->x2 && rectangle->y1 == rectangle->y2) {
 		/* Rectangle is just one pixel.*/
 		corner[0] = ComputeFractalImagePixel(arg,engine,width,height,rectangle->x1,rectangle->y1,1,
-							cache);
-		PutPixelUnsafe(image,rectangle->x1,rectangle->y1,corner[0]);
+							cache,&cornerValue[0]);
+		PutPixelUnsafe(dst,rectangle->x1-originX,rectangle->y1-originY,corner[0]);
+		if (values != NULL) {
+			values[(rectangle->y1-originY)*dst->width+rectangle->x1-originX] = cornerValue[0];
+		}
 		return;
 	} else if (rectangle->x1 == rectangle->x2) {
 		/* Rectangle is a vertical line.
 		   There are only two "corners".
 		*/
 		corner[0] = ComputeFractalImagePixel(arg,engine,width,height,rectangle->x1,rectangle->y1,1,
-							cache);
+							cache,&cornerValue[0]);
 		corner[1] = corner[0];
+		cornerValue[1] = cornerValue[0];
 		corner[2] = ComputeFractalImagePixel(arg,engine,width,height,rectangle->x1,rectangle->y2,1,
-							cache);
+							cache,&cornerValue[2]);
 		corner[3] = corner[2];
+		cornerValue[3] = cornerValue[2];
 		/* Even for a line, we can still use quad interpolation.*/
 	} else if (rectangle->y1 == rectangle->y2) {
 		/* Rectangle is a horizontal line.
 		   There are only two "corners".
 		*/
 		corner[0] = ComputeFractalImagePixel(arg,engine,width,height,rectangle->x1,rectangle->y1,1,
-							cache);
+							cache,&cornerValue[0]);
 		corner[1] = ComputeFractalImagePixel(arg,engine,width,height,rectangle->x2,rectangle->y1,1,
-							cache);
+							cache,&cornerValue[1]);
 		corner[2] = corner[0];
+		cornerValue[2] = cornerValue[0];
 		corner[3] = corner[1];
+		cornerValue[3] = cornerValue[1];
 		/* Even for a line, we can still use quad interpolation.*/
 	} else {
 		/* "Real" rectangle. Compute four corners. */
 		corner[0] = ComputeFractalImagePixel(arg,engine,width,height,rectangle->x1,rectangle->y1,1,
-							cache);
+							cache,&cornerValue[0]);
 		corner[1] = ComputeFractalImagePixel(arg,engine,width,height,rectangle->x2,rectangle->y1,1,
-							cache);
+							cache,&cornerValue[1]);
 		corner[2] = ComputeFractalImagePixel(arg,engine,width,height,rectangle->x1,rectangle->y2,1,
-							cache);
+							cache,&cornerValue[2]);
 		corner[3] = ComputeFractalImagePixel(arg,engine,width,height,rectangle->x2,rectangle->y2,1
-							,cache);
+							,cache,&cornerValue[3]);
 	}
 
 	Color color;
+	double value;
 	int_fast8_t index = -1;
 	if (QuadAvgDissimilarity(corner) < interpolationThreshold) {
 		/* Linear interpolation */
@@ -775,14 +1079,19 @@ static inline void aux2_DrawFractalThreadRoutine(const DrawFractalArguments *arg
 			y = ((double)(i-rectangle->y1)) / sy;
 			for (uint_fast32_t j=rectangle->x1; j<=rectangle->x2; j++) {
 				index = GetCornerIndex(rectangle, j, i);
+				x = ((double)(j-rectangle->x1)) / sx;
 				if (index >= 0) {
 					color = corner[index];
+					value = cornerValue[index];
 				} else {
-					x = ((double)(j-rectangle->x1)) / sx;
 					color = QuadLinearInterpolation(corner,x,y);
+					value = QuadValueInterpolation(cornerValue,x,y);
 				}
 
-				PutPixelUnsafe(image,j,i,color);
+				PutPixelUnsafe(dst,j-originX,i-originY,color);
+				if (values != NULL) {
+					values[(i-originY)*dst->width+j-originX] = value;
+				}
 			}
 		}
 	} else {
@@ -792,12 +1101,16 @@ static inline void aux2_DrawFractalThreadRoutine(const DrawFractalArguments *arg
 				index = GetCornerIndex(rectangle, j, i);
 				if (index >= 0) {
 					color = corner[index];
+					value = cornerValue[index];
 				} else {
 					color = ComputeFractalImagePixel(arg,engine,width,height,j,i,1,
-										cache);
+										cache,&value);
 				}
 
-				PutPixelUnsafe(image,j,i,color);
+				PutPixelUnsafe(dst,j-originX,i-originY,color);
+				if (values != NULL) {
+					values[(i-originY)*dst->width+j-originX] = value;
+				}
 			}
 		}
 	}
@@ -813,22 +1126,39 @@ void *DrawFractalThreadRoutine(void *arg)
 	if (res != 0) {
 		return NULL;
 	}
+	CacheInsertionBuffer cacheBuffer;
+	if (c_arg->cache != NULL) {
+		CreateCacheInsertionBuffer(&cacheBuffer, c_arg->cache, c_arg->fractal,
+					c_arg->image->width, c_arg->image->height);
+		c_arg->cacheBuffer = &cacheBuffer;
+		c_arg->lookup = (CacheLookup *)safeCalloc("cache lookup", 1, sizeof(CacheLookup));
+	}
+	if (c_arg->orbits != NULL) {
+		if (engine.orbitSize == 0) {
+			/* Orbits cannot be kept with this float precision. */
+			c_arg->orbits = NULL;
+		} else {
+			c_arg->orbit = safeMalloc("orbit", engine.orbitSize);
+		}
+	}
 
 	if (c_arg->size == 1) {
 		aux1_DrawFractalThreadRoutine(threadArgHeader, c_arg, &engine);
 	} else {
-		UIRectangle *currentRect;
+		UIRectangle currentRect;
+		int progress;
 		int cancelRequested = CancelTaskRequested(threadArgHeader);
 		uint_fast32_t counter = 0;
 
-		for (uint_fast32_t i = 0; i < c_arg->nbRectangles && !cancelRequested; ++i) {
-			currentRect = &c_arg->rectangles[i];
-			/* Cut rectangle into smaller rectangles, so that
+		while (!cancelRequested && GetNextTile(c_arg->tiles, &currentRect, &progress)) {
+			/* Updating progress after each tile should be precise enough. */
+			SetThreadProgress(threadArgHeader, progress);
+			/* Cut tile into smaller rectangles, so that
 			   all rectangles are smaller than quadInterpolationSize.
 			 */
 			UIRectangle *rectangle;
 			uint_fast32_t nbRectangles;
-			CutUIRectangleMaxSize(*currentRect, c_arg->size, &rectangle, &nbRectangles);
+			CutUIRectangleMaxSize(currentRect, c_arg->size, &rectangle, &nbRectangles);
 
 			/* If the rectangle dissimilarity is greater that threshold,
 			   we compute the fractal colors, otherwise we interpolate
@@ -842,18 +1172,28 @@ void *DrawFractalThreadRoutine(void *arg)
 			   for example.
 			 */
 			for (uint_fast32_t j = 0; j < nbRectangles && !cancelRequested; ++j) {
-				/* Updating after each rectangle should be precise enough. */
-				SetThreadProgress(threadArgHeader, 100 * (i * nbRectangles + j) /
-								(nbRectangles * c_arg->nbRectangles));
 				HandleRequests(0);
 
-				aux2_DrawFractalThreadRoutine(c_arg, &engine, &rectangle[j]);
+				aux2_DrawFractalThreadRoutine(c_arg, &engine, c_arg->image->width,
+							c_arg->image->height, &rectangle[j],
+							c_arg->image, 0, 0);
 			}
 			free(rectangle);
 		}
 		SetThreadProgress(threadArgHeader, 100);
 	}
 
+	if (c_arg->cache != NULL) {
+		FreeCacheInsertionBuffer(&cacheBuffer);
+		free(c_arg->lookup->x);
+		free(c_arg->lookup->y);
+		free(c_arg->lookup->value);
+		free(c_arg->lookup->found);
+		free(c_arg->lookup);
+	}
+	if (c_arg->orbits != NULL) {
+		free(c_arg->orbit);
+	}
 	FreeFractalEngine(&engine);
 
 	int canceled = CancelTaskRequested(threadArgHeader);
@@ -865,34 +1205,31 @@ char drawFractalMessage[] = "Drawing fractal";
 
 Task *aux_CreateDrawFractalTask(Image *image, const Fractal *fractal, const RenderingParameters *render,
 				uint_fast32_t quadInterpolationSize, double interpolationThreshold,
-				FloatPrecision floatPrecision, FractalCache *cache,
-				uint_fast32_t nbThreads)
+				FloatPrecision floatPrecision, FractalCache *cache, int usePreview,
+				ValueBuffer *values, OrbitBuffer *orbits,
+				const UIRectangle *reuseRegion,
+				uint_fast32_t focusX, uint_fast32_t focusY, uint_fast32_t nbThreads)
 {
-	if (image->width < 2 || image->height < 2) {
-		return DoNothingTask();
-	}
 	if (quadInterpolationSize == 0) {
 		quadInterpolationSize = 1;
 	}
 
-	uint_fast32_t nbPixels = image->width*image->height;
-	uint_fast32_t nbThreadsNeeded = nbThreads;
-	uint_fast32_t rectanglesPerThread = DEFAULT_RECTANGLES_PER_THREAD;
-	if (nbPixels <= nbThreadsNeeded) {
-		nbThreadsNeeded = nbPixels;
-		rectanglesPerThread = 1;
-	} else if (nbPixels < nbThreadsNeeded*rectanglesPerThread) {
-		rectanglesPerThread = nbPixels / nbThreadsNeeded;
+	/* Tile size is a multiple of quad interpolation size, so that
+	 * quads are aligned on the same grid whatever the tiles.
+	 */
+	uint_fast32_t tileSize = quadInterpolationSize;
+	if (tileSize < DEFAULT_TILE_SIZE) {
+		tileSize = (DEFAULT_TILE_SIZE / quadInterpolationSize) * quadInterpolationSize;
 	}
-	uint_fast32_t nbRectangles = nbThreadsNeeded*rectanglesPerThread;
-
-	UIRectangle *rectangle;
-	rectangle = (UIRectangle *)safeMalloc("rectangles", nbRectangles * sizeof(UIRectangle));
-	InitUIRectangle(&rectangle[0], 0, 0, image->width-1, image->height-1);
-	if (CutUIRectangleInN(rectangle[0], nbRectangles, rectangle)) {
-		FractalNow_error("Could not cut rectangle ((%"PRIuFAST32",%"PRIuFAST32"),\
-(%"PRIuFAST32",%"PRIuFAST32") in %"PRIuFAST32" parts.\n", rectangle[0].x1, rectangle[0].y1,
-			rectangle[0].x2, rectangle[0].y2, nbRectangles);
+	TileQueue *tiles = CreateTileQueue(image, tileSize, reuseRegion, focusX, focusY);
+	if (tiles->nbTiles == 0) {
+		/* Whole image is reused. */
+		FreeTileQueue(tiles);
+		return DoNothingTask();
+	}
+	uint_fast32_t nbThreadsNeeded = nbThreads;
+	if (tiles->nbTiles < nbThreadsNeeded) {
+		nbThreadsNeeded = tiles->nbTiles;
 	}
 	
 	DrawFractalArguments *arg;
@@ -902,14 +1239,18 @@ Task *aux_CreateDrawFractalTask(Image *image, const Fractal *fractal, const Rend
 	for (uint_fast32_t i = 0; i < nbThreadsNeeded; ++i) {
 		arg[i].threadId = i;
 		arg[i].cache = cache;
+		arg[i].cacheBuffer = NULL;
+		arg[i].lookup = NULL;
+		arg[i].usePreview = usePreview;
 		arg[i].image = image;
-		arg[i].copyImage = NULL;
+		arg[i].values = values;
+		arg[i].orbits = orbits;
+		arg[i].orbit = NULL;
 		arg[i].fractal = fractal;
 		arg[i].render = render;
 		arg[i].floatPrecision = floatPrecision;
 
-		arg[i].rectangles = &rectangle[i*rectanglesPerThread];
-		arg[i].nbRectangles = rectanglesPerThread;
+		arg[i].tiles = tiles;
 		arg[i].size = quadInterpolationSize;
 		arg[i].threshold = interpolationThreshold;
 	}
@@ -922,132 +1263,455 @@ Task *aux_CreateDrawFractalTask(Image *image, const Fractal *fractal, const Rend
 	return task;
 }
 
-inline Task *CreateDrawFractalTask(Image *image, const Fractal *fractal, const RenderingParameters *render,
+static void ResetOrbitBuffer(OrbitBuffer *buffer)
+{
+	if (buffer->state != NULL) {
+		memset(buffer->state, 0, buffer->width * buffer->height * sizeof(uint32_t));
+	}
+	for (uint_fast32_t i = 0; i < buffer->nbBlocks; ++i) {
+		free(buffer->blocks[i]);
+		buffer->blocks[i] = NULL;
+	}
+	buffer->orbitSize = 0;
+	buffer->nbOrbits = 0;
+}
+
+/* Orbit buffer is emptied if it holds orbits of another image, or
+ * orbits computed with a higher maximum number of iterations.
+ */
+static void PrepareOrbitBuffer(OrbitBuffer *buffer, uint_fast32_t width, uint_fast32_t height,
+				const Fractal *fractal, const RenderingParameters *render,
+				FloatPrecision floatPrecision)
+{
+	int reset = (!buffer->hasParameters || buffer->width != width ||
+			buffer->height != height || buffer->floatPrecision != floatPrecision);
+	if (!reset) {
+		uint_fast32_t maxIter = buffer->fractal.maxIter;
+		buffer->fractal.maxIter = fractal->maxIter;
+		reset = (maxIter > fractal->maxIter ||
+			PartCompareFractals(&buffer->fractal, fractal) ||
+			cmpBiggestF(buffer->fractal.centerX, fractal->centerX) != 0 ||
+			cmpBiggestF(buffer->fractal.centerY, fractal->centerY) != 0 ||
+			cmpBiggestF(buffer->fractal.spanX, fractal->spanX) != 0 ||
+			cmpBiggestF(buffer->fractal.spanY, fractal->spanY) != 0 ||
+			PartCompareRenderingParameters(&buffer->render, render));
+	}
+	if (!reset) {
+		return;
+	}
+
+	if (buffer->width != width || buffer->height != height) {
+		FreeOrbitBuffer(buffer);
+		CreateOrbitBuffer(buffer);
+		buffer->width = width;
+		buffer->height = height;
+		buffer->state = (uint32_t *)safeCalloc("orbit states", width * height,
+							sizeof(uint32_t));
+		buffer->values = (double *)safeMalloc("orbit values",
+							width * height * sizeof(double));
+		buffer->nbBlocks = (width * height + ORBIT_BLOCK_SIZE - 1) / ORBIT_BLOCK_SIZE;
+		buffer->blocks = (uint8_t **)safeCalloc("orbit blocks", buffer->nbBlocks,
+							sizeof(uint8_t *));
+	} else {
+		ResetOrbitBuffer(buffer);
+	}
+	if (buffer->hasParameters) {
+		FreeFractal(buffer->fractal);
+		FreeRenderingParameters(buffer->render);
+	}
+	buffer->fractal = CopyFractal(fractal);
+	buffer->render = CopyRenderingParameters(render);
+	buffer->floatPrecision = floatPrecision;
+	buffer->hasParameters = 1;
+}
+
+/* If preview is used, a preview image is first created from cache, and
+ * pixels that are not found exactly in cache are taken from preview when
+ * it has a value for them.
+ */
+static Task *CreateDrawFractalTaskWithPreview(Image *image, const Fractal *fractal,
+				const RenderingParameters *render,
 				uint_fast32_t quadInterpolationSize, double interpolationThreshold,
-				FloatPrecision floatPrecision, FractalCache *cache,
-				uint_fast32_t nbThreads)
+				FloatPrecision floatPrecision, FractalCache *cache, int usePreview,
+				ValueBuffer *values, OrbitBuffer *orbits,
+				const UIRectangle *reuseRegion,
+				uint_fast32_t focusX, uint_fast32_t focusY, uint_fast32_t nbThreads)
 {
+	if (image->width < 2 || image->height < 2) {
+		return DoNothingTask();
+	}
+
+	if (values != NULL) {
+		if (values->width != image->width || values->height != image->height) {
+			FreeValueBuffer(values);
+			CreateValueBuffer(values, image->width, image->height);
+		} else {
+			ResetValueBufferSamples(values);
+		}
+		values->maxValue = (double)fractal->maxIter+1;
+	}
+	if (orbits != NULL) {
+		PrepareOrbitBuffer(orbits, image->width, image->height, fractal, render,
+					floatPrecision);
+	}
+
+	/* Clip reuse region to image. */
+	UIRectangle region;
+	if (reuseRegion != NULL) {
+		if (reuseRegion->x1 >= image->width || reuseRegion->y1 >= image->height) {
+			reuseRegion = NULL;
+		} else {
+			InitUIRectangle(&region, reuseRegion->x1, reuseRegion->y1,
+				(reuseRegion->x2 < image->width) ? reuseRegion->x2 : image->width-1,
+				(reuseRegion->y2 < image->height) ? reuseRegion->y2 : image->height-1);
+			reuseRegion = &region;
+		}
+	}
+
+	/* Without preview, cache is not reset for fractal: cache entries
+	 * computed for another fractal must neither be looked up nor mixed
+	 * with new ones.
+	 */
+	if (cache != NULL && !usePreview && !isCacheUsable(cache, fractal, render)) {
+		cache = NULL;
+	}
+
 	Task *res;
-	if (cache == NULL) {
+	if (cache == NULL || !usePreview) {
 		res = aux_CreateDrawFractalTask(image, fractal, render, quadInterpolationSize,
-				interpolationThreshold, floatPrecision, cache, nbThreads);
+				interpolationThreshold, floatPrecision, cache, 0, values,
+				orbits, reuseRegion, focusX, focusY, nbThreads);
 	} else {
-		/* Create preview image from cache first. */
-		Task *subTasks[2];
-		subTasks[0] = CreateFractalCachePreviewTask(image, cache, fractal, render, 1, nbThreads);
-		subTasks[1] = aux_CreateDrawFractalTask(image, fractal, render, quadInterpolationSize,
-						interpolationThreshold, floatPrecision, cache, nbThreads);
+		/* Create preview image from cache first.
+		 * Preview overwrites reused region, which is thus restored
+		 * afterwards.
+		 */
+		Task *subTasks[3];
+		uint_fast32_t nbSubTasks = 0;
+		subTasks[nbSubTasks++] = CreateFractalCachePreviewTask(image, cache, fractal, render,
+									1, nbThreads);
+		if (reuseRegion != NULL) {
+			subTasks[nbSubTasks++] = CreateRestoreImageRegionTask(image, reuseRegion);
+		}
+		subTasks[nbSubTasks++] = aux_CreateDrawFractalTask(image, fractal, render,
+						quadInterpolationSize, interpolationThreshold,
+						floatPrecision, cache, 1, values, orbits,
+						reuseRegion, focusX, focusY, nbThreads);
 
-		res = CreateCompositeTask(NULL, 2, subTasks);
+		res = CreateCompositeTask(NULL, nbSubTasks, subTasks);
 	}
 	return res;
 }
 
+inline Task *CreateDrawFractalTask(Image *image, const Fractal *fractal, const RenderingParameters *render,
+				uint_fast32_t quadInterpolationSize, double interpolationThreshold,
+				FloatPrecision floatPrecision, FractalCache *cache,
+				ValueBuffer *values, OrbitBuffer *orbits,
+				const UIRectangle *reuseRegion,
+				uint_fast32_t focusX, uint_fast32_t focusY, uint_fast32_t nbThreads)
+{
+	return CreateDrawFractalTaskWithPreview(image, fractal, render, quadInterpolationSize,
+				interpolationThreshold, floatPrecision, cache, 1, values,
+				orbits, reuseRegion, focusX, focusY, nbThreads);
+}
+
 void DrawFractal(Image *image, const Fractal *fractal, const RenderingParameters *render,
 			uint_fast32_t quadInterpolationSize, double interpolationThreshold,
-			FloatPrecision floatPrecision, FractalCache *cache, Threads *threads)
+			FloatPrecision floatPrecision, FractalCache *cache, ValueBuffer *values,
+			Threads *threads)
+{
+	/* Nobody can see a preview while drawing is blocking. */
+	Task *task = CreateDrawFractalTaskWithPreview(image, fractal, render,
+				quadInterpolationSize, interpolationThreshold, floatPrecision,
+				cache, 0, values, NULL, NULL, image->width / 2,
+				image->height / 2, threads->N);
+	int unused = ExecuteTaskBlocking(task, threads);
+	UNUSED(unused);
+}
+
+/* Draw probe grid with given maximum number of iterations.
+ * escapeMaxIter of samples that escape for the first time is set to
+ * maxIter.
+ */
+static void DrawAutoMaxIterProbe(Image *probe, Fractal *fractal,
+				const RenderingParameters *render,
+				uint_fast32_t maxIter, FloatPrecision floatPrecision,
+				ValueBuffer *values, OrbitBuffer *orbits,
+				uint_fast32_t *escapeMaxIter, Threads *threads)
 {
-	Task *task = CreateDrawFractalTask(image, fractal, render, quadInterpolationSize,
-				interpolationThreshold, floatPrecision, cache, threads->N);
+	fractal->maxIter = maxIter;
+	Task *task = CreateDrawFractalTask(probe, fractal, render, 1, 0, floatPrecision,
+				NULL, values, orbits, NULL, probe->width / 2,
+				probe->height / 2, threads->N);
 	int unused = ExecuteTaskBlocking(task, threads);
 	UNUSED(unused);
+
+	uint_fast32_t nbEscaped = 0;
+	for (uint_fast32_t i = 0; i < values->width * values->height; ++i) {
+		if (values->values[i] >= 0) {
+			if (escapeMaxIter[i] > maxIter) {
+				escapeMaxIter[i] = maxIter;
+			}
+			++nbEscaped;
+		}
+	}
+	FractalNow_message(stdout, T_VERBOSE, "Probe samples escaped with %"PRIuFAST32
+				" iterations : %"PRIuFAST32"/%"PRIuFAST32".\n", maxIter, nbEscaped,
+				values->width * values->height);
+}
+
+/* Boundary samples for maxIter1 are samples unescaped with maxIter1 that
+ * have an escaped neighbour (4-connectivity).
+ * maxIter1 is stable if no more than threshold of boundary samples
+ * escape with maxIter2.
+ * Without boundary samples, all samples either escaped (maxIter1 is
+ * stable) or did not (probe only shows a plateau).
+ */
+static int isAutoMaxIterStable(const uint_fast32_t *escapeMaxIter, uint_fast32_t width,
+				uint_fast32_t height, uint_fast32_t maxIter1,
+				uint_fast32_t maxIter2)
+{
+	uint_fast32_t nbBoundary = 0, nbEscaped = 0;
+	for (uint_fast32_t j = 0; j < height; ++j) {
+		for (uint_fast32_t i = 0; i < width; ++i) {
+			const uint_fast32_t *sample = &escapeMaxIter[j*width+i];
+			if (*sample <= maxIter1) {
+				continue;
+			}
+			if ((i > 0 && sample[-1] <= maxIter1) ||
+				(i+1 < width && sample[1] <= maxIter1) ||
+				(j > 0 && sample[-width] <= maxIter1) ||
+				(j+1 < height && sample[width] <= maxIter1)) {
+				++nbBoundary;
+				if (*sample <= maxIter2) {
+					++nbEscaped;
+				}
+			}
+		}
+	}
+	FractalNow_message(stdout, T_VERBOSE, "Boundary samples escaped from %"PRIuFAST32
+				" to %"PRIuFAST32" iterations : %"PRIuFAST32"/%"PRIuFAST32".\n",
+				maxIter1, maxIter2, nbEscaped, nbBoundary);
+
+	if (nbBoundary == 0) {
+		return (escapeMaxIter[0] <= maxIter1);
+	} else {
+		return (nbEscaped <= AUTO_MAXITER_THRESHOLD * nbBoundary);
+	}
+}
+
+uint_fast32_t GetAutoMaxIter(const Fractal *fractal, const RenderingParameters *render,
+				FloatPrecision floatPrecision, Threads *threads)
+{
+	/* Probe grid has the aspect ratio of fractal. */
+	double ratio = (double)toDoubleBiggestF(fractal->spanY) /
+			(double)toDoubleBiggestF(fractal->spanX);
+	uint_fast32_t probeWidth = AUTO_MAXITER_PROBE_SIZE;
+	uint_fast32_t probeHeight = AUTO_MAXITER_PROBE_SIZE;
+	if (ratio < 1) {
+		probeHeight = (uint_fast32_t)(ratio * AUTO_MAXITER_PROBE_SIZE);
+	} else {
+		probeWidth = (uint_fast32_t)(AUTO_MAXITER_PROBE_SIZE / ratio);
+	}
+	probeWidth = (probeWidth < 2) ? 2 : probeWidth;
+	probeHeight = (probeHeight < 2) ? 2 : probeHeight;
+
+	Image probe;
+	CreateImage(&probe, probeWidth, probeHeight, render->bytesPerComponent);
+	ValueBuffer values;
+	CreateValueBuffer(&values, probeWidth, probeHeight);
+	OrbitBuffer orbits;
+	CreateOrbitBuffer(&orbits);
+	Fractal probeFractal = CopyFractal(fractal);
+	/* Smallest maximum number of iterations each sample escaped with. */
+	uint_fast32_t *escapeMaxIter = (uint_fast32_t *)safeMalloc("probe escapes",
+					probeWidth * probeHeight * sizeof(uint_fast32_t));
+	for (uint_fast32_t i = 0; i < probeWidth * probeHeight; ++i) {
+		escapeMaxIter[i] = UINT_FAST32_MAX;
+	}
+
+	/* Probe is drawn with maxIter[0], and with the two next doublings of
+	 * it (bounded by maximum number of iterations of fractal).
+	 * Stability of maxIter[0] is checked against maxIter[2] (checking
+	 * one doubling only would stop on plateaus).
+	 */
+	uint_fast32_t maxIter[3];
+	for (uint_fast32_t i = 0; i < 3; ++i) {
+		if (i == 0) {
+			maxIter[0] = (fractal->maxIter < AUTO_MAXITER_MIN) ? fractal->maxIter :
+					AUTO_MAXITER_MIN;
+		} else {
+			maxIter[i] = (maxIter[i-1] > fractal->maxIter / 2) ? fractal->maxIter :
+					2 * maxIter[i-1];
+		}
+		if (i == 0 || maxIter[i] != maxIter[i-1]) {
+			DrawAutoMaxIterProbe(&probe, &probeFractal, render, maxIter[i],
+						floatPrecision, &values, &orbits,
+						escapeMaxIter, threads);
+		}
+	}
+	while (maxIter[0] < fractal->maxIter && !isAutoMaxIterStable(escapeMaxIter,
+			probeWidth, probeHeight, maxIter[0], maxIter[2])) {
+		maxIter[0] = maxIter[1];
+		maxIter[1] = maxIter[2];
+		if (maxIter[1] < fractal->maxIter) {
+			maxIter[2] = (maxIter[1] > fractal->maxIter / 2) ? fractal->maxIter :
+					2 * maxIter[1];
+			DrawAutoMaxIterProbe(&probe, &probeFractal, render, maxIter[2],
+						floatPrecision, &values, &orbits,
+						escapeMaxIter, threads);
+		}
+	}
+	uint_fast32_t res = maxIter[0];
+
+	free(escapeMaxIter);
+	FreeFractal(probeFractal);
+	FreeOrbitBuffer(&orbits);
+	FreeValueBuffer(&values);
+	FreeImage(probe);
+
+	return res;
+}
+
+/* Oversampled image is computed by tiles of destination image.
+ * Sub-samples of each tile (plus the halo needed by the downscaling
+ * filter) are computed in a per-thread buffer and filtered straight
+ * into destination image, so that the whole oversampled image never
+ * needs to be stored.
+ */
+typedef struct s_OversampleFractalArguments {
+	DrawFractalArguments draw;
+	uint_fast32_t bigWidth;
+	uint_fast32_t bigHeight;
+	double invScaleX;
+	double invScaleY;
+	Filter *horizontalGaussianFilter;
+	Filter *verticalGaussianFilter;
+} OversampleFractalArguments;
+
+void FreeOversampleFractalArguments(void *arg)
+{
+	OversampleFractalArguments *c_arg = (OversampleFractalArguments *)arg;
+	if (c_arg->draw.threadId == 0) {
+		FreeTileQueue(c_arg->draw.tiles);
+		FreeFilter(*c_arg->horizontalGaussianFilter);
+		FreeFilter(*c_arg->verticalGaussianFilter);
+		free(c_arg->horizontalGaussianFilter);
+		free(c_arg->verticalGaussianFilter);
+	}
+}
+
+/* Get range of sub-samples needed to filter destination pixels x1 to x2. */
+static inline void GetOversampledRange(uint_fast32_t x1, uint_fast32_t x2, double invScale,
+					uint_fast32_t filterCenter, uint_fast32_t filterSize,
+					uint_fast32_t bigSize,
+					uint_fast32_t quadSize, uint_fast32_t *bx1,
+					uint_fast32_t *bx2)
+{
+	uint_fast32_t center = (x1+0.5)*invScale;
+	*bx1 = (center < filterCenter) ? 0 : center - filterCenter;
+	/* Align on quad grid of the oversampled image, so that
+	 * interpolated sub-samples do not depend on tiles.
+	 */
+	*bx1 = (*bx1 / quadSize) * quadSize;
+
+	center = (x2+0.5)*invScale;
+	*bx2 = center + filterSize - 1;
+	*bx2 = (*bx2 < filterCenter) ? 0 : *bx2 - filterCenter;
+	*bx2 = (*bx2 / quadSize + 1) * quadSize - 1;
+	if (*bx2 >= bigSize) {
+		*bx2 = bigSize - 1;
+	}
 }
 
-void *AntiAliaseFractalThreadRoutine(void *arg)
+void *OversampleFractalThreadRoutine(void *arg)
 {
 	ThreadArgHeader *threadArgHeader = GetThreadArgHeader(arg);
-	DrawFractalArguments *c_arg = (DrawFractalArguments *)GetThreadArgBody(arg);
-	Image *image = c_arg->image;
-	const Image *copyImage = c_arg->copyImage;
-	uint_fast32_t antialiasingSize = c_arg->size;
-	double threshold = c_arg->threshold;
-	FractalCache *cache = c_arg->cache;
-	uint_fast32_t width = image->width;
-	uint_fast32_t height = image->height;
+	OversampleFractalArguments *c_arg = (OversampleFractalArguments *)GetThreadArgBody(arg);
+	DrawFractalArguments *d_arg = &c_arg->draw;
+	Image *image = d_arg->image;
+	Filter *horizontalGaussianFilter = c_arg->horizontalGaussianFilter;
+	Filter *verticalGaussianFilter = c_arg->verticalGaussianFilter;
 	FractalEngine engine;
-	int res = CreateFractalEngine(&engine, c_arg->fractal, c_arg->render, c_arg->floatPrecision);
+	int res = CreateFractalEngine(&engine, d_arg->fractal, d_arg->render,
+					d_arg->floatPrecision);
 	if (res != 0) {
 		return NULL;
 	}
 
-	Image tmpImage1, tmpImage2;
-	CreateImage(&tmpImage1, antialiasingSize, antialiasingSize, image->bytesPerComponent);
-	CreateImage(&tmpImage2, 1, antialiasingSize, image->bytesPerComponent);
-
-	Filter horizontalGaussianFilter;
-	Filter verticalGaussianFilter;
-	CreateHorizontalGaussianFilter2(&horizontalGaussianFilter, antialiasingSize);
-	CreateVerticalGaussianFilter2(&verticalGaussianFilter, antialiasingSize);
-
-	uint_fast32_t center = (antialiasingSize-1) / 2;
-	uint_fast32_t bigWidth = width * antialiasingSize;
-	uint_fast32_t bigHeight = height * antialiasingSize;
-	Color C[9], c;
-	double max = 0;
+	uint_fast32_t pixelSize = 4 * image->bytesPerComponent;
+	uint_fast64_t bufferCapacity = 0;
+	uint8_t *bufferData = NULL;
+	Image buffer, tmpRow;
+	/* Vertically filtered buffer row, and buffer for ApplyFilterOnRow. */
+	uint_fast32_t rowCapacity = 0;
+	uint8_t *rowData = NULL;
+	double *filterBuffer = NULL;
 
+	UIRectangle tile, region;
 	UIRectangle *rectangle;
+	uint_fast32_t nbRectangles;
+	int progress;
 	uint_fast32_t counter = 0;
 	int cancelRequested = CancelTaskRequested(threadArgHeader);
-	for (uint_fast32_t i = 0; i < c_arg->nbRectangles && !cancelRequested; ++i) {
-		rectangle = &c_arg->rectangles[i];
-		uint_fast32_t rectHeight = rectangle->y2+1 - rectangle->y1;
-
-		uint_fast32_t y = rectangle->y1 * antialiasingSize;
-		for (uint_fast32_t j = rectangle->y1; j <= rectangle->y2
-				&& !cancelRequested; ++j, y+=antialiasingSize) {
-			SetThreadProgress(threadArgHeader, 100 * (i * rectHeight + (j-rectangle->y1)) /
-								(rectHeight * c_arg->nbRectangles));
-			uint_fast32_t x = rectangle->x1 * antialiasingSize;
-			for (uint_fast32_t k = rectangle->x1; k <= rectangle->x2
-					&& !cancelRequested; ++k, x+=antialiasingSize) {
-
-				C[0]  = iGetPixel(copyImage, k, j);
-				C[1]  = iGetPixel(copyImage, k-1, j-1);
-				C[2]  = iGetPixel(copyImage, k, j-1);
-				C[3]  = iGetPixel(copyImage, k+1, j-1);
-				C[4]  = iGetPixel(copyImage, k-1, j);
-				C[5]  = iGetPixel(copyImage, k+1, j);
-				C[6]  = iGetPixel(copyImage, k-1, j+1);
-				C[7]  = iGetPixel(copyImage, k, j+1);
-				C[8]  = iGetPixel(copyImage, k+1, j+1);
-
-				max = 0;
-				for (int_fast8_t l = 1; l < 9; ++l) {
-					max = fmaxl(max, ColorManhattanDistance(C[0], C[l]));
-				}
+	while (!cancelRequested && GetNextTile(d_arg->tiles, &tile, &progress)) {
+		SetThreadProgress(threadArgHeader, progress);
+
+		GetOversampledRange(tile.x1, tile.x2, c_arg->invScaleX, horizontalGaussianFilter->cx,
+					horizontalGaussianFilter->sx,
+					c_arg->bigWidth, d_arg->size, &region.x1, &region.x2);
+		GetOversampledRange(tile.y1, tile.y2, c_arg->invScaleY, verticalGaussianFilter->cy,
+					verticalGaussianFilter->sy,
+					c_arg->bigHeight, d_arg->size, &region.y1, &region.y2);
+		uint_fast64_t bufferSize = (uint_fast64_t)(region.x2-region.x1+1) *
+						(region.y2-region.y1+1) * pixelSize;
+		if (bufferSize > bufferCapacity) {
+			bufferCapacity = bufferSize;
+			bufferData = (uint8_t *)safeRealloc("oversampling buffer", bufferData,
+								bufferCapacity);
+		}
+		CreateImage2(&buffer, bufferData, region.x2-region.x1+1, region.y2-region.y1+1,
+				image->bytesPerComponent);
+		if (buffer.width > rowCapacity) {
+			rowCapacity = buffer.width;
+			rowData = (uint8_t *)safeRealloc("oversampling row", rowData,
+							rowCapacity*pixelSize);
+			filterBuffer = (double *)safeRealloc("filter buffer", filterBuffer,
+							3*rowCapacity*sizeof(double));
+		}
+		CreateImage2(&tmpRow, rowData, buffer.width, 1, image->bytesPerComponent);
+
+		/* Compute sub-samples. */
+		CutUIRectangleMaxSize(region, d_arg->size, &rectangle, &nbRectangles);
+		for (uint_fast32_t i = 0; i < nbRectangles && !cancelRequested; ++i) {
+			HandleRequests(0);
+			aux2_DrawFractalThreadRoutine(d_arg, &engine, c_arg->bigWidth,
+							c_arg->bigHeight, &rectangle[i], &buffer,
+							region.x1, region.y1);
+		}
+		free(rectangle);
 
-				if (max > threshold) {
-					for (uint_fast32_t l=0; l<antialiasingSize; ++l) {
-						for (uint_fast32_t m=0; m<antialiasingSize; ++m) {
-							HandleRequests(32);
-							c = ComputeFractalImagePixel(c_arg, &engine,
-											bigWidth, bigHeight,
-											x+m, y+l, 0, cache);
-							PutPixelUnsafe(&tmpImage1, m, l, c);
-						}
-					}
-
-					for (uint_fast32_t l = 0; l < antialiasingSize; ++l) {
-						c = ApplyFilterOnSinglePixel(&tmpImage1, center, l,
-										&horizontalGaussianFilter);
-						PutPixelUnsafe(&tmpImage2, 0, l, c);
-					}
-					c = ApplyFilterOnSinglePixel(&tmpImage2, 0, center,
-									&verticalGaussianFilter);
-
-					PutPixelUnsafe(image, k, j, c);
-				} else {
-					HandleRequests(32);
-				}
+		/* Filter them into image. Taps outside buffer are clamped,
+		 * which is the same as clamping them to oversampled image.
+		 */
+		for (uint_fast32_t j = tile.y1; j <= tile.y2 && !cancelRequested; ++j) {
+			HandleRequests(0);
+
+			uint_fast32_t y = (uint_fast32_t)((j+0.5)*c_arg->invScaleY) - region.y1;
+			ApplyFilterOnRow(&tmpRow, 0, 0, &buffer, 0, y, buffer.width,
+						verticalGaussianFilter, filterBuffer);
+			for (uint_fast32_t k = tile.x1; k <= tile.x2; ++k) {
+				uint_fast32_t x = (uint_fast32_t)((k+0.5)*c_arg->invScaleX) - region.x1;
+				PutPixelUnsafe(image, k, j, ApplyFilterOnSinglePixel(&tmpRow,
+					x, 0, horizontalGaussianFilter));
 			}
 		}
 	}
 	SetThreadProgress(threadArgHeader, 100);
 
-	FreeFilter(horizontalGaussianFilter);
-	FreeFilter(verticalGaussianFilter);
-	FreeImage(tmpImage1);
-	FreeImage(tmpImage2);
+	free(bufferData);
+	free(rowData);
+	free(filterBuffer);
 	FreeFractalEngine(&engine);
 
 	int canceled = CancelTaskRequested(threadArgHeader);
@@ -1055,78 +1719,967 @@ void *AntiAliaseFractalThreadRoutine(void *arg)
 	return (canceled ? PTHREAD_CANCELED : NULL);
 }
 
-char antiAliaseFractalMessage[] = "Anti-aliasing fractal";
+char oversampleFractalMessage[] = "Drawing oversampled fractal";
 
-Task *CreateAntiAliaseFractalTask(Image *image, const Fractal *fractal,
-					const RenderingParameters *render, uint_fast32_t antiAliasingSize,
-					double threshold, FloatPrecision floatPrecision,
-					FractalCache *cache, uint_fast32_t nbThreads)
+Task *CreateOversampleFractalTask(Image *image, const Fractal *fractal,
+					const RenderingParameters *render, double oversamplingSize,
+					uint_fast32_t quadInterpolationSize,
+					double interpolationThreshold, FloatPrecision floatPrecision,
+					uint_fast32_t nbThreads)
 {
-	if (antiAliasingSize == 0) {
+	uint_fast32_t bigWidth = image->width * oversamplingSize;
+	uint_fast32_t bigHeight = image->height * oversamplingSize;
+	if (image->width == 0 || image->height == 0 || bigWidth < 2 || bigHeight < 2) {
 		return DoNothingTask();
 	}
-	if (image->width*antiAliasingSize < 2 || image->height*antiAliasingSize < 2) {
-		return DoNothingTask();
+	if (bigWidth < image->width || bigHeight < image->height) {
+		FractalNow_error("Oversampling size must be >= 1.\n");
 	}
-	uint_fast32_t nbPixels = image->width*image->height;
-	uint_fast32_t nbThreadsNeeded = nbThreads;
-	uint_fast32_t rectanglesPerThread = DEFAULT_RECTANGLES_PER_THREAD;
-	if (nbPixels <= nbThreadsNeeded) {
-		nbThreadsNeeded = nbPixels;
-		rectanglesPerThread = 1;
-	} else if (nbPixels < nbThreadsNeeded*rectanglesPerThread) {
-		rectanglesPerThread = nbPixels / nbThreadsNeeded;
+	if (quadInterpolationSize == 0) {
+		quadInterpolationSize = 1;
 	}
-	uint_fast32_t nbRectangles = nbThreadsNeeded*rectanglesPerThread;
 
-	UIRectangle *rectangle;
-	rectangle = (UIRectangle *)safeMalloc("rectangles", nbRectangles * sizeof(UIRectangle));
-	InitUIRectangle(&rectangle[0], 0, 0, image->width-1, image->height-1);
-	if (CutUIRectangleInN(rectangle[0], nbRectangles, rectangle)) {
-		FractalNow_error("Could not cut rectangle ((%"PRIuFAST32",%"PRIuFAST32"),\
-(%"PRIuFAST32",%"PRIuFAST32") in %"PRIuFAST32" parts.\n", rectangle[0].x1, rectangle[0].y1,
-			rectangle[0].x2, rectangle[0].y2, nbRectangles);
+	double invScaleX = bigWidth / (double)image->width;
+	double invScaleY = bigHeight / (double)image->height;
+
+	Filter *horizontalGaussianFilter =
+		(Filter *)safeMalloc("horizontal gaussian filter", sizeof(Filter));
+	Filter *verticalGaussianFilter =
+		(Filter *)safeMalloc("vertical gaussian filter", sizeof(Filter));
+	CreateHorizontalGaussianFilter2(horizontalGaussianFilter, invScaleX);
+	CreateVerticalGaussianFilter2(verticalGaussianFilter, invScaleY);
+
+	TileQueue *tiles = CreateTileQueue(image, DEFAULT_TILE_SIZE, NULL, image->width / 2,
+						image->height / 2);
+	uint_fast32_t nbThreadsNeeded = nbThreads;
+	if (tiles->nbTiles < nbThreadsNeeded) {
+		nbThreadsNeeded = tiles->nbTiles;
 	}
-	
-	DrawFractalArguments *arg;
-	arg = (DrawFractalArguments *)safeMalloc("arguments", nbThreadsNeeded*sizeof(DrawFractalArguments));
 
-	Image *copyImage = (Image *)safeMalloc("copyImage", sizeof(Image));
-	*copyImage = CloneImage(image);
+	OversampleFractalArguments *arg;
+	arg = (OversampleFractalArguments *)safeMalloc("arguments", nbThreadsNeeded *
+							sizeof(OversampleFractalArguments));
 	for (uint_fast32_t i = 0; i < nbThreadsNeeded; ++i) {
-		arg[i].threadId = i;
-		/* No copy for image.
-		 * Concurrent read is OK.
-		 */
-		arg[i].image = image;
-		arg[i].copyImage = copyImage;
-		arg[i].cache = cache;
-		/* Fractal is not copied because it is not modified.*/
+		arg[i].draw.threadId = i;
+		arg[i].draw.cache = NULL;
+		arg[i].draw.cacheBuffer = NULL;
+		arg[i].draw.lookup = NULL;
+		arg[i].draw.usePreview = 0;
+		arg[i].draw.image = image;
+		arg[i].draw.fractal = fractal;
+		arg[i].draw.render = render;
+		arg[i].draw.values = NULL;
+		arg[i].draw.orbits = NULL;
+		arg[i].draw.orbit = NULL;
+		arg[i].draw.floatPrecision = floatPrecision;
+		arg[i].draw.tiles = tiles;
+		arg[i].draw.size = quadInterpolationSize;
+		arg[i].draw.threshold = interpolationThreshold;
+
+		arg[i].bigWidth = bigWidth;
+		arg[i].bigHeight = bigHeight;
+		arg[i].invScaleX = invScaleX;
+		arg[i].invScaleY = invScaleY;
+		arg[i].horizontalGaussianFilter = horizontalGaussianFilter;
+		arg[i].verticalGaussianFilter = verticalGaussianFilter;
+	}
+	Task *task = CreateTask(oversampleFractalMessage, nbThreadsNeeded, arg,
+					sizeof(OversampleFractalArguments),
+					OversampleFractalThreadRoutine,
+					FreeOversampleFractalArguments);
+
+	free(arg);
+
+	return task;
+}
+
+void OversampleFractal(Image *image, const Fractal *fractal, const RenderingParameters *render,
+			double oversamplingSize, uint_fast32_t quadInterpolationSize,
+			double interpolationThreshold, FloatPrecision floatPrecision,
+			Threads *threads)
+{
+	Task *task = CreateOversampleFractalTask(image, fractal, render, oversamplingSize,
+				quadInterpolationSize, interpolationThreshold,
+				floatPrecision, threads->N);
+	int unused = ExecuteTaskBlocking(task, threads);
+	UNUSED(unused);
+}
+
+/* Anti-aliasing samples are computed on a sub-pixel grid of that size.
+ * It is odd so that first sample is exactly at the center of the pixel.
+ */
+#define AA_SUBPIXEL_GRID_SIZE (uint_fast32_t)(255)
+
+/* Anti-aliasing accumulators are allocated by blocks of that size.
+ * Blocks match anti-aliasing tiles so that each block is only
+ * accessed by the thread that anti-aliases the tile.
+ */
+#define AA_BLOCK_SIZE DEFAULT_TILE_SIZE
+
+/* Sub-pixel positions of samples follow the R2 sequence (additive
+ * recurrence based on the plastic number), which is low-discrepancy
+ * for any number of samples. First samples of the sequence are thus
+ * well distributed whatever the anti-aliasing size.
+ * Points of the sequence are taken by pairs symmetric about pixel
+ * center (after first sample, at the center), so that samples are
+ * centered on the pixel: the first points of R2 alone are not, which
+ * would shift anti-aliased pixels.
+ */
+#define AA_R2_ALPHA1 (double)(0.7548776662466927)
+#define AA_R2_ALPHA2 (double)(0.5698402909980532)
+
+void InitAntiAliasingAccumulator(AntiAliasingAccumulator *accumulator, uint_fast32_t width,
+					uint_fast32_t height)
+{
+	accumulator->width = width;
+	accumulator->height = height;
+	accumulator->nbBlocksX = (width + AA_BLOCK_SIZE - 1) / AA_BLOCK_SIZE;
+	accumulator->nbBlocksY = (height + AA_BLOCK_SIZE - 1) / AA_BLOCK_SIZE;
+
+	uint_fast32_t nbBlocks = accumulator->nbBlocksX * accumulator->nbBlocksY;
+	if (nbBlocks == 0) {
+		accumulator->blocks = NULL;
+	} else {
+		accumulator->blocks = (AntiAliasingPixel **)safeMalloc("anti-aliasing blocks",
+						nbBlocks * sizeof(AntiAliasingPixel *));
+		for (uint_fast32_t i = 0; i < nbBlocks; ++i) {
+			accumulator->blocks[i] = NULL;
+		}
+	}
+}
+
+void ResetAntiAliasingAccumulator(AntiAliasingAccumulator *accumulator)
+{
+	uint_fast32_t nbBlocks = accumulator->nbBlocksX * accumulator->nbBlocksY;
+	for (uint_fast32_t i = 0; i < nbBlocks; ++i) {
+		free(accumulator->blocks[i]);
+		accumulator->blocks[i] = NULL;
+	}
+}
+
+void FreeAntiAliasingAccumulator(AntiAliasingAccumulator *accumulator)
+{
+	ResetAntiAliasingAccumulator(accumulator);
+	free(accumulator->blocks);
+}
+
+/* Blocks of sample values match those of anti-aliasing accumulators. */
+void CreateValueBuffer(ValueBuffer *buffer, uint_fast32_t width, uint_fast32_t height)
+{
+	buffer->width = width;
+	buffer->height = height;
+	buffer->maxValue = 0;
+	buffer->values = (double *)safeCalloc("values", (uint_least64_t)width * height,
+						sizeof(double));
+	buffer->nbBlocksX = (width + AA_BLOCK_SIZE - 1) / AA_BLOCK_SIZE;
+	buffer->nbBlocksY = (height + AA_BLOCK_SIZE - 1) / AA_BLOCK_SIZE;
+
+	uint_fast32_t nbBlocks = buffer->nbBlocksX * buffer->nbBlocksY;
+	if (nbBlocks == 0) {
+		buffer->blocks = NULL;
+	} else {
+		buffer->blocks = (SampleValues **)safeMalloc("sample values blocks",
+						nbBlocks * sizeof(SampleValues *));
+		for (uint_fast32_t i = 0; i < nbBlocks; ++i) {
+			buffer->blocks[i] = NULL;
+		}
+	}
+}
+
+void ResetValueBufferSamples(ValueBuffer *buffer)
+{
+	uint_fast32_t nbBlocks = buffer->nbBlocksX * buffer->nbBlocksY;
+	for (uint_fast32_t i = 0; i < nbBlocks; ++i) {
+		if (buffer->blocks[i] != NULL) {
+			for (uint_fast32_t j = 0; j < AA_BLOCK_SIZE * AA_BLOCK_SIZE; ++j) {
+				free(buffer->blocks[i][j].values);
+			}
+			free(buffer->blocks[i]);
+			buffer->blocks[i] = NULL;
+		}
+	}
+}
+
+void MoveValueBuffer(ValueBuffer *buffer, int_fast32_t dx, int_fast32_t dy)
+{
+	uint_fast32_t absDx = (dx < 0) ? -dx : dx;
+	uint_fast32_t absDy = (dy < 0) ? -dy : dy;
+	if (absDx < buffer->width && absDy < buffer->height) {
+		uint_fast32_t srcX = (dx < 0) ? absDx : 0;
+		uint_fast32_t dstX = (dx < 0) ? 0 : absDx;
+		uint_fast32_t length = buffer->width - absDx;
+		uint_fast32_t nbRows = buffer->height - absDy;
+		/* Copy rows in an order that does not overwrite rows
+		 * still to be copied.
+		 */
+		for (uint_fast32_t i = 0; i < nbRows; ++i) {
+			uint_fast32_t dstY = (dy < 0) ? i : buffer->height-1-i;
+			uint_fast32_t srcY = (dy < 0) ? i+absDy : dstY-absDy;
+			memmove(buffer->values + dstY * buffer->width + dstX,
+				buffer->values + srcY * buffer->width + srcX,
+				length * sizeof(double));
+		}
+	}
+	ResetValueBufferSamples(buffer);
+}
+
+void FreeValueBuffer(ValueBuffer *buffer)
+{
+	ResetValueBufferSamples(buffer);
+	free(buffer->blocks);
+	free(buffer->values);
+}
+
+void CreateOrbitBuffer(OrbitBuffer *buffer)
+{
+	buffer->width = 0;
+	buffer->height = 0;
+	buffer->hasParameters = 0;
+	buffer->state = NULL;
+	buffer->values = NULL;
+	buffer->orbitSize = 0;
+	buffer->nbOrbits = 0;
+	buffer->nbBlocks = 0;
+	buffer->blocks = NULL;
+	safePThreadSpinInit(&buffer->mutex, SPIN_INIT_ATTR);
+}
+
+void FreeOrbitBuffer(OrbitBuffer *buffer)
+{
+	ResetOrbitBuffer(buffer);
+	if (buffer->hasParameters) {
+		FreeFractal(buffer->fractal);
+		FreeRenderingParameters(buffer->render);
+	}
+	free(buffer->blocks);
+	free(buffer->values);
+	free(buffer->state);
+	safePThreadSpinDestroy(&buffer->mutex);
+}
+
+/* Get sample values of pixel, making room for nbSamples values.
+ * Sample values are only kept while they are in step with accumulated
+ * samples; returns NULL otherwise.
+ * Must only be called by the thread detecting edges in the tile
+ * containing pixel.
+ */
+static SampleValues *GetSampleValues(ValueBuffer *buffer, uint_fast32_t x, uint_fast32_t y,
+					const AntiAliasingPixel *pixel, uint_fast32_t nbSamples)
+{
+	SampleValues **block = &buffer->blocks[(y / AA_BLOCK_SIZE) *
+						buffer->nbBlocksX + x / AA_BLOCK_SIZE];
+	if (*block == NULL) {
+		*block = (SampleValues *)safeCalloc("sample values block",
+					AA_BLOCK_SIZE * AA_BLOCK_SIZE, sizeof(SampleValues));
+	}
+	SampleValues *res = &(*block)[(y % AA_BLOCK_SIZE) * AA_BLOCK_SIZE + x % AA_BLOCK_SIZE];
+
+	if (res->capacity < nbSamples) {
+		res->values = (double *)safeRealloc("sample values", res->values,
+						nbSamples * sizeof(double));
+		res->capacity = nbSamples;
+	}
+	if (pixel->nbSamples == 0) {
+		res->nbSamples = 0;
+	} else if (res->nbSamples != pixel->nbSamples) {
+		res->nbSamples = 0;
+		res = NULL;
+	}
+
+	return res;
+}
+
+/* Get accumulated samples of pixel, allocating its block if needed.
+ * Must only be called by the thread detecting edges in the tile
+ * containing pixel.
+ */
+static inline AntiAliasingPixel *GetAntiAliasingPixel(AntiAliasingAccumulator *accumulator,
+							uint_fast32_t x, uint_fast32_t y)
+{
+	AntiAliasingPixel **block = &accumulator->blocks[(y / AA_BLOCK_SIZE) *
+						accumulator->nbBlocksX + x / AA_BLOCK_SIZE];
+	if (*block == NULL) {
+		*block = (AntiAliasingPixel *)safeCalloc("anti-aliasing block",
+					AA_BLOCK_SIZE * AA_BLOCK_SIZE, sizeof(AntiAliasingPixel));
+	}
+
+	return &(*block)[(y % AA_BLOCK_SIZE) * AA_BLOCK_SIZE + x % AA_BLOCK_SIZE];
+}
+
+static inline float GetMaxComponent(uint_fast8_t bytesPerComponent)
+{
+	return (bytesPerComponent == 1) ? UINT8_MAX : UINT16_MAX;
+}
+
+static inline void AddAntiAliasingColor(AntiAliasingPixel *pixel, Color color)
+{
+	float max = GetMaxComponent(color.bytesPerComponent);
+	float r = color.r / max, g = color.g / max, b = color.b / max;
+
+	pixel->r += color.r;
+	pixel->g += color.g;
+	pixel->b += color.b;
+	pixel->sqSum += r*r + g*g + b*b;
+	++pixel->nbSamples;
+}
+
+/* Whether estimated noise of pixel value (standard error of the mean
+ * of its samples, per normalized component) is below threshold.
+ */
+static inline int AntiAliasingPixelConverged(const AntiAliasingPixel *pixel,
+						double noiseThreshold, uint_fast8_t bytesPerComponent)
+{
+	double max = GetMaxComponent(bytesPerComponent) * pixel->nbSamples;
+	double r = pixel->r / max, g = pixel->g / max, b = pixel->b / max;
+	double variance = (pixel->sqSum / pixel->nbSamples - (r*r + g*g + b*b)) / 3;
+
+	return (variance <= noiseThreshold * noiseThreshold * pixel->nbSamples);
+}
+
+static inline Color GetAntiAliasingPixelColor(const AntiAliasingPixel *pixel,
+						uint_fast8_t bytesPerComponent)
+{
+	Color res;
+	res.bytesPerComponent = bytesPerComponent;
+	res.r = (uint_fast16_t)(pixel->r / pixel->nbSamples + 0.5f);
+	res.g = (uint_fast16_t)(pixel->g / pixel->nbSamples + 0.5f);
+	res.b = (uint_fast16_t)(pixel->b / pixel->nbSamples + 0.5f);
+
+	return res;
+}
+
+/* Pixel selected for anti-aliasing. */
+typedef struct s_AntiAliasingPixelRef {
+	uint_fast32_t x, y;
+	AntiAliasingPixel *pixel;
+	SampleValues *samples;
+} AntiAliasingPixelRef;
+
+/* Pixels selected by edge detection pass, in the order of the tiles
+ * they belong to. Threads of supersampling pass take them by chunks,
+ * so that work is balanced whatever the location of edges.
+ */
+typedef struct s_AntiAliasingPixelList {
+	uint_fast32_t nbPixels;
+	uint_fast32_t capacity;
+	AntiAliasingPixelRef *pixels;
+	uint_fast32_t next;
+	pthread_spinlock_t mutex;
+} AntiAliasingPixelList;
+
+/* Number of samples computed between two noise estimations, when
+ * anti-aliasing is variance-driven.
+ */
+#define AA_BATCH_SIZE (uint_fast32_t)(4)
+
+/* Number of pixels that threads take at once from pixel list. */
+#define AA_CHUNK_SIZE (uint_fast32_t)(32)
+
+static AntiAliasingPixelList *CreateAntiAliasingPixelList(void)
+{
+	AntiAliasingPixelList *res = (AntiAliasingPixelList *)safeMalloc("pixel list",
+						sizeof(AntiAliasingPixelList));
+	res->nbPixels = 0;
+	res->capacity = 0;
+	res->pixels = NULL;
+	res->next = 0;
+	safePThreadSpinInit(&res->mutex, SPIN_INIT_ATTR);
+
+	return res;
+}
+
+static void AppendAntiAliasingPixels(AntiAliasingPixelList *list,
+					const AntiAliasingPixelRef *pixels, uint_fast32_t nbPixels)
+{
+	if (nbPixels == 0) {
+		return;
+	}
+	safePThreadSpinLock(&list->mutex);
+	if (list->nbPixels + nbPixels > list->capacity) {
+		list->capacity = 2 * (list->nbPixels + nbPixels);
+		list->pixels = (AntiAliasingPixelRef *)safeRealloc("pixel list", list->pixels,
+						list->capacity * sizeof(AntiAliasingPixelRef));
+	}
+	memcpy(list->pixels + list->nbPixels, pixels, nbPixels * sizeof(AntiAliasingPixelRef));
+	list->nbPixels += nbPixels;
+	safePThreadSpinUnlock(&list->mutex);
+}
+
+/* Get next chunk of pixels to supersample.
+ * Returns 0 if there is no pixel left.
+ */
+static int GetNextAntiAliasingPixels(AntiAliasingPixelList *list, uint_fast32_t *first,
+					uint_fast32_t *nbPixels, int *progress)
+{
+	int res = 0;
+	safePThreadSpinLock(&list->mutex);
+	if (list->next < list->nbPixels) {
+		*first = list->next;
+		*nbPixels = list->nbPixels - list->next;
+		if (*nbPixels > AA_CHUNK_SIZE) {
+			*nbPixels = AA_CHUNK_SIZE;
+		}
+		*progress = (int)(100 * (uint_fast64_t)list->next / list->nbPixels);
+		list->next += *nbPixels;
+		res = 1;
+	}
+	safePThreadSpinUnlock(&list->mutex);
+
+	return res;
+}
+
+static void FreeAntiAliasingPixelList(AntiAliasingPixelList *list)
+{
+	safePThreadSpinDestroy(&list->mutex);
+	free(list->pixels);
+	free(list);
+}
+
+typedef struct s_AntiAliaseFractalArguments {
+	uint_fast32_t threadId;
+	FractalCache *cache;
+	CacheInsertionBuffer *cacheBuffer; /* Set by each thread (if cache is not NULL). */
+	Image *image;
+	ValueBuffer *values;
+	const Fractal *fractal;
+	const RenderingParameters *render;
+	FloatPrecision floatPrecision;
+	TileQueue *tiles;
+	AntiAliasingPixelList *pixels;
+	AntiAliasingAccumulator *accumulator;
+	int freeAccumulator;
+	uint_fast32_t nbSamples;
+	double threshold;
+	double noiseThreshold;
+} AntiAliaseFractalArguments;
+
+void FreeDetectEdgesArguments(void *arg)
+{
+	AntiAliaseFractalArguments *c_arg = (AntiAliaseFractalArguments *)arg;
+	if (c_arg->threadId == 0) {
+		FreeTileQueue(c_arg->tiles);
+	}
+}
+
+void FreeSupersampleFractalArguments(void *arg)
+{
+	AntiAliaseFractalArguments *c_arg = (AntiAliaseFractalArguments *)arg;
+	if (c_arg->threadId == 0) {
+		FreeAntiAliasingPixelList(c_arg->pixels);
+		if (c_arg->freeAccumulator) {
+			FreeAntiAliasingAccumulator(c_arg->accumulator);
+			free(c_arg->accumulator);
+		}
+	}
+}
+
+/* Select pixels of tile that differ too much from any neighbour.
+ * Tile and its one-pixel halo are read once into halo buffer (rows
+ * of (tile width + 2) colors), so that neighbours do not need to be
+ * clamped to image for each pixel.
+ * Image color of a pixel is not used as a sample: it may have been
+ * interpolated, or anti-aliased already (reused or restored image).
+ */
+static uint_fast32_t DetectEdges(const AntiAliaseFractalArguments *arg,
+				const UIRectangle *tile, Color *halo,
+				AntiAliasingPixelRef *edges)
+{
+	const Image *image = arg->image;
+	uint_fast32_t haloWidth = tile->x2 - tile->x1 + 3;
+	uint_fast32_t haloHeight = tile->y2 - tile->y1 + 3;
+
+	Color *p = halo;
+	uint_fast32_t x, y;
+	for (uint_fast32_t j = 0; j < haloHeight; ++j) {
+		y = (tile->y1 + j == 0) ? 0 : tile->y1 + j - 1;
+		y = (y >= image->height) ? image->height-1 : y;
+		for (uint_fast32_t i = 0; i < haloWidth; ++i) {
+			x = (tile->x1 + i == 0) ? 0 : tile->x1 + i - 1;
+			x = (x >= image->width) ? image->width-1 : x;
+			*(p++) = iGetPixelUnsafe(image, x, y);
+		}
+	}
+
+	uint_fast32_t res = 0;
+	AntiAliasingPixel *pixel;
+	Color C;
+	const Color *row;
+	int isEdge;
+	for (uint_fast32_t j = 1; j < haloHeight-1; ++j) {
+		row = halo + j * haloWidth;
+		for (uint_fast32_t i = 1; i < haloWidth-1; ++i) {
+			C = row[i];
+			isEdge = (ColorManhattanDistance(C, row[i-haloWidth-1]) > arg->threshold ||
+				ColorManhattanDistance(C, row[i-haloWidth]) > arg->threshold ||
+				ColorManhattanDistance(C, row[i-haloWidth+1]) > arg->threshold ||
+				ColorManhattanDistance(C, row[i-1]) > arg->threshold ||
+				ColorManhattanDistance(C, row[i+1]) > arg->threshold ||
+				ColorManhattanDistance(C, row[i+haloWidth-1]) > arg->threshold ||
+				ColorManhattanDistance(C, row[i+haloWidth]) > arg->threshold ||
+				ColorManhattanDistance(C, row[i+haloWidth+1]) > arg->threshold);
+			if (!isEdge) {
+				continue;
+			}
+
+			edges[res].x = tile->x1 + i - 1;
+			edges[res].y = tile->y1 + j - 1;
+			pixel = GetAntiAliasingPixel(arg->accumulator, edges[res].x, edges[res].y);
+			if (pixel->nbSamples < arg->nbSamples) {
+				edges[res].samples = (arg->values == NULL) ? NULL :
+					GetSampleValues(arg->values, edges[res].x, edges[res].y,
+							pixel, arg->nbSamples);
+				edges[res++].pixel = pixel;
+			}
+		}
+	}
+
+	return res;
+}
+
+void *DetectEdgesThreadRoutine(void *arg)
+{
+	ThreadArgHeader *threadArgHeader = GetThreadArgHeader(arg);
+	AntiAliaseFractalArguments *c_arg = (AntiAliaseFractalArguments *)GetThreadArgBody(arg);
+
+	Color *halo = (Color *)safeMalloc("halo buffer", (DEFAULT_TILE_SIZE+2) *
+						(DEFAULT_TILE_SIZE+2) * sizeof(Color));
+	AntiAliasingPixelRef *edges = (AntiAliasingPixelRef *)safeMalloc("edges",
+				DEFAULT_TILE_SIZE * DEFAULT_TILE_SIZE * sizeof(AntiAliasingPixelRef));
+
+	UIRectangle rectangle;
+	int progress;
+	uint_fast32_t counter = 0;
+	int cancelRequested = CancelTaskRequested(threadArgHeader);
+	while (!cancelRequested && GetNextTile(c_arg->tiles, &rectangle, &progress)) {
+		SetThreadProgress(threadArgHeader, progress);
+		HandleRequests(0);
+
+		AppendAntiAliasingPixels(c_arg->pixels, edges,
+					DetectEdges(c_arg, &rectangle, halo, edges));
+	}
+	SetThreadProgress(threadArgHeader, 100);
+
+	free(halo);
+	free(edges);
+
+	int canceled = CancelTaskRequested(threadArgHeader);
+
+	return (canceled ? PTHREAD_CANCELED : NULL);
+}
+
+/* Get sub-pixel position of ith sample of a pixel. */
+static inline void GetAntiAliasingSamplePosition(uint_fast32_t i, uint_fast32_t *subX,
+							uint_fast32_t *subY)
+{
+	uint_fast32_t n = (i+1) / 2;
+	double u = 0.5 + n * AA_R2_ALPHA1;
+	double v = 0.5 + n * AA_R2_ALPHA2;
+	*subX = (uint_fast32_t)((u - floor(u)) * AA_SUBPIXEL_GRID_SIZE);
+	*subY = (uint_fast32_t)((v - floor(v)) * AA_SUBPIXEL_GRID_SIZE);
+	if (i > 0 && i % 2 == 0) {
+		*subX = AA_SUBPIXEL_GRID_SIZE-1 - *subX;
+		*subY = AA_SUBPIXEL_GRID_SIZE-1 - *subY;
+	}
+}
+
+/* Samples of a pixel looked up in cache (see FindAntiAliasingSamples). */
+typedef struct AntiAliasingSampleLookup {
+	uint_fast32_t first;
+	uint_fast32_t nbFound;
+	uint_fast32_t *sampleX;
+	uint_fast32_t *sampleY;
+	double *value;
+	int *found;
+} AntiAliasingSampleLookup;
+
+/* Look up samples of pixel (x,y) that it still needs in cache, all at
+ * once so that cache entries mutex is taken once per pixel.
+ */
+static void FindAntiAliasingSamples(const AntiAliaseFractalArguments *arg,
+					AntiAliasingSampleLookup *lookup,
+					const AntiAliasingPixel *pixel,
+					uint_fast32_t x, uint_fast32_t y)
+{
+	uint_fast32_t subX, subY;
+	lookup->first = pixel->nbSamples;
+	lookup->nbFound = 0;
+	if (arg->cacheBuffer == NULL || lookup->first >= arg->nbSamples) {
+		return;
+	}
+	for (uint_fast32_t i = lookup->first; i < arg->nbSamples; ++i) {
+		GetAntiAliasingSamplePosition(i, &subX, &subY);
+		lookup->sampleX[i-lookup->first] = x * AA_SUBPIXEL_GRID_SIZE + subX;
+		lookup->sampleY[i-lookup->first] = y * AA_SUBPIXEL_GRID_SIZE + subY;
+	}
+	lookup->nbFound = FindInCache(arg->cacheBuffer, arg->nbSamples-lookup->first,
+					lookup->sampleX, lookup->sampleY, lookup->value,
+					lookup->found);
+}
+
+/* Compute ith sample of pixel (x,y), unless it was found in cache, and
+ * add it to accumulated samples (and its value to sample values, if not
+ * NULL).
+ */
+static inline void AddAntiAliasingSample(const AntiAliaseFractalArguments *arg,
+						const FractalEngine *engine,
+						const AntiAliasingSampleLookup *lookup,
+						AntiAliasingPixel *pixel, SampleValues *samples,
+						uint_fast32_t x, uint_fast32_t y,
+						uint_fast32_t i)
+{
+	uint_fast32_t subX, subY;
+	GetAntiAliasingSamplePosition(i, &subX, &subY);
+
+	double value;
+	Color c;
+	uint_fast32_t sampleX = x * AA_SUBPIXEL_GRID_SIZE + subX;
+	uint_fast32_t sampleY = y * AA_SUBPIXEL_GRID_SIZE + subY;
+	if (lookup->nbFound > 0 && lookup->found[i-lookup->first]) {
+		value = lookup->value[i-lookup->first];
+		c = GetColorMapColor(&engine->colorMap, value);
+	} else {
+		c = aux_ComputeFractalImagePixel(arg->fractal, arg->render, engine,
+				sampleX, sampleY,
+				arg->image->width * AA_SUBPIXEL_GRID_SIZE,
+				arg->image->height * AA_SUBPIXEL_GRID_SIZE, arg->cacheBuffer,
+				NULL, 0, &value);
+	}
+
+	if (samples != NULL) {
+		samples->values[i] = value;
+		samples->nbSamples = i+1;
+	}
+	AddAntiAliasingColor(pixel, c);
+}
+
+void *SupersampleFractalThreadRoutine(void *arg)
+{
+	ThreadArgHeader *threadArgHeader = GetThreadArgHeader(arg);
+	AntiAliaseFractalArguments *c_arg = (AntiAliaseFractalArguments *)GetThreadArgBody(arg);
+	Image *image = c_arg->image;
+	AntiAliasingPixelList *pixels = c_arg->pixels;
+	FractalEngine engine;
+	int res = CreateFractalEngine(&engine, c_arg->fractal, c_arg->render, c_arg->floatPrecision);
+	if (res != 0) {
+		return NULL;
+	}
+	CacheInsertionBuffer cacheBuffer;
+	if (c_arg->cache != NULL) {
+		CreateCacheInsertionBuffer(&cacheBuffer, c_arg->cache, c_arg->fractal,
+					image->width * AA_SUBPIXEL_GRID_SIZE,
+					image->height * AA_SUBPIXEL_GRID_SIZE);
+		c_arg->cacheBuffer = &cacheBuffer;
+	}
+	AntiAliasingSampleLookup lookup;
+	lookup.sampleX = (uint_fast32_t *)safeMalloc("sample x", c_arg->nbSamples *
+							sizeof(uint_fast32_t));
+	lookup.sampleY = (uint_fast32_t *)safeMalloc("sample y", c_arg->nbSamples *
+							sizeof(uint_fast32_t));
+	lookup.value = (double *)safeMalloc("sample values", c_arg->nbSamples *
+						sizeof(double));
+	lookup.found = (int *)safeMalloc("samples found", c_arg->nbSamples * sizeof(int));
+
+	const AntiAliasingPixelRef *ref;
+	AntiAliasingPixel *pixel;
+	uint_fast32_t first, nbPixels, batchEnd;
+	int progress;
+	uint_fast32_t counter = 0;
+	int cancelRequested = CancelTaskRequested(threadArgHeader);
+	while (!cancelRequested && GetNextAntiAliasingPixels(pixels, &first, &nbPixels,
+								&progress)) {
+		SetThreadProgress(threadArgHeader, progress);
+
+		for (uint_fast32_t i = 0; i < nbPixels && !cancelRequested; ++i) {
+			/* Only compute samples that previous passes did not.
+			 * When variance-driven, stop once pixel has converged.
+			 */
+			ref = &pixels->pixels[first+i];
+			pixel = ref->pixel;
+			FindAntiAliasingSamples(c_arg, &lookup, pixel, ref->x, ref->y);
+			while (pixel->nbSamples < c_arg->nbSamples && !cancelRequested &&
+				!(c_arg->noiseThreshold > 0 && pixel->nbSamples >= AA_BATCH_SIZE &&
+				AntiAliasingPixelConverged(pixel, c_arg->noiseThreshold,
+								image->bytesPerComponent))) {
+				batchEnd = (pixel->nbSamples / AA_BATCH_SIZE + 1) * AA_BATCH_SIZE;
+				if (batchEnd > c_arg->nbSamples) {
+					batchEnd = c_arg->nbSamples;
+				}
+				while (pixel->nbSamples < batchEnd && !cancelRequested) {
+					HandleRequests(32);
+					AddAntiAliasingSample(c_arg, &engine, &lookup, pixel,
+								ref->samples, ref->x, ref->y,
+								pixel->nbSamples);
+				}
+			}
+
+			PutPixelUnsafe(image, ref->x, ref->y, GetAntiAliasingPixelColor(pixel,
+										image->bytesPerComponent));
+		}
+	}
+	SetThreadProgress(threadArgHeader, 100);
+
+	free(lookup.sampleX);
+	free(lookup.sampleY);
+	free(lookup.value);
+	free(lookup.found);
+	if (c_arg->cache != NULL) {
+		FreeCacheInsertionBuffer(&cacheBuffer);
+	}
+	FreeFractalEngine(&engine);
+
+	int canceled = CancelTaskRequested(threadArgHeader);
+
+	return (canceled ? PTHREAD_CANCELED : NULL);
+}
+
+char detectEdgesMessage[] = "Detecting edges";
+char antiAliaseFractalMessage[] = "Anti-aliasing fractal";
+
+Task *CreateAntiAliaseFractalTask(Image *image, const Fractal *fractal,
+					const RenderingParameters *render, uint_fast32_t antiAliasingSize,
+					double threshold, double noiseThreshold,
+					FloatPrecision floatPrecision, FractalCache *cache,
+					ValueBuffer *values, AntiAliasingAccumulator *accumulator,
+					uint_fast32_t focusX, uint_fast32_t focusY,
+					uint_fast32_t nbThreads)
+{
+	if (antiAliasingSize == 0) {
+		return DoNothingTask();
+	}
+	if (image->width*antiAliasingSize < 2 || image->height*antiAliasingSize < 2) {
+		return DoNothingTask();
+	}
+	if (values != NULL && (values->width != image->width ||
+				values->height != image->height)) {
+		FractalNow_error("Value buffer size does not match image size.\n");
+	}
+	/* Tiles match accumulator blocks. */
+	TileQueue *tiles = CreateTileQueue(image, AA_BLOCK_SIZE, NULL, focusX, focusY);
+	uint_fast32_t nbThreadsNeeded = nbThreads;
+	if (tiles->nbTiles < nbThreadsNeeded) {
+		nbThreadsNeeded = tiles->nbTiles;
+	}
+
+	/* Cache entries computed for another fractal must
+	 * neither be looked up nor mixed with new ones.
+	 */
+	if (cache != NULL && !isCacheUsable(cache, fractal, render)) {
+		cache = NULL;
+	}
+
+	int freeAccumulator = (accumulator == NULL);
+	if (freeAccumulator) {
+		accumulator = (AntiAliasingAccumulator *)safeMalloc("accumulator",
+						sizeof(AntiAliasingAccumulator));
+		InitAntiAliasingAccumulator(accumulator, image->width, image->height);
+	} else if (accumulator->width != image->width ||
+			accumulator->height != image->height) {
+		FreeAntiAliasingAccumulator(accumulator);
+		InitAntiAliasingAccumulator(accumulator, image->width, image->height);
+	}
+	AntiAliasingPixelList *pixels = CreateAntiAliasingPixelList();
+
+	/* Edge detection pass only reads image and supersampling pass
+	 * only starts once it is finished, so image need not be copied.
+	 */
+	AntiAliaseFractalArguments *arg;
+	arg = (AntiAliaseFractalArguments *)safeMalloc("arguments", nbThreads *
+							sizeof(AntiAliaseFractalArguments));
+	for (uint_fast32_t i = 0; i < nbThreads; ++i) {
+		arg[i].threadId = i;
+		/* No copy for image.
+		 * Concurrent read is OK.
+		 */
+		arg[i].image = image;
+		arg[i].values = values;
+		arg[i].cache = cache;
+		arg[i].cacheBuffer = NULL;
+		/* Fractal is not copied because it is not modified.*/
 		arg[i].fractal = fractal;
 		/* Rendering parameters are not modified.*/
 		arg[i].render = render;
 		arg[i].floatPrecision = floatPrecision;
 
-		arg[i].rectangles = &rectangle[i*rectanglesPerThread];
-		arg[i].nbRectangles = rectanglesPerThread;
-		arg[i].size = antiAliasingSize;
+		arg[i].tiles = tiles;
+		arg[i].pixels = pixels;
+		arg[i].accumulator = accumulator;
+		arg[i].freeAccumulator = freeAccumulator;
+		arg[i].nbSamples = antiAliasingSize * antiAliasingSize;
 		arg[i].threshold = threshold;
+		arg[i].noiseThreshold = noiseThreshold;
 	}
-	Task *res = CreateTask(antiAliaseFractalMessage, nbThreadsNeeded, arg,
-					sizeof(DrawFractalArguments), AntiAliaseFractalThreadRoutine,
-					FreeDrawFractalArguments);
+	Task *subTasks[2];
+	subTasks[0] = CreateTask(detectEdgesMessage, nbThreadsNeeded, arg,
+					sizeof(AntiAliaseFractalArguments), DetectEdgesThreadRoutine,
+					FreeDetectEdgesArguments);
+	subTasks[1] = CreateTask(antiAliaseFractalMessage, nbThreads, arg,
+					sizeof(AntiAliaseFractalArguments),
+					SupersampleFractalThreadRoutine,
+					FreeSupersampleFractalArguments);
 
 	free(arg);
 
-	return res;
+	return CreateCompositeTask(NULL, 2, subTasks);
 }
 
 void AntiAliaseFractal(Image *image, const Fractal *fractal, const RenderingParameters *render,
-			uint_fast32_t antiAliasingSize, double threshold,
-			FloatPrecision floatPrecision, FractalCache *cache, Threads *threads)
+			uint_fast32_t antiAliasingSize, double threshold, double noiseThreshold,
+			FloatPrecision floatPrecision, FractalCache *cache, ValueBuffer *values,
+			Threads *threads)
 {
 	Task *task = CreateAntiAliaseFractalTask(image, fractal, render, antiAliasingSize,
-						threshold, floatPrecision, cache, threads->N);
+						threshold, noiseThreshold, floatPrecision, cache,
+						values, NULL, image->width / 2, image->height / 2,
+						threads->N);
+	int unused = ExecuteTaskBlocking(task, threads);
+	UNUSED(unused);
+}
+
+typedef struct s_RecolorImageArguments {
+	uint_fast32_t threadId;
+	Image *image;
+	const ValueBuffer *values;
+	const RenderingParameters *render;
+	AntiAliasingAccumulator *accumulator;
+	TileQueue *tiles;
+} RecolorImageArguments;
+
+void FreeRecolorImageArguments(void *arg)
+{
+	RecolorImageArguments *c_arg = (RecolorImageArguments *)arg;
+	if (c_arg->threadId == 0) {
+		FreeTileQueue(c_arg->tiles);
+	}
+}
+
+/* Recolor anti-aliased pixels of tile from their sample values, and
+ * rebuild their accumulated samples if accumulator is not NULL.
+ */
+static void RecolorAntiAliasedPixels(const RecolorImageArguments *arg, const ColorMap *colorMap,
+					const UIRectangle *tile)
+{
+	const ValueBuffer *values = arg->values;
+	const SampleValues *block = values->blocks[(tile->y1 / AA_BLOCK_SIZE) *
+					values->nbBlocksX + tile->x1 / AA_BLOCK_SIZE];
+	if (block == NULL) {
+		return;
+	}
+
+	uint_fast8_t bytesPerComponent = arg->image->bytesPerComponent;
+	const SampleValues *samples;
+	AntiAliasingPixel pixel;
+	for (uint_fast32_t j = tile->y1; j <= tile->y2; ++j) {
+		for (uint_fast32_t k = tile->x1; k <= tile->x2; ++k) {
+			samples = &block[(j % AA_BLOCK_SIZE) * AA_BLOCK_SIZE + k % AA_BLOCK_SIZE];
+			if (samples->nbSamples == 0) {
+				continue;
+			}
+			memset(&pixel, 0, sizeof(AntiAliasingPixel));
+			for (uint_fast32_t i = 0; i < samples->nbSamples; ++i) {
+				AddAntiAliasingColor(&pixel, GetColorMapColor(colorMap, samples->values[i]));
+			}
+
+			PutPixelUnsafe(arg->image, k, j, GetAntiAliasingPixelColor(&pixel,
+										bytesPerComponent));
+			if (arg->accumulator != NULL) {
+				*GetAntiAliasingPixel(arg->accumulator, k, j) = pixel;
+			}
+		}
+	}
+}
+
+void *RecolorImageThreadRoutine(void *arg)
+{
+	ThreadArgHeader *threadArgHeader = GetThreadArgHeader(arg);
+	RecolorImageArguments *c_arg = (RecolorImageArguments *)GetThreadArgBody(arg);
+	Image *image = c_arg->image;
+	const ValueBuffer *values = c_arg->values;
+
+	ColorMap colorMap;
+	CreateColorMap(&colorMap, c_arg->render, values->maxValue);
+	Color *rowColors = (Color *)safeMalloc("row colors", AA_BLOCK_SIZE * sizeof(Color));
+
+	UIRectangle rectangle;
+	int progress;
+	uint_fast32_t counter = 0;
+	int cancelRequested = CancelTaskRequested(threadArgHeader);
+	while (!cancelRequested && GetNextTile(c_arg->tiles, &rectangle, &progress)) {
+		SetThreadProgress(threadArgHeader, progress);
+		HandleRequests(0);
+
+		uint_fast32_t length = rectangle.x2 + 1 - rectangle.x1;
+		for (uint_fast32_t j = rectangle.y1; j <= rectangle.y2; ++j) {
+			GetColorMapColors(&colorMap, values->values + j * values->width + rectangle.x1,
+						rowColors, length);
+			for (uint_fast32_t k = 0; k < length; ++k) {
+				PutPixelUnsafe(image, rectangle.x1 + k, j, rowColors[k]);
+			}
+		}
+		RecolorAntiAliasedPixels(c_arg, &colorMap, &rectangle);
+	}
+	SetThreadProgress(threadArgHeader, 100);
+
+	free(rowColors);
+	FreeColorMap(&colorMap);
+
+	int canceled = CancelTaskRequested(threadArgHeader);
+
+	return (canceled ? PTHREAD_CANCELED : NULL);
+}
+
+char recolorImageMessage[] = "Recoloring image";
+
+Task *CreateRecolorImageTask(Image *image, const ValueBuffer *values,
+				const RenderingParameters *render,
+				AntiAliasingAccumulator *accumulator, uint_fast32_t nbThreads)
+{
+	if (image->width == 0 || image->height == 0) {
+		return DoNothingTask();
+	}
+	if (values->width != image->width || values->height != image->height) {
+		FractalNow_error("Value buffer size does not match image size.\n");
+	}
+	if (accumulator != NULL) {
+		if (accumulator->width != image->width || accumulator->height != image->height) {
+			FreeAntiAliasingAccumulator(accumulator);
+			InitAntiAliasingAccumulator(accumulator, image->width, image->height);
+		} else {
+			ResetAntiAliasingAccumulator(accumulator);
+		}
+	}
+
+	/* Tiles match value buffer (and accumulator) blocks. */
+	TileQueue *tiles = CreateTileQueue(image, AA_BLOCK_SIZE, NULL, image->width / 2,
+						image->height / 2);
+	uint_fast32_t nbThreadsNeeded = nbThreads;
+	if (tiles->nbTiles < nbThreadsNeeded) {
+		nbThreadsNeeded = tiles->nbTiles;
+	}
+
+	RecolorImageArguments *arg;
+	arg = (RecolorImageArguments *)safeMalloc("arguments", nbThreadsNeeded *
+							sizeof(RecolorImageArguments));
+	for (uint_fast32_t i = 0; i < nbThreadsNeeded; ++i) {
+		arg[i].threadId = i;
+		arg[i].image = image;
+		arg[i].values = values;
+		arg[i].render = render;
+		arg[i].accumulator = accumulator;
+		arg[i].tiles = tiles;
+	}
+	Task *task = CreateTask(recolorImageMessage, nbThreadsNeeded, arg,
+				sizeof(RecolorImageArguments), RecolorImageThreadRoutine,
+				FreeRecolorImageArguments);
+
+	free(arg);
+
+	return task;
+}
+
+void RecolorImage(Image *image, const ValueBuffer *values, const RenderingParameters *render,
+			Threads *threads)
+{
+	Task *task = CreateRecolorImageTask(image, values, render, NULL, threads->N);
 	int unused = ExecuteTaskBlocking(task, threads);
 	UNUSED(unused);
 }
@@ -20,11 +20,17 @@
 
 #include "float_precision.h"
 #include "fractal_cache.h"
+#include "error.h"
+#include "file_io.h"
 #include "fractal.h"
-#include "macro_build_floats.h"
+#include "fractal_config.h"
 #include "misc.h"
 #include "uirectangle.h"
 #include "thread.h"
+#include <float.h>
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
 
 #define HandleRequests(max_counter) \
 if (counter == max_counter) {\
@@ -36,32 +42,90 @@ if (counter == max_counter) {\
 	++counter;\
 }
 
-inline void FreeCacheEntry(CacheEntry entry)
+static inline void GetCacheEntryCoordinates(const FractalCache *cache, const CacheEntry *entry,
+						double *x, double *y)
 {
-	switch (entry.floatPrecision) {
-	case FP_SINGLE:
-		clearF(FP_SINGLE, entry.x.val_FP_SINGLE);
-		clearF(FP_SINGLE, entry.y.val_FP_SINGLE);
-		break;
-	case FP_DOUBLE:
-		clearF(FP_DOUBLE, entry.x.val_FP_DOUBLE);
-		clearF(FP_DOUBLE, entry.y.val_FP_DOUBLE);
-		break;
-#ifdef _ENABLE_LDOUBLE_FLOATS
-	case FP_LDOUBLE:
-		clearF(FP_LDOUBLE, entry.x.val_FP_LDOUBLE);
-		clearF(FP_LDOUBLE, entry.y.val_FP_LDOUBLE);
-		break;
-#endif
-#ifdef _ENABLE_MP_FLOATS
-	case FP_MP:
-		clearF(FP_MP, entry.x.val_FP_MP);
-		clearF(FP_MP, entry.y.val_FP_MP);
-		break;
-#endif
-	default:
-		FractalNow_error("Unknown float precision.\n");
-		break;
+	const CacheView *view = &cache->view[entry->view];
+	*x = view->x1d + (entry->x+0.5) * view->pixelSpanXd;
+	*y = view->y1d + (entry->y+0.5) * view->pixelSpanYd;
+}
+
+static inline uint_least64_t GetNbCacheBlocks(uint_least64_t nbEntries)
+{
+	return (nbEntries + CACHE_BLOCK_SIZE - 1) / CACHE_BLOCK_SIZE;
+}
+
+static inline void ResetCacheBlockBounds(CacheBlockBounds *bounds)
+{
+	bounds->minX = HUGE_VAL;
+	bounds->maxX = -HUGE_VAL;
+	bounds->minY = HUGE_VAL;
+	bounds->maxY = -HUGE_VAL;
+}
+
+static inline void ExtendCacheBlockBounds(const FractalCache *cache, CacheBlockBounds *bounds,
+						const CacheEntry *entry)
+{
+	double x, y;
+	GetCacheEntryCoordinates(cache, entry, &x, &y);
+	if (x < bounds->minX) {
+		bounds->minX = x;
+	}
+	if (x > bounds->maxX) {
+		bounds->maxX = x;
+	}
+	if (y < bounds->minY) {
+		bounds->minY = y;
+	}
+	if (y > bounds->maxY) {
+		bounds->maxY = y;
+	}
+}
+
+/* Recompute bounds of all blocks from entries, and reset their usage. */
+static void ComputeCacheBlockBounds(FractalCache *cache)
+{
+	uint_least64_t nbBlocks = GetNbCacheBlocks(cache->nbInitialized);
+	for (uint_least64_t i = 0; i < nbBlocks; ++i) {
+		ResetCacheBlockBounds(&cache->block[i].bounds);
+		cache->block[i].usage = 0;
+	}
+	for (uint_least64_t i = 0; i < cache->nbInitialized; ++i) {
+		ExtendCacheBlockBounds(cache, &cache->block[i / CACHE_BLOCK_SIZE].bounds,
+					&cache->entry[i]);
+	}
+}
+
+/* Largest power of 2 not greater than cache size (1 for empty cache). */
+static uint_least64_t GetCacheIndexSize(uint_least64_t size)
+{
+	uint_least64_t res = 1;
+	while (2*res <= size) {
+		res *= 2;
+	}
+	return res;
+}
+
+static inline uint_least64_t GetCacheIndexSlot(const FractalCache *cache,
+						uint_least32_t view, uint_least32_t x,
+						uint_least32_t y)
+{
+	uint_least64_t h = ((uint_least64_t)x << 32 | y) ^ ((uint_least64_t)view << 48);
+	h *= UINT64_C(0x9E3779B97F4A7C15);
+	return (h >> 32 ^ h) & cache->indexMask;
+}
+
+/* Index of entry pointed by index slot is validated when
+ * looking up, so index content needs not be exact.
+ */
+static void ComputeCacheIndex(FractalCache *cache)
+{
+	for (uint_least64_t i = 0; i <= cache->indexMask; ++i) {
+		cache->index[i] = UINT_LEAST64_MAX;
+	}
+	for (uint_least64_t i = 0; i < cache->nbInitialized; ++i) {
+		const CacheEntry *entry = &cache->entry[i];
+		cache->index[GetCacheIndexSlot(cache, entry->view, entry->x, entry->y)] = i;
 	}
 }
 
@@ -69,6 +133,7 @@ int CreateFractalCache(FractalCache *cache, uint_least64_t size)
 {
 	int res = 0;
 	cache->firstUse = 1;
+	cache->readOnly = 0;
 	cache->fractal = (Fractal *)safeMalloc("fractal", sizeof(Fractal));
 	cache->render = (RenderingParameters *)safeMalloc("rendering parameters",
 							sizeof(RenderingParameters));
@@ -76,11 +141,27 @@ int CreateFractalCache(FractalCache *cache, uint_least64_t size)
 	cache->nbInitialized = 0;
 	cache->size = size;
 	cache->entry = (CacheEntry *)malloc(size*sizeof(CacheEntry));
-	if (cache->entry == NULL) {
+	cache->block = (CacheBlock *)malloc(GetNbCacheBlocks(size) * sizeof(CacheBlock));
+	cache->indexMask = GetCacheIndexSize(size)-1;
+	cache->index = (uint_least64_t *)malloc((cache->indexMask+1) * sizeof(uint_least64_t));
+	if (cache->entry == NULL || (cache->block == NULL && size != 0) ||
+			cache->index == NULL) {
 		res = 1;
+		free(cache->entry);
+		free(cache->block);
+		free(cache->index);
+		cache->entry = NULL;
+		cache->block = NULL;
 		cache->size = 0;
+		cache->indexMask = 0;
+		cache->index = (uint_least64_t *)safeMalloc("cache index", sizeof(uint_least64_t));
 	}
 	cache->currentIndex = 0;
+	cache->nbViews = 0;
+	cache->view = NULL;
+	ComputeCacheIndex(cache);
+	cache->nbPreviewLookups = 0;
+	cache->nbPreviewHits = 0;
 	cache->arrayWidth = 0;
 	cache->arrayHeight = 0;
 	cache->array = NULL;
@@ -99,28 +180,72 @@ int ResizeCacheThreadSafe(FractalCache *cache, uint_least64_t size)
 	int res = 1;
 
 	safePThreadSpinLock(&cache->entryMutex);
-	if (size < cache->size) {
-		for (uint_fast32_t i = size; i < cache->size; ++i) {
-			FreeCacheEntry(cache->entry[i]);
-		}
+	/* Blocks array is grown before entries array and shrunk
+	 * after it, so that it is never too small (too big is harmless).
+	 */
+	uint_least64_t nbBlocks = GetNbCacheBlocks(size);
+	uint_least64_t indexSize = GetCacheIndexSize(size);
+	uint_least64_t *newIndex = (uint_least64_t *)malloc(indexSize*sizeof(uint_least64_t));
+	void *newBlock = cache->block;
+	if (newIndex != NULL && size > cache->size) {
+		newBlock = (CacheBlock *)realloc(cache->block, nbBlocks*sizeof(CacheBlock));
 	}
-	void *newEntry = (CacheEntry *)realloc(cache->entry, size*sizeof(CacheEntry));
-	if (size == 0 || newEntry != NULL) {
-		res = 0;
-		cache->entry = newEntry;
-		cache->size = size;
-		if (cache->nbInitialized > size) {
-			cache->nbInitialized = size;
-		}
-		if (cache->currentIndex >= size) {
-			cache->currentIndex = 0;
+	if (newIndex != NULL && newBlock != NULL) {
+		cache->block = newBlock;
+		void *newEntry = (CacheEntry *)realloc(cache->entry, size*sizeof(CacheEntry));
+		if (size == 0 || newEntry != NULL) {
+			res = 0;
+			if (size < cache->size) {
+				newBlock = (CacheBlock *)realloc(cache->block,
+								nbBlocks*sizeof(CacheBlock));
+				if (nbBlocks == 0 || newBlock != NULL) {
+					cache->block = newBlock;
+				}
+			}
+			for (uint_least64_t i = size; i < cache->nbInitialized; ++i) {
+				--cache->view[cache->entry[i].view].nbEntries;
+			}
+			cache->entry = newEntry;
+			cache->size = size;
+			if (cache->nbInitialized > size) {
+				cache->nbInitialized = size;
+			}
+			if (cache->nbInitialized < size) {
+				cache->currentIndex = cache->nbInitialized;
+			} else if (cache->currentIndex >= size) {
+				cache->currentIndex = 0;
+			}
+			ComputeCacheBlockBounds(cache);
+			free(cache->index);
+			cache->index = newIndex;
+			cache->indexMask = indexSize-1;
+			ComputeCacheIndex(cache);
 		}
 	}
+	if (res) {
+		free(newIndex);
+	}
 	safePThreadSpinUnlock(&cache->entryMutex);
 
 	return res;
 }
 
+/* Move current index to the first block (starting from current one)
+ * not used since clock hand last went past it.
+ */
+static void AdvanceCacheClockHand(FractalCache *cache)
+{
+	uint_least64_t nbBlocks = GetNbCacheBlocks(cache->size);
+	uint_least64_t hand = cache->currentIndex / CACHE_BLOCK_SIZE;
+	while (cache->block[hand].usage > 0) {
+		--cache->block[hand].usage;
+		if (++hand == nbBlocks) {
+			hand = 0;
+		}
+	}
+	cache->currentIndex = hand * CACHE_BLOCK_SIZE;
+}
+
 inline void AddToCache(FractalCache *cache, CacheEntry entry)
 {
 	if (cache->size == 0) {
@@ -130,8 +255,24 @@ inline void AddToCache(FractalCache *cache, CacheEntry entry)
 	if (cache->nbInitialized < cache->size) {
 		++cache->nbInitialized;
 	} else {
-		FreeCacheEntry(cache->entry[cache->currentIndex]);
+		if (cache->currentIndex % CACHE_BLOCK_SIZE == 0) {
+			AdvanceCacheClockHand(cache);
+		}
+		--cache->view[cache->entry[cache->currentIndex].view].nbEntries;
 	}
+	++cache->view[entry.view].nbEntries;
+	/* Block being overwritten may still contain older entries
+	 * outside of its bounds: it is never skipped (see
+	 * CreateFillCacheArrayTask).
+	 */
+	CacheBlock *block = &cache->block[cache->currentIndex / CACHE_BLOCK_SIZE];
+	if (cache->currentIndex % CACHE_BLOCK_SIZE == 0) {
+		ResetCacheBlockBounds(&block->bounds);
+		block->usage = 0;
+	}
+	ExtendCacheBlockBounds(cache, &block->bounds, &entry);
+	cache->index[GetCacheIndexSlot(cache, entry.view, entry.x, entry.y)] =
+		cache->currentIndex;
 	cache->entry[cache->currentIndex++] = entry;
 	if (cache->currentIndex >= cache->size) {
 		cache->currentIndex = 0;
@@ -145,6 +286,177 @@ void AddToCacheThreadSafe(FractalCache *cache, CacheEntry entry)
 	safePThreadSpinUnlock(&cache->entryMutex);
 }
 
+static inline int isCacheViewFree(const CacheView *view)
+{
+	return (view->nbEntries == 0 && view->nbUsers == 0);
+}
+
+static int isSameCacheView(const CacheView *view, const BiggestFloat x1,
+				const BiggestFloat y1, const BiggestFloat spanX,
+				const BiggestFloat spanY, uint_fast32_t width,
+				uint_fast32_t height)
+{
+	return (view->width == width && view->height == height &&
+		cmpBiggestF(view->x1, x1) == 0 &&
+		cmpBiggestF(view->y1, y1) == 0 &&
+		cmpBiggestF(view->spanX, spanX) == 0 &&
+		cmpBiggestF(view->spanY, spanY) == 0);
+}
+
+static void SetCacheView(CacheView *view, const BiggestFloat x1, const BiggestFloat y1,
+				const BiggestFloat spanX, const BiggestFloat spanY,
+				uint_fast32_t width, uint_fast32_t height)
+{
+	BiggestFloat pixelSpan;
+	initBiggestF(pixelSpan);
+
+	assignBiggestF(view->x1, x1);
+	assignBiggestF(view->y1, y1);
+	assignBiggestF(view->spanX, spanX);
+	assignBiggestF(view->spanY, spanY);
+	view->width = width;
+	view->height = height;
+	view->x1d = toDoubleBiggestF(x1);
+	view->y1d = toDoubleBiggestF(y1);
+	div_uiBiggestF(pixelSpan, spanX, width);
+	view->pixelSpanXd = toDoubleBiggestF(pixelSpan);
+	div_uiBiggestF(pixelSpan, spanY, height);
+	view->pixelSpanYd = toDoubleBiggestF(pixelSpan);
+
+	clearBiggestF(pixelSpan);
+}
+
+/* Get index of view (created if necessary) and mark it as used.
+ * Cache entries mutex must be locked.
+ */
+static uint_least32_t AcquireCacheView(FractalCache *cache, const BiggestFloat x1,
+					const BiggestFloat y1, const BiggestFloat spanX,
+					const BiggestFloat spanY, uint_fast32_t width,
+					uint_fast32_t height)
+{
+	uint_fast32_t res = cache->nbViews;
+	for (uint_fast32_t i = 0; i < cache->nbViews; ++i) {
+		if (!isCacheViewFree(&cache->view[i])) {
+			if (isSameCacheView(&cache->view[i], x1, y1, spanX, spanY, width,
+						height)) {
+				res = i;
+				break;
+			}
+		} else if (res == cache->nbViews) {
+			res = i;
+		}
+	}
+	if (res == cache->nbViews) {
+		cache->view = (CacheView *)safeRealloc("cache views", cache->view,
+					(cache->nbViews+1) * sizeof(CacheView));
+		CacheView *view = &cache->view[cache->nbViews++];
+		initBiggestF(view->x1);
+		initBiggestF(view->y1);
+		initBiggestF(view->spanX);
+		initBiggestF(view->spanY);
+		view->nbEntries = 0;
+		view->nbUsers = 0;
+	}
+	CacheView *view = &cache->view[res];
+	if (isCacheViewFree(view)) {
+		SetCacheView(view, x1, y1, spanX, spanY, width, height);
+	}
+	++view->nbUsers;
+
+	return (uint_least32_t)res;
+}
+
+/* Cache entries mutex must be locked. */
+static void ReleaseCacheView(FractalCache *cache, uint_least32_t view)
+{
+	--cache->view[view].nbUsers;
+}
+
+void CreateCacheInsertionBuffer(CacheInsertionBuffer *buffer, FractalCache *cache,
+				const Fractal *fractal, uint_fast32_t width,
+				uint_fast32_t height)
+{
+	safePThreadSpinLock(&cache->entryMutex);
+	buffer->view = AcquireCacheView(cache, fractal->x1, fractal->y1, fractal->spanX,
+					fractal->spanY, width, height);
+	safePThreadSpinUnlock(&cache->entryMutex);
+	buffer->cache = cache;
+	buffer->nbEntries = 0;
+	buffer->entry = (CacheEntry *)safeMalloc("cache insertion buffer",
+				CACHE_INSERTION_BUFFER_SIZE * sizeof(CacheEntry));
+}
+
+inline void AddToCacheInsertionBuffer(CacheInsertionBuffer *buffer, uint_fast32_t x,
+					uint_fast32_t y, double value)
+{
+	if (buffer->cache->readOnly) {
+		return;
+	}
+	CacheEntry *entry = &buffer->entry[buffer->nbEntries++];
+	entry->view = buffer->view;
+	entry->x = x;
+	entry->y = y;
+	entry->value = value;
+	if (buffer->nbEntries == CACHE_INSERTION_BUFFER_SIZE) {
+		FlushCacheInsertionBuffer(buffer);
+	}
+}
+
+void FlushCacheInsertionBuffer(CacheInsertionBuffer *buffer)
+{
+	if (buffer->nbEntries == 0) {
+		return;
+	}
+
+	FractalCache *cache = buffer->cache;
+	safePThreadSpinLock(&cache->entryMutex);
+	for (uint_fast32_t i = 0; i < buffer->nbEntries; ++i) {
+		AddToCache(cache, buffer->entry[i]);
+	}
+	safePThreadSpinUnlock(&cache->entryMutex);
+	buffer->nbEntries = 0;
+}
+
+uint_fast32_t FindInCache(CacheInsertionBuffer *buffer, uint_fast32_t nbPixels,
+				const uint_fast32_t *x, const uint_fast32_t *y, double *value,
+				int *found)
+{
+	uint_fast32_t res = 0;
+	FractalCache *cache = buffer->cache;
+	/* Mutex is taken once for all pixels. */
+	safePThreadSpinLock(&cache->entryMutex);
+	for (uint_fast32_t i = 0; i < nbPixels; ++i) {
+		found[i] = 0;
+		uint_least64_t index = cache->index[GetCacheIndexSlot(cache, buffer->view,
+								x[i], y[i])];
+		if (index < cache->nbInitialized) {
+			const CacheEntry *entry = &cache->entry[index];
+			if (entry->view == buffer->view && entry->x == x[i] && entry->y == y[i]) {
+				found[i] = 1;
+				value[i] = entry->value;
+				++res;
+				CacheBlock *block = &cache->block[index / CACHE_BLOCK_SIZE];
+				if (block->usage < CACHE_BLOCK_MAX_USAGE) {
+					++block->usage;
+				}
+			}
+		}
+	}
+	safePThreadSpinUnlock(&cache->entryMutex);
+
+	return res;
+}
+
+void FreeCacheInsertionBuffer(CacheInsertionBuffer *buffer)
+{
+	FlushCacheInsertionBuffer(buffer);
+	FractalCache *cache = buffer->cache;
+	safePThreadSpinLock(&cache->entryMutex);
+	ReleaseCacheView(cache, buffer->view);
+	safePThreadSpinUnlock(&cache->entryMutex);
+	free(buffer->entry);
+}
+
 static inline CacheEntry GetCacheEntry(FractalCache *cache, uint_least64_t index)
 {
 	return cache->entry[index];
@@ -206,6 +518,7 @@ void *ClearCacheArrayThreadRoutine(void *arg)
 				aVal = &cache->array[j][k];
 				aVal->state = cache->currentState;
 				aVal->totalWeight = 0;
+				aVal->valueWeight = -1;
 				aVal->r = 0;
 				aVal->g = 0;
 				aVal->b = 0;
@@ -276,24 +589,10 @@ void ClearCacheArray(FractalCache *cache, Threads *threads)
 	UNUSED(unused);
 }
 
-static inline Color ColorFromValue(double value, const RenderingParameters *render)
-{
-	Color res;
-	if (value < 0) {
-		res = render->spaceColor;
-	} else {
-		value = render->transferFunctionPtr(value)*render->realMultiplier+
-			render->realOffset;
-		res = GetGradientColor(&render->gradient, (uint_fast64_t)(value));
-	}
-
-	return res;
-}
-
 static inline ArrayValue aux_PutIntoArray(FractalCache *cache,
 						uint_fast32_t x, uint_fast32_t y,
 						double r, double g, double b,
-						double weight)
+						double value, double weight)
 {
 	ArrayValue *aVal = &cache->array[y][x];
 	if (aVal->state != cache->currentState) {
@@ -301,43 +600,32 @@ static inline ArrayValue aux_PutIntoArray(FractalCache *cache,
 		aVal->g = 0;
 		aVal->b = 0;
 		aVal->totalWeight = 0;
+		aVal->valueWeight = -1;
 		aVal->state = cache->currentState;
 	}
 	aVal->r += r;
 	aVal->g += g;
 	aVal->b += b;
 	aVal->totalWeight += weight;
+	if (weight > aVal->valueWeight) {
+		aVal->value = value;
+		aVal->valueWeight = weight;
+	}
 
 	return *aVal;
 }
 
 static inline ArrayValue PutIntoArray(FractalCache *cache,
-					const RenderingParameters *render,
+					const ColorMap *colorMap,
 					uint_fast32_t x, uint_fast32_t y,
 					double value, double weight)
 {
-	Color color = ColorFromValue(value, render);
+	Color color = GetColorMapColor(colorMap, value);
 	double r = color.r * weight;
 	double g = color.g * weight;
 	double b = color.b * weight;
 
-	return aux_PutIntoArray(cache, x, y, r, g, b, weight);
-}
-
-static inline ArrayValue PutIntoArrayThreadSafe(FractalCache *cache,
-						const RenderingParameters *render,
-						uint_fast32_t x, uint_fast32_t y,
-						double value, double weight)
-{
-	Color color = ColorFromValue(value, render);
-	double r = color.r * weight;
-	double g = color.g * weight;
-	double b = color.b * weight;
-	safePThreadSpinLock(&cache->arrayMutex);
-	ArrayValue res = aux_PutIntoArray(cache, x, y, r, g, b, weight);
-	safePThreadSpinUnlock(&cache->arrayMutex);
-
-	return res;
+	return aux_PutIntoArray(cache, x, y, r, g, b, value, weight);
 }
 
 inline ArrayValue GetArrayValue(FractalCache *cache, uint_fast32_t x, uint_fast32_t y)
@@ -438,7 +726,7 @@ Task *CreateResizeCacheArrayTask(FractalCache *cache, uint_fast32_t width,
 int InvalidateCacheArray(FractalCache *cache)
 {
 	int res = 0;
-	if (cache->currentState == UINT_FAST32_MAX) {
+	if (cache->currentState == UINT_LEAST32_MAX) {
 		cache->currentState = 0;
 		res = 1;
 	} else {
@@ -448,134 +736,220 @@ int InvalidateCacheArray(FractalCache *cache)
 	return res;
 }
 
-typedef struct FillCacheArrayArguments {
+/* Affine transform from pixel coordinates in a cache view to array
+ * coordinates.
+ */
+typedef struct ViewTransform {
+	double aX, bX;
+	double aY, bY;
+} ViewTransform;
+
+/* Entry placed at array pixel (x,y), with its (gaussian) weight. */
+typedef struct CacheSplat {
+	uint_least32_t x, y;
+	float value;
+	float weight;
+} CacheSplat;
+
+typedef struct CacheSplatBucket {
+	uint_least64_t nbSplats;
+	uint_least64_t size;
+	CacheSplat *splat;
+} CacheSplatBucket;
+
+static inline void AddToCacheSplatBucket(CacheSplatBucket *bucket, uint_least32_t x,
+						uint_least32_t y, float value, float weight)
+{
+	if (bucket->nbSplats == bucket->size) {
+		bucket->size = (bucket->size == 0) ? CACHE_BLOCK_SIZE : 2*bucket->size;
+		bucket->splat = (CacheSplat *)safeRealloc("cache splats", bucket->splat,
+						bucket->size * sizeof(CacheSplat));
+	}
+	CacheSplat *splat = &bucket->splat[bucket->nbSplats++];
+	splat->x = x;
+	splat->y = y;
+	splat->value = value;
+	splat->weight = weight;
+}
+
+/* Gaussian weights exp(-d^2/(2*sigma^2)) (sigma = 1/3) of entries at
+ * squared distance d^2 (between 0 and 0.5) from array pixel center.
+ */
+#define SPLAT_WEIGHT_TABLE_SIZE (uint_fast32_t)(256)
+
+static void InitSplatWeightTable(float *table)
+{
+	double sigma = 1./3;
+	double sigma2_x_2 = sigma*sigma*2;
+	for (uint_fast32_t i = 0; i < SPLAT_WEIGHT_TABLE_SIZE; ++i) {
+		double d2 = 0.5 * i / (SPLAT_WEIGHT_TABLE_SIZE-1);
+		table[i] = exp(-d2/sigma2_x_2);
+	}
+}
+
+static inline float GetSplatWeight(const float *table, double d2)
+{
+	return table[(uint_fast32_t)(d2 * 2 * (SPLAT_WEIGHT_TABLE_SIZE-1) + 0.5)];
+}
+
+/* Filling cache array is done in two steps, so that threads never
+ * compete for array pixels :
+ * - each thread places entries of its blocks, and sorts the resulting
+ *   splats by stripes of array rows (one bucket per stripe),
+ * - each thread accumulates all splats of one stripe into array
+ *   (and image).
+ */
+typedef struct PlaceCacheEntriesArguments {
 	uint_fast32_t threadId;
-	uint_least64_t begin, end;
-	Image *image;
-	pthread_spinlock_t *imageMutex;
-	const Fractal *fractal;
-	const RenderingParameters *render;
+	uint_least64_t nbBlocks;
+	uint_least64_t *blocks;
+	uint_fast32_t nbViews;
+	ViewTransform *transforms;
 	FractalCache *cache;
-	DECL_MULTI_FLOAT(spanX);
-	DECL_MULTI_FLOAT(spanY);
-	DECL_MULTI_FLOAT(x1);
-	DECL_MULTI_FLOAT(y1);
-} FillCacheArrayArguments;
+	uint_fast32_t width;
+	uint_fast32_t height;
+	uint_fast32_t nbStripes;
+	CacheSplatBucket *buckets; /* Buckets of this thread (one per stripe). */
+} PlaceCacheEntriesArguments;
 
-void FreeFillCacheArrayArguments(void *arg)
+void FreePlaceCacheEntriesArguments(void *arg)
 {
-	FillCacheArrayArguments *c_arg = (FillCacheArrayArguments *)arg;
+	PlaceCacheEntriesArguments *c_arg = (PlaceCacheEntriesArguments *)arg;
 
 	if (c_arg->threadId == 0) {
-		safePThreadSpinDestroy(c_arg->imageMutex);
-		free((void *)c_arg->imageMutex);
-	}
-	CLEAR_MULTI_FLOAT(c_arg->spanX);
-	CLEAR_MULTI_FLOAT(c_arg->spanY);
-	CLEAR_MULTI_FLOAT(c_arg->x1);
-	CLEAR_MULTI_FLOAT(c_arg->y1);
-}
-
-#define BUILD_GetImageCoordFromCacheEntry(fprec) \
-static void GetImageCoordFromCacheEntry_##fprec(CacheEntry *entry,\
-		double *outx, double *outy,\
-		FLOATTYPE(fprec) x, FLOATTYPE(fprec) y,\
-		uint_fast32_t width, uint_fast32_t height,\
-		FLOATTYPE(fprec) spanX, FLOATTYPE(fprec) spanY,\
-		FLOATTYPE(fprec) x1, FLOATTYPE(fprec) y1)\
-{\
-	subF(fprec, x, FLOAT_VAR(fprec,entry->x.val), x1);\
-	mul_uiF(fprec, x, x, width);\
-	divF(fprec, x, x, spanX);\
-	sub_dF(fprec, x, x, 0.5);\
-	*outx = toDoubleF(fprec, x);\
-\
-	subF(fprec, y, FLOAT_VAR(fprec,entry->y.val), y1);\
-	mul_uiF(fprec, y, y, height);\
-	divF(fprec, y, y, spanY);\
-	sub_dF(fprec, y, y, 0.5);\
-	*outy = toDoubleF(fprec, y);\
-}
-#undef MACRO_BUILD_FLOAT
-#define MACRO_BUILD_FLOAT(fprec) BUILD_GetImageCoordFromCacheEntry(fprec)
-MACRO_BUILD_FLOATS
-
-#define BUILD_SwitchCacheEntry(fprec)\
-case fprec:\
-	GetImageCoordFromCacheEntry_##fprec(&entry, &x, &y,\
-		FLOAT_VAR(fprec,multiX), FLOAT_VAR(fprec,multiY),\
-		cache->arrayWidth, cache->arrayHeight,\
-		FLOAT_VAR(fprec,c_arg->spanX), FLOAT_VAR(fprec,c_arg->spanY),\
-		FLOAT_VAR(fprec,c_arg->x1), FLOAT_VAR(fprec,c_arg->y1));\
-	break;
-#undef MACRO_BUILD_FLOAT
-#define MACRO_BUILD_FLOAT(fprec) BUILD_SwitchCacheEntry(fprec)
-
-void *FillCacheArrayThreadRoutine(void *arg)
+		free(c_arg->blocks);
+		free(c_arg->transforms);
+	}
+}
+
+void *PlaceCacheEntriesThreadRoutine(void *arg)
 {
 	ThreadArgHeader *threadArgHeader = GetThreadArgHeader(arg);
-	FillCacheArrayArguments *c_arg =
-		(FillCacheArrayArguments *)GetThreadArgBody(arg);
+	PlaceCacheEntriesArguments *c_arg =
+		(PlaceCacheEntriesArguments *)GetThreadArgBody(arg);
 
 	FractalCache *cache = c_arg->cache;
-	const Fractal *fractal = c_arg->fractal;
-	const RenderingParameters *render = c_arg->render;
-	Image *image = c_arg->image;
-	pthread_spinlock_t *imageMutex = c_arg->imageMutex;
+	uint_fast32_t width = c_arg->width;
+	uint_fast32_t height = c_arg->height;
+	uint_fast32_t nbStripes = c_arg->nbStripes;
 	CacheEntry entry;
-	double x = 0, y = 0;
-	uint_least64_t nbEntries = c_arg->end-c_arg->begin+1;
+	const ViewTransform *transform;
+	double x, y;
+	uint_least64_t nbBlocks = c_arg->nbBlocks;
+	uint_least64_t first, last, l;
+	uint_least64_t nbHits;
+	CacheBlock *block;
 
 	uint_fast32_t counter = 0;
 	int cancelRequested = CancelTaskRequested(threadArgHeader);
 	double dx, dy;
 	uint_fast32_t intX, intY;
-	double sigma = 1./3;
-	double sigma2_x_2 = sigma*sigma*2;
-	double weight;
-	DECL_MULTI_FLOAT(multiX);
-	DECL_MULTI_FLOAT(multiY);
-	INIT_MULTI_FLOAT(multiX);
-	INIT_MULTI_FLOAT(multiY);
-	ASSIGN_MULTI_FLOAT(multiX, fractal->centerX);
-	ASSIGN_MULTI_FLOAT(multiY, fractal->centerY);
-	ArrayValue aVal;
-	Color color;
-	for (uint_least64_t i = c_arg->begin; i <= c_arg->end && !cancelRequested; ++i) {
-		SetThreadProgress(threadArgHeader, 100 * (i-c_arg->begin) / nbEntries);
-		HandleRequests(128);
-		entry = GetCacheEntry(cache, i);
-
-		switch(entry.floatPrecision) {
-		MACRO_BUILD_FLOATS
-		default:
-			FractalNow_error("Unknown float precision.\n");
-			break;
+	uint_fast32_t stripe;
+	float weightTable[SPLAT_WEIGHT_TABLE_SIZE];
+	InitSplatWeightTable(weightTable);
+	for (uint_least64_t i = 0; i < nbBlocks && !cancelRequested; ++i) {
+		SetThreadProgress(threadArgHeader, 100 * i / nbBlocks);
+		first = c_arg->blocks[i] * CACHE_BLOCK_SIZE;
+		last = first + CACHE_BLOCK_SIZE - 1;
+		if (last >= cache->nbInitialized) {
+			last = cache->nbInitialized - 1;
+		}
+		nbHits = 0;
+		for (l = first; l <= last && !cancelRequested; ++l) {
+			HandleRequests(128);
+			entry = GetCacheEntry(cache, l);
+			if (entry.view >= c_arg->nbViews) {
+				/* View created after task. */
+				continue;
+			}
+			transform = &c_arg->transforms[entry.view];
+			x = transform->aX + entry.x * transform->bX;
+			y = transform->aY + entry.y * transform->bY;
+
+			intX = roundl(x);
+			intY = roundl(y);
+			dx = x - intX;
+			dy = y - intY;
+			if (isInsideArray(intX, intY, width, height)) {
+				++nbHits;
+				stripe = (uint_least64_t)intY * nbStripes / height;
+				AddToCacheSplatBucket(&c_arg->buckets[stripe], intX, intY,
+					entry.value, GetSplatWeight(weightTable, dx*dx+dy*dy));
+			}
+		}
+
+		safePThreadSpinLock(&cache->entryMutex);
+		block = &cache->block[c_arg->blocks[i]];
+		if (nbHits > 0 && block->usage < CACHE_BLOCK_MAX_USAGE) {
+			++block->usage;
+		}
+		cache->nbPreviewLookups += l-first;
+		cache->nbPreviewHits += nbHits;
+		safePThreadSpinUnlock(&cache->entryMutex);
+	}
+	SetThreadProgress(threadArgHeader, 100);
+
+	int canceled = CancelTaskRequested(threadArgHeader);
+
+	return (canceled ? PTHREAD_CANCELED : NULL);
+}
+
+typedef struct AccumulateCacheSplatsArguments {
+	uint_fast32_t threadId; /* Also index of stripe. */
+	uint_fast32_t nbPlacingThreads;
+	uint_fast32_t nbStripes;
+	CacheSplatBucket *buckets;
+	Image *image;
+	const Fractal *fractal;
+	const RenderingParameters *render;
+	FractalCache *cache;
+} AccumulateCacheSplatsArguments;
+
+void FreeAccumulateCacheSplatsArguments(void *arg)
+{
+	AccumulateCacheSplatsArguments *c_arg = (AccumulateCacheSplatsArguments *)arg;
+
+	if (c_arg->threadId == 0) {
+		for (uint_fast32_t i = 0; i < c_arg->nbPlacingThreads*c_arg->nbStripes; ++i) {
+			free(c_arg->buckets[i].splat);
 		}
+		free(c_arg->buckets);
+	}
+}
 
-		intX = roundl(x);
-		intY = roundl(y);
-		dx = x - intX;
-		dy = y - intY;
-		if (isInsideArray(intX, intY, cache->arrayWidth, cache->arrayHeight)) {
+void *AccumulateCacheSplatsThreadRoutine(void *arg)
+{
+	ThreadArgHeader *threadArgHeader = GetThreadArgHeader(arg);
+	AccumulateCacheSplatsArguments *c_arg =
+		(AccumulateCacheSplatsArguments *)GetThreadArgBody(arg);
 
-			weight = exp(-(dx*dx+dy*dy)/sigma2_x_2);
+	FractalCache *cache = c_arg->cache;
+	const RenderingParameters *render = c_arg->render;
+	Image *image = c_arg->image;
+	uint_fast32_t nbPlacingThreads = c_arg->nbPlacingThreads;
+	const CacheSplatBucket *bucket;
+	const CacheSplat *splat;
+
+	uint_fast32_t counter = 0;
+	int cancelRequested = CancelTaskRequested(threadArgHeader);
+	ArrayValue aVal;
+	ColorMap colorMap;
+	CreateColorMap(&colorMap, render, (double)c_arg->fractal->maxIter+1);
+	for (uint_fast32_t i = 0; i < nbPlacingThreads && !cancelRequested; ++i) {
+		SetThreadProgress(threadArgHeader, 100 * i / nbPlacingThreads);
+		bucket = &c_arg->buckets[i*c_arg->nbStripes + c_arg->threadId];
+		for (uint_least64_t j = 0; j < bucket->nbSplats && !cancelRequested; ++j) {
+			HandleRequests(128);
+			splat = &bucket->splat[j];
+			aVal = PutIntoArray(cache, &colorMap, splat->x, splat->y,
+						splat->value, splat->weight);
 			if (image != NULL) {
-				safePThreadSpinLock(imageMutex);
-				aVal = PutIntoArray(cache, render, intX, intY,
-							entry.value, weight);
-				color = GetColorFromAVal(aVal, render);
-
-				PutPixelUnsafe(image, intX, intY, color);
-				safePThreadSpinUnlock(imageMutex);
-			} else {
-				aVal = PutIntoArrayThreadSafe(cache, render, intX, intY,
-								entry.value, weight);
+				PutPixelUnsafe(image, splat->x, splat->y,
+						GetColorFromAVal(aVal, render));
 			}
 		}
 	}
-	CLEAR_MULTI_FLOAT(multiX);
-	CLEAR_MULTI_FLOAT(multiY);
+	FreeColorMap(&colorMap);
 	SetThreadProgress(threadArgHeader, 100);
 
 	int canceled = CancelTaskRequested(threadArgHeader);
@@ -585,63 +959,191 @@ void *FillCacheArrayThreadRoutine(void *arg)
 
 char fillCacheArrayMessage[] = "Filling cache array";
 
+/* Widen bounds by a few ulps, to account for rounding errors of entry
+ * coordinates computed with doubles (see GetCacheEntryCoordinates).
+ */
+static inline void WidenBounds(double *min, double *max)
+{
+	double epsilon = 8 * DBL_EPSILON * fmax(fabs(*min), fabs(*max));
+	*min -= epsilon;
+	*max += epsilon;
+}
+
+/* Get fractal bounds (rounded to double), plus one pixel of margin. */
+static void GetViewBounds(CacheBlockBounds *view, const Fractal *fractal,
+				uint_fast32_t width, uint_fast32_t height)
+{
+	BiggestFloat margin, bound;
+	initBiggestF(margin);
+	initBiggestF(bound);
+
+	div_uiBiggestF(margin, fractal->spanX, width);
+	subBiggestF(bound, fractal->x1, margin);
+	view->minX = toDoubleBiggestF(bound);
+	addBiggestF(bound, fractal->x1, fractal->spanX);
+	addBiggestF(bound, bound, margin);
+	view->maxX = toDoubleBiggestF(bound);
+
+	div_uiBiggestF(margin, fractal->spanY, height);
+	subBiggestF(bound, fractal->y1, margin);
+	view->minY = toDoubleBiggestF(bound);
+	addBiggestF(bound, fractal->y1, fractal->spanY);
+	addBiggestF(bound, bound, margin);
+	view->maxY = toDoubleBiggestF(bound);
+
+	WidenBounds(&view->minX, &view->maxX);
+	WidenBounds(&view->minY, &view->maxY);
+
+	clearBiggestF(margin);
+	clearBiggestF(bound);
+}
+
+/* Get transform from pixel coordinates in view to coordinates in an
+ * array of size width x height representing fractal.
+ */
+static void GetViewTransform(ViewTransform *transform, const CacheView *view,
+				const Fractal *fractal, uint_fast32_t width,
+				uint_fast32_t height)
+{
+	BiggestFloat tmp;
+	initBiggestF(tmp);
+
+	mul_uiBiggestF(tmp, view->spanX, width);
+	div_uiBiggestF(tmp, tmp, view->width);
+	divBiggestF(tmp, tmp, fractal->spanX);
+	transform->bX = toDoubleBiggestF(tmp);
+	subBiggestF(tmp, view->x1, fractal->x1);
+	mul_uiBiggestF(tmp, tmp, width);
+	divBiggestF(tmp, tmp, fractal->spanX);
+	transform->aX = toDoubleBiggestF(tmp) + 0.5 * transform->bX - 0.5;
+
+	mul_uiBiggestF(tmp, view->spanY, height);
+	div_uiBiggestF(tmp, tmp, view->height);
+	divBiggestF(tmp, tmp, fractal->spanY);
+	transform->bY = toDoubleBiggestF(tmp);
+	subBiggestF(tmp, view->y1, fractal->y1);
+	mul_uiBiggestF(tmp, tmp, height);
+	divBiggestF(tmp, tmp, fractal->spanY);
+	transform->aY = toDoubleBiggestF(tmp) + 0.5 * transform->bY - 0.5;
+
+	clearBiggestF(tmp);
+}
+
+static inline int CacheBlockIntersectsView(const CacheBlockBounds *bounds,
+						const CacheBlockBounds *view)
+{
+	return (bounds->minX <= view->maxX && bounds->maxX >= view->minX &&
+		bounds->minY <= view->maxY && bounds->maxY >= view->minY);
+}
+
+/* Only blocks of entries intersecting fractal view (for an array of size
+ * width x height) are visited.
+ */
 Task *CreateFillCacheArrayTask(FractalCache *cache, Image *image, const Fractal *fractal,
 				const RenderingParameters *render,
+				uint_fast32_t width, uint_fast32_t height,
 				uint_fast32_t nbThreads)
 {
-	if (cache->size == 0 || cache->arrayWidth == 0 || cache->arrayHeight == 0
-			|| cache->nbInitialized == 0) {
+	if (cache->size == 0 || width == 0 || height == 0 || cache->nbInitialized == 0) {
 		return DoNothingTask();
 	}
 
-	uint_fast32_t nbEntries = cache->nbInitialized;
-	uint_fast32_t nbThreadsNeeded = nbThreads;
-	if (nbEntries <= nbThreadsNeeded) {
-		nbThreadsNeeded = nbEntries;
+	CacheBlockBounds view;
+	GetViewBounds(&view, fractal, width, height);
+	safePThreadSpinLock(&cache->entryMutex);
+	uint_least64_t nbCacheBlocks = GetNbCacheBlocks(cache->nbInitialized);
+	/* Block being overwritten has stale bounds (see AddToCache). */
+	uint_least64_t currentBlock = UINT_LEAST64_MAX;
+	if (cache->currentIndex % CACHE_BLOCK_SIZE != 0) {
+		currentBlock = cache->currentIndex / CACHE_BLOCK_SIZE;
 	}
-	uint_fast32_t nbRectangles = nbThreadsNeeded;
+	uint_least64_t *blocks = (uint_least64_t *)safeMalloc("cache blocks",
+						nbCacheBlocks * sizeof(uint_least64_t));
+	uint_least64_t nbBlocks = 0;
+	for (uint_least64_t i = 0; i < nbCacheBlocks; ++i) {
+		if (i == currentBlock || CacheBlockIntersectsView(&cache->block[i].bounds, &view)) {
+			blocks[nbBlocks++] = i;
+		}
+	}
+	if (nbBlocks == 0) {
+		safePThreadSpinUnlock(&cache->entryMutex);
+		free(blocks);
+		return DoNothingTask();
+	}
+	uint_fast32_t nbViews = cache->nbViews;
+	ViewTransform *transforms = (ViewTransform *)safeMalloc("view transforms",
+						nbViews * sizeof(ViewTransform));
+	for (uint_fast32_t i = 0; i < nbViews; ++i) {
+		GetViewTransform(&transforms[i], &cache->view[i], fractal, width, height);
+	}
+	safePThreadSpinUnlock(&cache->entryMutex);
+
+	uint_fast32_t nbPlacingThreads = nbThreads;
+	if (nbBlocks <= nbPlacingThreads) {
+		nbPlacingThreads = nbBlocks;
+	}
+	uint_fast32_t nbStripes = nbThreads;
+	if (height <= nbStripes) {
+		nbStripes = height;
+	}
+	uint_fast32_t nbRectangles = nbPlacingThreads;
 
 	UIRectangle *rectangle;
 	rectangle = (UIRectangle *)safeMalloc("rectangles", nbRectangles * sizeof(UIRectangle));
-	InitUIRectangle(&rectangle[0], 0, 0, nbEntries-1, 0);
+	InitUIRectangle(&rectangle[0], 0, 0, nbBlocks-1, 0);
 	if (CutUIRectangleInN(rectangle[0], nbRectangles, rectangle)) {
 		FractalNow_error("Could not cut rectangle ((%"PRIuFAST32",%"PRIuFAST32"),\
 (%"PRIuFAST32",%"PRIuFAST32") in %"PRIuFAST32" parts.\n", rectangle[0].x1, rectangle[0].y1,
 			rectangle[0].x2, rectangle[0].y2, nbRectangles);
 	}
-	
-	pthread_spinlock_t *imageMutex;
-	imageMutex = (pthread_spinlock_t *)safeMalloc("image mutex",
-							sizeof(pthread_spinlock_t));
-	safePThreadSpinInit(imageMutex, SPIN_INIT_ATTR);
 
-	FillCacheArrayArguments *arg;
-	arg = (FillCacheArrayArguments *)safeMalloc("arguments", nbThreadsNeeded *
-							sizeof(FillCacheArrayArguments));
+	CacheSplatBucket *buckets;
+	buckets = (CacheSplatBucket *)safeCalloc("cache splat buckets",
+				nbPlacingThreads * nbStripes, sizeof(CacheSplatBucket));
+
+	PlaceCacheEntriesArguments *placeArg;
+	placeArg = (PlaceCacheEntriesArguments *)safeMalloc("arguments", nbPlacingThreads *
+						sizeof(PlaceCacheEntriesArguments));
+	for (uint_fast32_t i = 0; i < nbPlacingThreads; ++i) {
+		placeArg[i].threadId = i;
+		placeArg[i].cache = cache;
+		placeArg[i].nbBlocks = rectangle[i].x2+1-rectangle[i].x1;
+		placeArg[i].blocks = &blocks[rectangle[i].x1];
+		placeArg[i].nbViews = nbViews;
+		placeArg[i].transforms = transforms;
+		placeArg[i].width = width;
+		placeArg[i].height = height;
+		placeArg[i].nbStripes = nbStripes;
+		placeArg[i].buckets = &buckets[i*nbStripes];
+	}
 
-	for (uint_fast32_t i = 0; i < nbThreadsNeeded; ++i) {
-		arg[i].threadId = i;
-		arg[i].cache = cache;
-		arg[i].image = image;
-		arg[i].imageMutex = imageMutex;
-		arg[i].fractal = fractal;
-		arg[i].render = render;
-		arg[i].begin = rectangle[i].x1;
-		arg[i].end = rectangle[i].x2;
-		INIT_MULTI_FLOAT(arg[i].spanX);
-		INIT_MULTI_FLOAT(arg[i].spanY);
-		INIT_MULTI_FLOAT(arg[i].x1);
-		INIT_MULTI_FLOAT(arg[i].y1);
-		ASSIGN_MULTI_FLOAT(arg[i].spanX, fractal->spanX);
-		ASSIGN_MULTI_FLOAT(arg[i].spanY, fractal->spanY);
-		ASSIGN_MULTI_FLOAT(arg[i].x1, fractal->x1);
-		ASSIGN_MULTI_FLOAT(arg[i].y1, fractal->y1);
-	}
-	Task *task = CreateTask(fillCacheArrayMessage, nbThreadsNeeded, arg, 
-				sizeof(FillCacheArrayArguments),
-				FillCacheArrayThreadRoutine, FreeFillCacheArrayArguments);
+	AccumulateCacheSplatsArguments *accumulateArg;
+	accumulateArg = (AccumulateCacheSplatsArguments *)safeMalloc("arguments", nbStripes *
+						sizeof(AccumulateCacheSplatsArguments));
+	for (uint_fast32_t i = 0; i < nbStripes; ++i) {
+		accumulateArg[i].threadId = i;
+		accumulateArg[i].nbPlacingThreads = nbPlacingThreads;
+		accumulateArg[i].nbStripes = nbStripes;
+		accumulateArg[i].buckets = buckets;
+		accumulateArg[i].image = image;
+		accumulateArg[i].fractal = fractal;
+		accumulateArg[i].render = render;
+		accumulateArg[i].cache = cache;
+	}
 
-	free(arg);
+	Task *subTasks[2];
+	subTasks[0] = CreateTask(NULL, nbPlacingThreads, placeArg,
+				sizeof(PlaceCacheEntriesArguments),
+				PlaceCacheEntriesThreadRoutine,
+				FreePlaceCacheEntriesArguments);
+	subTasks[1] = CreateTask(NULL, nbStripes, accumulateArg,
+				sizeof(AccumulateCacheSplatsArguments),
+				AccumulateCacheSplatsThreadRoutine,
+				FreeAccumulateCacheSplatsArguments);
+	Task *task = CreateCompositeTask(fillCacheArrayMessage, 2, subTasks);
+
+	free(placeArg);
+	free(accumulateArg);
 	free(rectangle);
 
 	return task;
@@ -650,7 +1152,8 @@ Task *CreateFillCacheArrayTask(FractalCache *cache, Image *image, const Fractal
 void FillCacheArray(FractalCache *cache, Image *image, const Fractal *fractal,
 			const RenderingParameters *render, Threads *threads)
 {
-	Task *task = CreateFillCacheArrayTask(cache, image, fractal, render, threads->N);
+	Task *task = CreateFillCacheArrayTask(cache, image, fractal, render, cache->arrayWidth,
+						cache->arrayHeight, threads->N);
 	int unused = ExecuteTaskBlocking(task, threads);
 	UNUSED(unused);
 }
@@ -784,11 +1287,12 @@ Task *CreateFillArrayAndImageFromCacheTask(FractalCache *cache, Image *image,
 {
 	Task *res;
 	if (fillImageOnTheFly) {
-		res = CreateFillCacheArrayTask(cache, image, fractal, render, nbThreads);
+		res = CreateFillCacheArrayTask(cache, image, fractal, render, image->width,
+						image->height, nbThreads);
 	} else {
 		Task *subTasks[2];
-		subTasks[0] = CreateFillCacheArrayTask(cache, NULL, fractal, render,	
-							nbThreads);
+		subTasks[0] = CreateFillCacheArrayTask(cache, NULL, fractal, render,
+					image->width, image->height, nbThreads);
 		subTasks[1] = CreateFillImageFromCacheArrayTask(image, cache, render,
 								nbThreads);
 		res = CreateCompositeTask(NULL, 2, subTasks);
@@ -815,6 +1319,9 @@ void aux_CreateFractalCachePreviewTask(FractalCache *cache, const Fractal *fract
 	safePThreadSpinLock(&cache->entryMutex);
 	cache->nbInitialized = 0;
 	cache->currentIndex = 0;
+	for (uint_fast32_t i = 0; i < cache->nbViews; ++i) {
+		cache->view[i].nbEntries = 0;
+	}
 	safePThreadSpinUnlock(&cache->entryMutex);
 	if (cache->firstUse) {
 		cache->firstUse = 0;
@@ -834,26 +1341,11 @@ enum TaskType {
 	FILL
 };
 
-static inline int PartCompareFractals(const Fractal *fractal1, const Fractal *fractal2)
+int isCacheUsable(const FractalCache *cache, const Fractal *fractal,
+			const RenderingParameters *render)
 {
-	return (fractal1->fractalFormula != fractal2->fractalFormula ||
-		!ceqBiggestF(fractal1->p, fractal2->p) ||
-		!ceqBiggestF(fractal1->c, fractal2->c) ||
-		fractal1->escapeRadius != fractal2->escapeRadius ||
-		fractal1->maxIter != fractal2->maxIter);
-}
-
-static inline int PartCompareRenderingParameters(const RenderingParameters *param1,
-							const RenderingParameters *param2)
-{
-	return (param1->bytesPerComponent != param2->bytesPerComponent ||
-		CompareColors(param1->spaceColor, param2->spaceColor) ||
-		param1->iterationCount != param2->iterationCount ||
-		param1->coloringMethod != param2->coloringMethod ||
-		param1->addendFunction != param2->addendFunction ||
-		param1->stripeDensity != param2->stripeDensity ||
-		param1->interpolationMethod != param2->interpolationMethod);
-		
+	return (!cache->firstUse && !PartCompareFractals(cache->fractal, fractal) &&
+		!PartCompareRenderingParameters(cache->render, render));
 }
 
 char fractalCachePreviewMessage[] = "Creating fractal preview from cache";
@@ -946,12 +1438,302 @@ void FractalCachePreview(Image *dst, FractalCache *cache, const Fractal *fractal
 	UNUSED(unused);
 }
 
-void FreeFractalCache(FractalCache *cache)
+const char fractalCacheFormatStr[] = "k075";
+
+/* View of cache file, and index of corresponding cache view. */
+typedef struct CacheFileView {
+	BiggestFloat x1, y1;
+	BiggestFloat spanX, spanY;
+	uint32_t width, height;
+	uint_least32_t index;
+} CacheFileView;
+
+int ReadFractalCacheFile(FractalCache *cache, const char *fileName)
 {
-	for (uint_fast32_t i = 0; i < cache->nbInitialized; ++i) {
-		FreeCacheEntry(cache->entry[i]);
+	FractalNow_message(stdout, T_NORMAL, "Reading fractal cache file...\n");
+
+	int res = 0;
+	FILE *file;
+	FractalConfig config;
+	int hasConfig = 0;
+	uint32_t nbViews = 0, nbInitViews = 0, nbAcquiredViews = 0;
+	CacheFileView *views = NULL;
+
+	file=fopen(fileName,"rb");
+	if (!file) {
+		FractalNow_open_werror(fileName);
+	}
+
+	char formatStr[256];
+	if (readString(file, formatStr) < 1) {
+		FractalNow_read_werror(fileName);
+	}
+	if (strcmp(formatStr, fractalCacheFormatStr) != 0) {
+		FractalNow_werror("Unsupported fractal cache file format '%s'.\n", formatStr);
+	}
+
+	if (readUint32(file, &nbViews) < 1) {
+		FractalNow_read_werror(fileName);
+	}
+	views = (CacheFileView *)safeMalloc("cache file views",
+					(nbViews+1) * sizeof(CacheFileView));
+	for (; nbInitViews < nbViews; ++nbInitViews) {
+		initBiggestF(views[nbInitViews].x1);
+		initBiggestF(views[nbInitViews].y1);
+		initBiggestF(views[nbInitViews].spanX);
+		initBiggestF(views[nbInitViews].spanY);
 	}
+	for (uint32_t i = 0; i < nbViews; ++i) {
+		CacheFileView *view = &views[i];
+		if (readBiggestFloat(file, &view->x1) < 1 ||
+			readBiggestFloat(file, &view->y1) < 1 ||
+			readBiggestFloat(file, &view->spanX) < 1 ||
+			readBiggestFloat(file, &view->spanY) < 1 ||
+			readUint32(file, &view->width) < 1 ||
+			readUint32(file, &view->height) < 1) {
+			FractalNow_read_werror(fileName);
+		}
+		if (view->width == 0 || view->height == 0) {
+			FractalNow_werror("Invalid cache view size.\n");
+		}
+	}
+
+	uint_least64_t nbEntries;
+	if (fscanf(file, "%"SCNuLEAST64, &nbEntries) < 1 || fgetc(file) != '\n') {
+		FractalNow_read_werror(fileName);
+	}
+
+	/* Fractal configuration comes last (gradient is read until
+	 * end of file).
+	 */
+	long entriesPos = ftell(file);
+	if (entriesPos < 0 || fseek(file, (long)(nbEntries * sizeof(CacheEntry)), SEEK_CUR)) {
+		FractalNow_read_werror(fileName);
+	}
+	if (readString(file, formatStr) < 1) {
+		FractalNow_read_werror(fileName);
+	}
+	if (ReadFractalConfigFileBody(&config, fileName, file, formatStr)) {
+		FractalNow_werror("Failed to read fractal configuration.\n");
+	}
+	hasConfig = 1;
+
+	/* Entries are stored oldest first: only the newest ones
+	 * are kept if cache is too small.
+	 */
+	if (nbEntries > cache->size) {
+		entriesPos += (long)((nbEntries-cache->size) * sizeof(CacheEntry));
+		nbEntries = cache->size;
+	}
+	if (fseek(file, entriesPos, SEEK_SET)) {
+		FractalNow_read_werror(fileName);
+	}
+
+	/* Cache is reset for configuration of file, and is left
+	 * empty from here if something goes wrong.
+	 */
+	aux_CreateFractalCachePreviewTask(cache, &config.fractal, &config.render);
+	int unused = InvalidateCacheArray(cache);
+	UNUSED(unused);
+	safePThreadSpinLock(&cache->entryMutex);
+	for (; nbAcquiredViews < nbViews; ++nbAcquiredViews) {
+		CacheFileView *view = &views[nbAcquiredViews];
+		view->index = AcquireCacheView(cache, view->x1, view->y1, view->spanX,
+						view->spanY, view->width, view->height);
+	}
+	safePThreadSpinUnlock(&cache->entryMutex);
+
+	if (fread(cache->entry, sizeof(CacheEntry), nbEntries, file) != nbEntries) {
+		FractalNow_read_werror(fileName);
+	}
+	for (uint_least64_t i = 0; i < nbEntries; ++i) {
+		const CacheEntry *entry = &cache->entry[i];
+		if (entry->view >= nbViews || entry->x >= views[entry->view].width ||
+				entry->y >= views[entry->view].height) {
+			FractalNow_werror("Invalid cache entry.\n");
+		}
+	}
+
+	safePThreadSpinLock(&cache->entryMutex);
+	for (uint_least64_t i = 0; i < nbEntries; ++i) {
+		CacheEntry *entry = &cache->entry[i];
+		entry->view = views[entry->view].index;
+		++cache->view[entry->view].nbEntries;
+	}
+	cache->nbInitialized = nbEntries;
+	cache->currentIndex = (nbEntries == cache->size) ? 0 : nbEntries;
+	ComputeCacheBlockBounds(cache);
+	ComputeCacheIndex(cache);
+	safePThreadSpinUnlock(&cache->entryMutex);
+
+	end:
+	if (nbAcquiredViews > 0) {
+		safePThreadSpinLock(&cache->entryMutex);
+		for (uint32_t i = 0; i < nbAcquiredViews; ++i) {
+			ReleaseCacheView(cache, views[i].index);
+		}
+		safePThreadSpinUnlock(&cache->entryMutex);
+	}
+	for (uint32_t i = 0; i < nbInitViews; ++i) {
+		clearBiggestF(views[i].x1);
+		clearBiggestF(views[i].y1);
+		clearBiggestF(views[i].spanX);
+		clearBiggestF(views[i].spanY);
+	}
+	free(views);
+	if (hasConfig) {
+		FreeFractalConfig(config);
+	}
+	if (file && fclose(file)) {
+		FractalNow_close_errmsg(fileName);
+		res = 1;
+	}
+
+	FractalNow_message(stdout, T_NORMAL, "Reading fractal cache file : %s.\n",
+				(res == 0) ? "DONE" : "FAILED");
+
+	return res;
+}
+
+static int aux_WriteFractalCacheFile(const FractalCache *cache, const char *fileName,
+					FILE *file)
+{
+	int res = 0;
+	uint_least32_t *viewIndex = NULL;
+	CacheEntry *entries = NULL;
+
+	if (fprintf(file, "%s\n", fractalCacheFormatStr) < 0) {
+		FractalNow_write_werror(fileName);
+	}
+
+	/* Views without entries are left out. */
+	viewIndex = (uint_least32_t *)safeMalloc("view indexes",
+					(cache->nbViews+1) * sizeof(uint_least32_t));
+	uint32_t nbViews = 0;
+	for (uint_fast32_t i = 0; i < cache->nbViews; ++i) {
+		if (cache->view[i].nbEntries > 0) {
+			viewIndex[i] = nbViews++;
+		}
+	}
+	if (writeUint32(file, nbViews, "\n") < 0) {
+		FractalNow_write_werror(fileName);
+	}
+	for (uint_fast32_t i = 0; i < cache->nbViews; ++i) {
+		const CacheView *view = &cache->view[i];
+		if (view->nbEntries == 0) {
+			continue;
+		}
+		if (writeBiggestFloat(file, view->x1, " ") < 0 ||
+			writeBiggestFloat(file, view->y1, " ") < 0 ||
+			writeBiggestFloat(file, view->spanX, " ") < 0 ||
+			writeBiggestFloat(file, view->spanY, " ") < 0 ||
+			writeUint32(file, view->width, " ") < 0 ||
+			writeUint32(file, view->height, "\n") < 0) {
+			FractalNow_write_werror(fileName);
+		}
+	}
+
+	/* Entries are written oldest first, so that eviction order
+	 * is kept when reading file.
+	 */
+	if (fprintf(file, "%"PRIuLEAST64"\n", cache->nbInitialized) < 0) {
+		FractalNow_write_werror(fileName);
+	}
+	entries = (CacheEntry *)safeMalloc("cache entries", CACHE_BLOCK_SIZE * sizeof(CacheEntry));
+	uint_least64_t first = (cache->nbInitialized == cache->size) ? cache->currentIndex : 0;
+	uint_least64_t nbEntries;
+	for (uint_least64_t i = 0; i < cache->nbInitialized; i += nbEntries) {
+		nbEntries = cache->nbInitialized - i;
+		if (nbEntries > CACHE_BLOCK_SIZE) {
+			nbEntries = CACHE_BLOCK_SIZE;
+		}
+		for (uint_least64_t j = 0; j < nbEntries; ++j) {
+			entries[j] = cache->entry[(first + i + j) % cache->size];
+			entries[j].view = viewIndex[entries[j].view];
+		}
+		if (fwrite(entries, sizeof(CacheEntry), nbEntries, file) != nbEntries) {
+			FractalNow_write_werror(fileName);
+		}
+	}
+
+	/* Fractal configuration comes last (gradient is read until
+	 * end of file).
+	 */
+	const char configFormat[] = "c075";
+	FractalConfig config;
+	config.fractal = *cache->fractal;
+	config.render = *cache->render;
+	if (fprintf(file, "%s\n", configFormat) < 0) {
+		FractalNow_write_werror(fileName);
+	}
+	if (WriteFractalConfigFileBody(&config, fileName, file, configFormat)) {
+		FractalNow_werror("Failed to write fractal configuration.\n");
+	}
+
+	end:
+	free(viewIndex);
+	free(entries);
+
+	return res;
+}
+
+int WriteFractalCacheFile(const FractalCache *cache, const char *fileName)
+{
+	FractalNow_message(stdout, T_NORMAL, "Writing fractal cache file...\n");
+
+	int res = 0;
+	FILE *file = NULL;
+	char *tmpFileName = (char *)safeMalloc("file name", strlen(fileName) + 5);
+	sprintf(tmpFileName, "%s.tmp", fileName);
+
+	if (cache->firstUse) {
+		FractalNow_werror("Fractal cache has never been used.\n");
+	}
+
+	file=fopen(tmpFileName,"wb");
+	if (!file) {
+		FractalNow_open_werror(tmpFileName);
+	}
+	res = aux_WriteFractalCacheFile(cache, tmpFileName, file);
+
+	end:
+	if (file && fclose(file)) {
+		FractalNow_close_errmsg(tmpFileName);
+		res = 1;
+	}
+	/* File is replaced at once, so that processes reading
+	 * it concurrently never see it partially written.
+	 */
+	if (file && res == 0 && rename(tmpFileName, fileName)) {
+		if (remove(fileName) || rename(tmpFileName, fileName)) {
+			FractalNow_errmsg("Error occured when renaming file \'%s\'.\n",
+						tmpFileName);
+			res = 1;
+		}
+	}
+	if (file && res) {
+		remove(tmpFileName);
+	}
+	free(tmpFileName);
+
+	FractalNow_message(stdout, T_NORMAL, "Writing fractal cache file : %s.\n",
+				(res == 0) ? "DONE" : "FAILED");
+
+	return res;
+}
+
+void FreeFractalCache(FractalCache *cache)
+{
 	free(cache->entry);
+	for (uint_fast32_t i = 0; i < cache->nbViews; ++i) {
+		clearBiggestF(cache->view[i].x1);
+		clearBiggestF(cache->view[i].y1);
+		clearBiggestF(cache->view[i].spanX);
+		clearBiggestF(cache->view[i].spanY);
+	}
+	free(cache->view);
+	free(cache->block);
+	free(cache->index);
 	for (uint_fast32_t i = 0; i < cache->arrayHeight; ++i) {
 		free(cache->array[i]);
 	}
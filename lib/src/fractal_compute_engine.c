@@ -28,7 +28,22 @@
 #include "misc.h"
 #include <float.h>
 
+/* Orbits can be saved only when float type holds its value (not
+ * with multiple precision floats).
+ */
+#define ORBIT_SAVABLE_FP_SINGLE 1
+#define ORBIT_SAVABLE_FP_DOUBLE 1
+#define ORBIT_SAVABLE_FP_LDOUBLE 1
+#define ORBIT_SAVABLE_FP_MP 0
+#define ORBIT_SAVABLE(fprec) ORBIT_SAVABLE_##fprec
+
 #define BUILD_FRACTAL_ENGINE(formula,ptype,coloring,iterationcount,addend,interpolation,fprec) \
+struct Orbit##formula##ptype##coloring##iterationcount##addend##interpolation##fprec {\
+	uint_least32_t n;\
+	COMPLEX_FLOATTYPE(FP_##fprec) z;\
+	ORBIT_DECL_VAR_CM_##coloring(IC_##iterationcount,AF_##addend,IM_##interpolation,FP_##fprec)\
+};\
+\
 struct FractalEngine##formula##ptype##coloring##iterationcount##addend##interpolation##fprec {\
 	FLOATTYPE(FP_##fprec) centerX;\
 	FLOATTYPE(FP_##fprec) centerY;\
@@ -53,16 +68,19 @@ struct FractalEngine##formula##ptype##coloring##iterationcount##addend##interpol
 	ENGINE_DECL_VAR_CM_##coloring(IC_##iterationcount,AF_##addend,IM_##interpolation,FP_##fprec)\
 };\
 \
-CacheEntry FractalLoop##formula##ptype##coloring##iterationcount##addend##interpolation##fprec(\
+double FractalLoop##formula##ptype##coloring##iterationcount##addend##interpolation##fprec(\
 	void *engData, const Fractal *fractal, const RenderingParameters *render,\
 	uint_fast32_t x, uint_fast32_t y,\
-	uint_fast32_t width, uint_fast32_t height)\
+	uint_fast32_t width, uint_fast32_t height,\
+	void *orbit, int resume)\
 {\
 	struct FractalEngine##formula##ptype##coloring##iterationcount##addend##interpolation##fprec *data =\
 	(struct FractalEngine##formula##ptype##coloring##iterationcount##addend##interpolation##fprec *)engData;\
+	struct Orbit##formula##ptype##coloring##iterationcount##addend##interpolation##fprec *orbitData =\
+	(struct Orbit##formula##ptype##coloring##iterationcount##addend##interpolation##fprec *)orbit;\
 	UNUSED(render);\
 \
-	CacheEntry dres;\
+	double dres;\
 	fromUiF(FP_##fprec, data->rePixel, x);\
 	add_dF(FP_##fprec, data->rePixel, data->rePixel, 0.5);\
 	mulF(FP_##fprec, data->rePixel, data->rePixel, data->spanX);\
@@ -81,24 +99,35 @@ CacheEntry FractalLoop##formula##ptype##coloring##iterationcount##addend##interp
 	fromUiF(FP_##fprec,data->normZ,0);\
 	LOOP_INIT_FRAC_##formula(FP_##fprec)\
 	LOOP_INIT_CM_##coloring(IC_##iterationcount,AF_##addend,IM_##interpolation,FP_##fprec)\
-	for (data->n=0; data->n<fractal->maxIter && \
+	data->n = 0;\
+	if (ORBIT_SAVABLE(FP_##fprec) && resume) {\
+		/* Go on from saved orbit (state at the start of iteration n). */\
+		data->n = orbitData->n;\
+		cassignF(FP_##fprec,data->z,orbitData->z);\
+		if (data->n > 0) {\
+			cnormF(FP_##fprec,data->normZ,data->z);\
+		}\
+		ORBIT_RESTORE_CM_##coloring(IC_##iterationcount,AF_##addend,IM_##interpolation,FP_##fprec)\
+	}\
+	for (; data->n<fractal->maxIter && \
 			cmpF(FP_##fprec,data->normZ,data->escapeRadius2) < 0; ++data->n) {\
 		LOOP_ITERATION_CM_##coloring(IC_##iterationcount,AF_##addend,IM_##interpolation,FP_##fprec)\
 		LOOP_ITERATION_FRAC_##formula(ptype,FP_##fprec)\
 		cnormF(FP_##fprec,data->normZ,data->z);\
 	}\
+	if (ORBIT_SAVABLE(FP_##fprec) && orbit != NULL && \
+			cmpF(FP_##fprec,data->normZ,data->escapeRadius2) < 0) {\
+		orbitData->n = (uint_least32_t)data->n;\
+		cassignF(FP_##fprec,orbitData->z,data->z);\
+		ORBIT_SAVE_CM_##coloring(IC_##iterationcount,AF_##addend,IM_##interpolation,FP_##fprec)\
+	}\
 	/* Color even the last iteration, when |z| becomes > escape radius */\
 	LOOP_ITERATION_CM_##coloring(IC_##iterationcount,AF_##addend,IM_##interpolation,FP_##fprec)\
-	dres.floatPrecision = FP_##fprec;\
-	initF(FP_##fprec, dres.x.val_FP_##fprec);\
-	initF(FP_##fprec, dres.y.val_FP_##fprec);\
-	crealF(FP_##fprec, dres.x.val_FP_##fprec, data->pixel);\
-	cimagF(FP_##fprec, dres.y.val_FP_##fprec, data->pixel);\
 	if (cmpF(FP_##fprec,data->normZ,data->escapeRadius2) < 0) {\
-		dres.value = -1;\
+		dres = -1;\
 	} else {\
 		LOOP_END_CM_##coloring(IC_##iterationcount,AF_##addend,IM_##interpolation,FP_##fprec)\
-		dres.value = toDoubleF(FP_##fprec,data->res);\
+		dres = toDoubleF(FP_##fprec,data->res);\
 	}\
 	return dres;\
 }\
@@ -136,6 +165,8 @@ void InitEngine##formula##ptype##coloring##iterationcount##addend##interpolation
 	UNUSED(render);\
 	engine->fractalLoop = FractalLoop##formula##ptype##coloring##iterationcount##addend##interpolation##fprec;\
 	engine->freeEngineData = FreeEngine##formula##ptype##coloring##iterationcount##addend##interpolation##fprec;\
+	engine->orbitSize = ORBIT_SAVABLE(FP_##fprec) ?\
+		sizeof(struct Orbit##formula##ptype##coloring##iterationcount##addend##interpolation##fprec) : 0;\
 	engine->data = (struct FractalEngine##formula##ptype##coloring##iterationcount##addend##interpolation##fprec *)\
 		safeMalloc("fractal engine",\
 		sizeof(struct FractalEngine##formula##ptype##coloring##iterationcount##addend##interpolation##fprec));\
@@ -268,6 +299,11 @@ int CreateFractalEngine(FractalEngine *engine, const Fractal *fractal,
 	FractalNow_werror("Could not create fractal compute engine for given parameters.\n");
 
 	end:
+	if (res == 0) {
+		/* Fractal values should not exceed maxIter+1.*/
+		CreateColorMap(&engine->colorMap, render, (double)fractal->maxIter+1);
+	}
+
 	return res;
 }
 
@@ -275,12 +311,21 @@ void FreeFractalEngine(FractalEngine *engine)
 {
 	engine->freeEngineData(engine->data);
 	free(engine->data);
+	FreeColorMap(&engine->colorMap);
 }
 
-CacheEntry RunFractalEngine(const FractalEngine *engine, const Fractal *fractal,
+double RunFractalEngine(const FractalEngine *engine, const Fractal *fractal,
 			const RenderingParameters *render, uint_fast32_t x, uint_fast32_t y,
 			uint_fast32_t width, uint_fast32_t height)
 {
-	return engine->fractalLoop(engine->data, fractal, render, x, y, width, height);
+	return engine->fractalLoop(engine->data, fractal, render, x, y, width, height, NULL, 0);
+}
+
+double RunFractalEngineOrbit(const FractalEngine *engine, const Fractal *fractal,
+			const RenderingParameters *render, uint_fast32_t x, uint_fast32_t y,
+			uint_fast32_t width, uint_fast32_t height, void *orbit, int resume)
+{
+	return engine->fractalLoop(engine->data, fractal, render, x, y, width, height,
+					orbit, resume);
 }
 
@@ -23,6 +23,7 @@
 #include "file_io.h"
 #include "misc.h"
 #include <ctype.h>
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -81,6 +82,18 @@ RenderingParameters CopyRenderingParameters(const RenderingParameters *param)
 	return res;
 }
 
+int PartCompareRenderingParameters(const RenderingParameters *param1,
+					const RenderingParameters *param2)
+{
+	return (param1->bytesPerComponent != param2->bytesPerComponent ||
+		CompareColors(param1->spaceColor, param2->spaceColor) ||
+		param1->iterationCount != param2->iterationCount ||
+		param1->coloringMethod != param2->coloringMethod ||
+		param1->addendFunction != param2->addendFunction ||
+		param1->stripeDensity != param2->stripeDensity ||
+		param1->interpolationMethod != param2->interpolationMethod);
+}
+
 void ResetGradient(RenderingParameters *param, Gradient gradient)
 {
 	FreeGradient(param->gradient);
@@ -418,6 +431,153 @@ int WriteRenderingFile(const RenderingParameters *param, const char *fileName)
 	return res;
 }
 
+/* Cell of value v is given by the exponent and the COLOR_MAP_CELL_BITS
+ * first mantissa bits of 1+v (>= 1), so the remaining mantissa bits
+ * give the position of v inside its cell.
+ */
+#define COLOR_MAP_CELL_SHIFT (52-COLOR_MAP_CELL_BITS)
+#define COLOR_MAP_CELL_MASK ((UINT64_C(1) << COLOR_MAP_CELL_SHIFT)-1)
+#define COLOR_MAP_FIRST_CELL (UINT64_C(1023) << COLOR_MAP_CELL_BITS)
+#define COLOR_MAP_MAX_CELLS (UINT64_C(64) << COLOR_MAP_CELL_BITS)
+#define COLOR_MAP_MAX_POSITION (double)(UINT64_C(1) << 52)
+#define COLOR_MAP_ROUNDING_ERROR (double)(1E-13)
+
+static inline uint64_t DoubleToBits(double x)
+{
+	uint64_t res;
+	memcpy(&res, &x, sizeof(double));
+
+	return res;
+}
+
+static inline double BitsToDouble(uint64_t bits)
+{
+	double res;
+	memcpy(&res, &bits, sizeof(double));
+
+	return res;
+}
+
+static inline double GetGradientPosition(const RenderingParameters *render, double value)
+{
+	return render->transferFunctionPtr(value)*render->realMultiplier+render->realOffset;
+}
+
+/* Value whose 1+value has the given bits (exact since 1+value >= 1).*/
+static inline double GetColorMapValue(uint64_t bits)
+{
+	return BitsToDouble(bits)-1;
+}
+
+void CreateColorMap(ColorMap *colorMap, const RenderingParameters *render, double maxValue)
+{
+	colorMap->render = render;
+
+	if (maxValue < 0) {
+		maxValue = 0;
+	}
+	uint64_t nbCells = (DoubleToBits(1+maxValue) >> COLOR_MAP_CELL_SHIFT) - COLOR_MAP_FIRST_CELL + 1;
+	if (nbCells > COLOR_MAP_MAX_CELLS) {
+		nbCells = COLOR_MAP_MAX_CELLS;
+	}
+	switch (render->transferFunction) {
+	case TF_SQUAREROOT:
+	case TF_IDENTITY:
+	case TF_SQUARE:
+	case TF_CUBE:
+	case TF_EXP:
+		/* Cheaper to evaluate directly than to interpolate (or, for
+		 * exponential, too curved to be interpolated anyway).
+		 */
+		nbCells = 0;
+		break;
+	default:
+		break;
+	}
+	colorMap->nbCells = (uint_fast32_t)nbCells;
+	colorMap->cells = (ColorMapCell *)safeMalloc("color map cells",
+					nbCells*sizeof(ColorMapCell));
+
+	uint64_t bits = COLOR_MAP_FIRST_CELL << COLOR_MAP_CELL_SHIFT;
+	double position = GetGradientPosition(render, GetColorMapValue(bits));
+	double nextPosition, midPosition;
+	for (uint_fast32_t i = 0; i < colorMap->nbCells; ++i) {
+		ColorMapCell *cell = &colorMap->cells[i];
+		midPosition = GetGradientPosition(render,
+				GetColorMapValue(bits + (UINT64_C(1) << (COLOR_MAP_CELL_SHIFT-1))));
+		bits += UINT64_C(1) << COLOR_MAP_CELL_SHIFT;
+		nextPosition = GetGradientPosition(render, GetColorMapValue(bits));
+
+		cell->position = position;
+		cell->slope = (nextPosition-position) / (COLOR_MAP_CELL_MASK+1);
+		/* For transfer functions whose curvature does not change sign
+		 * in the cell, interpolation error is largest around the middle.
+		 * It is doubled for safety, and rounding errors of both direct
+		 * evaluation and interpolation are added.
+		 * Positions too large to be represented accurately (or infinite)
+		 * are left to direct evaluation too.
+		 */
+		cell->error = 2*fabs((position+nextPosition)/2-midPosition) +
+				COLOR_MAP_ROUNDING_ERROR*(fabs(position)+fabs(nextPosition)+1);
+		cell->exact = !(fabs(position) < COLOR_MAP_MAX_POSITION &&
+				fabs(nextPosition) < COLOR_MAP_MAX_POSITION &&
+				cell->error <= COLOR_MAP_MAX_ERROR);
+
+		position = nextPosition;
+	}
+}
+
+static inline double GetColorMapPosition(const ColorMap *colorMap, double value)
+{
+	double res;
+	uint64_t bits = DoubleToBits(1+value);
+	uint64_t i = (bits >> COLOR_MAP_CELL_SHIFT) - COLOR_MAP_FIRST_CELL;
+
+	if (i < colorMap->nbCells && !colorMap->cells[i].exact) {
+		const ColorMapCell *cell = &colorMap->cells[i];
+		res = cell->position + cell->slope * (double)(bits & COLOR_MAP_CELL_MASK);
+		/* Interpolated position must give the same gradient entry as
+		 * the exact position, which can only be guaranteed if it is
+		 * not too close to the boundary of its entry.
+		 */
+		if (floor(res-cell->error) != floor(res+cell->error)) {
+			res = GetGradientPosition(colorMap->render, value);
+		}
+	} else {
+		res = GetGradientPosition(colorMap->render, value);
+	}
+
+	return res;
+}
+
+inline Color GetColorMapColor(const ColorMap *colorMap, double value)
+{
+	const RenderingParameters *render = colorMap->render;
+	Color res;
+
+	if (value < 0) {
+		res = render->spaceColor;
+	} else {
+		double position = GetColorMapPosition(colorMap, value);
+		res = GetGradientColor(&render->gradient, (uint_fast64_t)(position));
+	}
+
+	return res;
+}
+
+void GetColorMapColors(const ColorMap *colorMap, const double *values, Color *colors,
+			uint_fast32_t nbValues)
+{
+	for (uint_fast32_t i = 0; i < nbValues; ++i) {
+		colors[i] = GetColorMapColor(colorMap, values[i]);
+	}
+}
+
+void FreeColorMap(ColorMap *colorMap)
+{
+	free(colorMap->cells);
+}
+
 void FreeRenderingParameters(RenderingParameters param)
 {
 	FreeGradient(param.gradient);
@@ -44,22 +44,27 @@ const WriteGradientFileFunction writeGradientFileFunction[] = {
 	WriteGradientFileV073
 };
 
-void aux_GenerateGradient(Gradient *gradient, uint_fast64_t begin_ind_tab, uint_fast64_t end_ind_tab, 
-				Color C1, Color C2)
+static void aux_GenerateGradient(GradientSegment *segment, uint_fast64_t begin_ind_tab,
+				uint_fast64_t end_ind_tab, Color C1, Color C2)
 {
-	uint_fast64_t N = end_ind_tab - begin_ind_tab;
-	Color *pixel = gradient->data+begin_ind_tab;
-	if (N == 0) {
-		*pixel = C2;
+	segment->begin = begin_ind_tab;
+	segment->end = end_ind_tab;
+	if (end_ind_tab == begin_ind_tab) {
+		segment->invLength = 0;
+		segment->C1 = C2;
 	} else {
-		for (uint_fast64_t i=0;i<=N;i++) {
-			pixel->bytesPerComponent = C1.bytesPerComponent;
-			pixel->r = (C1.r*(N-i) + C2.r*i) / N;
-			pixel->g = (C1.g*(N-i) + C2.g*i) / N;
-			pixel->b = (C1.b*(N-i) + C2.b*i) / N;
-			++pixel;
-		}
+		segment->invLength = 1. / (end_ind_tab-begin_ind_tab);
+		segment->C1 = C1;
 	}
+	segment->C2 = C2;
+}
+
+static inline uint_fast64_t GetSizeReciprocal(uint_fast64_t size)
+{
+	/* See Lemire et al., "Faster remainder by direct computation", 2019.
+	 * Overflows to 0 for size 1, which gives the right result too.
+	 */
+	return UINT64_C(0xFFFFFFFFFFFFFFFF) / size + 1;
 }
 
 void GenerateGradient(Gradient *gradient, uint_fast32_t nbStops, double *positionStop,
@@ -82,15 +87,18 @@ void GenerateGradient(Gradient *gradient, uint_fast32_t nbStops, double *positio
 	gradient->bytesPerComponent = colorStop[0].bytesPerComponent;
 	gradient->size = size;
 
-	gradient->data = (Color *)safeMalloc("gradient data", size*sizeof(Color));
+	gradient->sizeReciprocal = GetSizeReciprocal(size);
+	gradient->nbSegments = nbStops-1;
+	gradient->segments = (GradientSegment *)safeMalloc("gradient segments",
+						gradient->nbSegments*sizeof(GradientSegment));
 	for (uint_fast32_t i=0; i<nbStops-1; ++i) {
 		if (positionStop[i] < 0 || positionStop[i] > 1) {
 			FractalNow_error("Gradient position stops must be between 0 and 1.\n");
 		} else if (i != 0 && positionStop[i] <= positionStop[i-1]) {
 			FractalNow_error("Gradient position stops should be (stricly) increasing.\n");
 		}
-		aux_GenerateGradient(gradient, positionStop[i]*(size-1), positionStop[i+1]*(size-1),
-					colorStop[i], colorStop[i+1]);
+		aux_GenerateGradient(&gradient->segments[i], positionStop[i]*(size-1),
+					positionStop[i+1]*(size-1), colorStop[i], colorStop[i+1]);
 	}
 
 	FractalNow_message(stdout, T_NORMAL,"Generating gradient : DONE.\n");
@@ -118,8 +126,11 @@ Gradient CopyGradient(const Gradient *gradient)
 	Gradient res;
 	res.bytesPerComponent = gradient->bytesPerComponent;
 	res.size = gradient->size;
-	res.data = (Color *)safeMalloc("gradient copy data", gradient->size*sizeof(Color));
-	memcpy(res.data, gradient->data, gradient->size*sizeof(Color));
+	res.sizeReciprocal = gradient->sizeReciprocal;
+	res.nbSegments = gradient->nbSegments;
+	res.segments = (GradientSegment *)safeMalloc("gradient copy segments",
+					gradient->nbSegments*sizeof(GradientSegment));
+	memcpy(res.segments, gradient->segments, gradient->nbSegments*sizeof(GradientSegment));
 	res.nbStops = gradient->nbStops;
 	res.positionStop = (double *)safeMalloc("gradient position stop copy", gradient->nbStops*sizeof(double));
 	memcpy(res.positionStop, gradient->positionStop, gradient->nbStops*sizeof(double));
@@ -167,14 +178,67 @@ Gradient Gradient8(const Gradient *gradient)
 	return res;
 }
 
+static inline uint_fast64_t GradientModulo(const Gradient *gradient, uint_fast64_t index)
+{
+#ifdef __SIZEOF_INT128__
+	if (index <= UINT32_MAX && gradient->size <= UINT32_MAX) {
+		uint64_t lowBits = gradient->sizeReciprocal * index;
+		return ((__uint128_t)lowBits * gradient->size) >> 64;
+	}
+#endif
+	return index % gradient->size;
+}
+
+static inline uint16_t InterpolateComponent(uint_fast64_t c1, uint_fast64_t c2, uint_fast64_t n,
+						uint_fast64_t i, double invLength)
+{
+	/* Same as (c1*(n-i)+c2*i) / n : adding 0.5 keeps the quotient away
+	 * from integers, so that the rounding error of invLength cannot
+	 * change its integer part.
+	 */
+	return (c1*(n-i) + c2*i + 0.5) * invLength;
+}
+
 inline Color GetGradientColor(const Gradient *gradient, uint_fast64_t index)
 {
-	return gradient->data[index % gradient->size];
+	index = GradientModulo(gradient, index);
+
+	/* Find last segment beginning before index (last one wins where
+	 * segments overlap).
+	 */
+	const GradientSegment *segments = gradient->segments;
+	uint_fast32_t first = 0, last = gradient->nbSegments;
+	while (last - first > 1) {
+		uint_fast32_t middle = (first + last) / 2;
+		if (segments[middle].begin <= index) {
+			first = middle;
+		} else {
+			last = middle;
+		}
+	}
+	const GradientSegment *segment = &segments[first];
+
+	Color res;
+	if (index < segment->begin) {
+		res = gradient->colorStop[0];
+	} else if (index >= segment->end) {
+		res = (index == segment->end) ? segment->C2 :
+			gradient->colorStop[gradient->nbStops-1];
+	} else {
+		uint_fast64_t n = segment->end - segment->begin;
+		uint_fast64_t i = index - segment->begin;
+		res.bytesPerComponent = segment->C1.bytesPerComponent;
+		res.r = InterpolateComponent(segment->C1.r, segment->C2.r, n, i, segment->invLength);
+		res.g = InterpolateComponent(segment->C1.g, segment->C2.g, n, i, segment->invLength);
+		res.b = InterpolateComponent(segment->C1.b, segment->C2.b, n, i, segment->invLength);
+	}
+
+	return res;
 }
 
 void FreeGradient(Gradient gradient)
 {
-	free(gradient.data);
+	free(gradient.segments);
 	free(gradient.positionStop);
 	free(gradient.colorStop);
 }
@@ -71,19 +71,13 @@ Image CloneImage(const Image *image)
 	return res;
 }
 
-static inline uint8_t *ImageRGB8ToBytesArray(const Image *image)
+static inline void ImageRGB8RowsToBytes(uint8_t *dst, const Image *image,
+						uint_fast32_t y, uint_fast32_t nbRows)
 {
-	if (image->width == 0 || image->height == 0) {
-		return NULL;
-	}
-
-	uint8_t *res = (uint8_t *)safeCalloc("image bytes array", image->width*image->height,
-						3*image->bytesPerComponent);
-
-	uint32_t *p_data32 = (uint32_t *)image->data;
+	uint32_t *p_data32 = (uint32_t *)image->data + y*image->width;
 	uint32_t data32;
-	uint8_t *p_res = res;
-	for (uint_fast32_t i = 0; i < image->height; ++i) {
+	uint8_t *p_res = dst;
+	for (uint_fast32_t i = 0; i < nbRows; ++i) {
 		for (uint_fast32_t j = 0; j < image->width; ++j) {
 			data32 = *p_data32;
 			*(p_res++) = GET_R8(data32);
@@ -92,24 +86,16 @@ static inline uint8_t *ImageRGB8ToBytesArray(const Image *image)
 			++p_data32;
 		}
 	}
-
-	return res;
 }
 
-static inline uint8_t *ImageRGB16ToBytesArray(const Image *image)
+static inline void ImageRGB16RowsToBytes(uint8_t *dst, const Image *image,
+						uint_fast32_t y, uint_fast32_t nbRows)
 {
-	if (image->width == 0 || image->height == 0) {
-		return NULL;
-	}
-
-	uint8_t *res = (uint8_t *)safeCalloc("image bytes array", image->width*image->height,
-						3*image->bytesPerComponent);
-
-	uint64_t *p_data64 = (uint64_t *)image->data;
+	uint64_t *p_data64 = (uint64_t *)image->data + y*image->width;
 	uint64_t data64;
 	uint16_t r, g, b;
-	uint8_t *p_res = res;
-	for (uint_fast32_t i = 0; i < image->height; ++i) {
+	uint8_t *p_res = dst;
+	for (uint_fast32_t i = 0; i < nbRows; ++i) {
 		for (uint_fast32_t j = 0; j < image->width; ++j) {
 			data64 = *p_data64;
 			/* We want the components in the order RGB, so we need to extract
@@ -128,25 +114,34 @@ static inline uint8_t *ImageRGB16ToBytesArray(const Image *image)
 			++p_data64;
 		}
 	}
-
-	return res;
 }
 
-uint8_t *ImageToBytesArray(const Image *image)
+void ImageRowsToBytes(uint8_t *dst, const Image *image, uint_fast32_t y,
+			uint_fast32_t nbRows)
 {
-	uint8_t *res;
 	switch(image->bytesPerComponent) {
 	case 1:
-		res = ImageRGB8ToBytesArray(image);
+		ImageRGB8RowsToBytes(dst, image, y, nbRows);
 		break;
 	case 2:
-		res = ImageRGB16ToBytesArray(image);
+		ImageRGB16RowsToBytes(dst, image, y, nbRows);
 		break;
 	default:
 		FractalNow_error("Invalid bytes per component (%"PRIuFAST8").\n",
 			image->bytesPerComponent);
 		break;
 	}
+}
+
+uint8_t *ImageToBytesArray(const Image *image)
+{
+	if (image->width == 0 || image->height == 0) {
+		return NULL;
+	}
+
+	uint8_t *res = (uint8_t *)safeCalloc("image bytes array", image->width*image->height,
+						3*image->bytesPerComponent);
+	ImageRowsToBytes(res, image, 0, image->height);
 
 	return res;
 }
@@ -293,6 +288,11 @@ char applyGaussianBlurMessage[] = "Applying gaussian blur";
 Task *CreateApplyGaussianBlurTask(Image *dst, Image *temp, const Image *src, double radius, 
 						uint_fast32_t nbThreads)
 {
+	if (radius >= RECURSIVE_GAUSSIAN_BLUR_MIN_RADIUS) {
+		return CreateApplyRecursiveGaussianBlurTask(dst, temp, src, radius / 3.,
+								nbThreads);
+	}
+
 	Filter horizontalGaussianFilter;
 	Filter verticalGaussianFilter;
 	CreateHorizontalGaussianFilter2(&horizontalGaussianFilter, radius);
@@ -355,8 +355,11 @@ void *DownscaleImageThreadRoutine(void *arg)
 	double invScaleY = c_arg->invScaleY;
 	Filter *horizontalGaussianFilter = c_arg->horizontalGaussianFilter;
 	Filter *verticalGaussianFilter = c_arg->verticalGaussianFilter;
+	/* Vertically filtered source row, and buffer for ApplyFilterOnRow. */
 	Image tmpImage;
-	CreateImage(&tmpImage, horizontalGaussianFilter->sx, 1, src->bytesPerComponent);
+	CreateImage(&tmpImage, src->width, 1, src->bytesPerComponent);
+	Image tmpRow;
+	double *buffer = (double *)safeMalloc("filter buffer", 3*src->width*sizeof(double));
 
 	uint_fast32_t nbRectangles = c_arg->nbRectangles;
 	UIRectangle *dstRect;
@@ -367,26 +370,38 @@ void *DownscaleImageThreadRoutine(void *arg)
 		dstRect = &c_arg->rectangles[i];
 		rectHeight = dstRect->y2+1 - dstRect->y1;
 
+		/* Source columns needed by horizontal filter for this rectangle. */
+		uint_fast32_t x1 = (dstRect->x1+0.5)*invScaleX;
+		x1 = (x1 < horizontalGaussianFilter->cx) ? 0 : x1-horizontalGaussianFilter->cx;
+		uint_fast32_t x2 = (dstRect->x2+0.5)*invScaleX;
+		x2 = x2-horizontalGaussianFilter->cx+horizontalGaussianFilter->sx-1;
+		if (x2 >= src->width) {
+			x2 = src->width-1;
+		}
+		CreateImage2(&tmpRow, tmpImage.data, x2+1-x1, 1, src->bytesPerComponent);
+
 		for (uint_fast32_t j = dstRect->y1; j <= dstRect->y2 && !cancelRequested; ++j) {
 			SetThreadProgress(threadArgHeader, 100 * (i * rectHeight + (j-dstRect->y1)) /
 								(rectHeight * nbRectangles));
-			uint_fast32_t y = (j+0.5)*invScaleY;
-			for (uint_fast32_t k = dstRect->x1; k <= dstRect->x2 && !cancelRequested; ++k) {
-				HandleRequests(32);
+			HandleRequests(0);
 
+			/* Taps outside tmpRow are clamped, which is the same as
+			 * clamping them to source image.
+			 */
+			uint_fast32_t y = (j+0.5)*invScaleY;
+			ApplyFilterOnRow(&tmpRow, 0, 0, src, x1, y, tmpRow.width,
+						verticalGaussianFilter, buffer);
+			for (uint_fast32_t k = dstRect->x1; k <= dstRect->x2; ++k) {
 				uint_fast32_t x = (k+0.5)*invScaleX;
 
-				for (uint_fast32_t l = 0; l < horizontalGaussianFilter->sx; ++l) {
-					PutPixelUnsafe(&tmpImage, l, 0, ApplyFilterOnSinglePixel(src,
-						x-horizontalGaussianFilter->cx+l, y, verticalGaussianFilter));
-				}
-				PutPixelUnsafe(dst, k, j, ApplyFilterOnSinglePixel(&tmpImage,
-					horizontalGaussianFilter->cx, 0, horizontalGaussianFilter));
+				PutPixelUnsafe(dst, k, j, ApplyFilterOnSinglePixel(&tmpRow,
+					x-x1, 0, horizontalGaussianFilter));
 			}
 		}
 	}
 	SetThreadProgress(threadArgHeader, 100);
 
+	free(buffer);
 	FreeImage(tmpImage);
 
 	int canceled = CancelTaskRequested(threadArgHeader);
@@ -20,86 +20,211 @@
  
 #include "ppm.h"
 #include "error.h"
+#include "misc.h"
+#include "task.h"
 #include <inttypes.h>
+#include <stdlib.h>
 
-int aux_ExportPPM8(const char *fileName, const Image *image)
+int ExportPPM(const char *fileName, const Image *image, Threads *threads)
+{
+	PPMWriter writer;
+	if (OpenPPMWriter(&writer, fileName, image->width, image->height,
+				image->bytesPerComponent)) {
+		return 1;
+	}
+	int res = WritePPMRows(&writer, image, 0, image->height, threads);
+	if (ClosePPMWriter(&writer)) {
+		res = 1;
+	}
+
+	return res;
+}
+
+int OpenPPMWriter(PPMWriter *writer, const char *fileName, uint_fast32_t width,
+			uint_fast32_t height, uint_fast8_t bytesPerComponent)
 {
-	FILE *file;
 	int res = 0;
 
-	file = fopen(fileName,"wb");
-	if (!file) {
+	FractalNow_message(stdout, T_NORMAL, "Exporting PPM \'%s\'...\n", fileName);
+
+	if (bytesPerComponent != 1 && bytesPerComponent != 2) {
+		FractalNow_error("Invalid image bytes per component.\n");
+	}
+	writer->fileName = fileName;
+	writer->width = width;
+	writer->height = height;
+	writer->bytesPerComponent = bytesPerComponent;
+	writer->nbRows = 0;
+
+	writer->file = fopen(fileName,"wb");
+	if (!writer->file) {
 		FractalNow_open_werror(fileName);
 	}
 
-	fprintf(file,"P6\n%"PRIuFAST32" %"PRIuFAST32"\n%"PRIu8"\n",
-		image->width, image->height, (uint8_t)UINT8_MAX);
-
-	if (image->width != 0 && image->height != 0) {
-		uint8_t *bytes = ImageToBytesArray(image);
-		fwrite(bytes, 3, image->width*image->height, file);
-		free(bytes);
+	if (bytesPerComponent == 1) {
+		fprintf(writer->file,"P6\n%"PRIuFAST32" %"PRIuFAST32"\n%"PRIu8"\n",
+			width, height, (uint8_t)UINT8_MAX);
+	} else {
+		fprintf(writer->file,"P6\n%"PRIuFAST32" %"PRIuFAST32"\n%"PRIu16"\n",
+			width, height, (uint16_t)UINT16_MAX);
 	}
 
 	end:
-	if (file && fclose(file)) {
-		FractalNow_close_errmsg(fileName);
-		res = 1;
+	if (res) {
+		FractalNow_message(stdout, T_NORMAL, "Exporting PPM \'%s\' : FAILED.\n",
+					fileName);
 	}
 
 	return res;
 }
 
-int aux_ExportPPM16(const char *fileName, const Image *image)
-{
+/* State shared by threads writing chunks of rows : chunks are
+ * written in order, each thread waiting for its turn.
+ */
+typedef struct s_PPMRowsWriting {
 	FILE *file;
+	uint_fast32_t nextChunk;
+	int failed;
+	pthread_mutex_t mutex;
+	pthread_cond_t turnCond;
+} PPMRowsWriting;
+
+typedef struct s_WritePPMRowsArguments {
+	uint_fast32_t threadId;
+	uint_fast32_t nbThreads;
+	const Image *image;
+	uint_fast32_t y;
+	uint_fast32_t nbRows;
+	uint_fast32_t chunkRows;
+	PPMRowsWriting *writing;
+} WritePPMRowsArguments;
+
+void *WritePPMRowsThreadRoutine(void *arg)
+{
+	ThreadArgHeader *threadArgHeader = GetThreadArgHeader(arg);
+	WritePPMRowsArguments *c_arg = (WritePPMRowsArguments *)GetThreadArgBody(arg);
+	const Image *image = c_arg->image;
+	PPMRowsWriting *writing = c_arg->writing;
+	size_t rowSize = image->width*3*image->bytesPerComponent;
+	uint_fast32_t nbChunks = (c_arg->nbRows+c_arg->chunkRows-1) / c_arg->chunkRows;
+	uint8_t *buffer = (uint8_t *)safeMalloc("PPM rows", c_arg->chunkRows*rowSize);
+
+	int failed = 0;
+	for (uint_fast32_t i = c_arg->threadId; i < nbChunks && !failed; i += c_arg->nbThreads) {
+		SetThreadProgress(threadArgHeader, 100 * i / nbChunks);
+		HandlePauseRequest(threadArgHeader);
+
+		uint_fast32_t y = i*c_arg->chunkRows;
+		uint_fast32_t nbRows = (c_arg->nbRows-y < c_arg->chunkRows) ?
+					c_arg->nbRows-y : c_arg->chunkRows;
+		/* Threads waiting for their turn can only be released by the
+		 * threads writing the chunks before theirs : a canceled thread
+		 * makes all of them stop.
+		 */
+		int cancelRequested = CancelTaskRequested(threadArgHeader);
+		if (!cancelRequested) {
+			ImageRowsToBytes(buffer, image, c_arg->y+y, nbRows);
+		}
+
+		pthread_mutex_lock(&writing->mutex);
+		while (!writing->failed && !cancelRequested && writing->nextChunk != i) {
+			pthread_cond_wait(&writing->turnCond, &writing->mutex);
+		}
+		if (cancelRequested || (!writing->failed &&
+			fwrite(buffer, rowSize, nbRows, writing->file) != nbRows)) {
+			writing->failed = 1;
+		}
+		++writing->nextChunk;
+		failed = writing->failed;
+		pthread_cond_broadcast(&writing->turnCond);
+		pthread_mutex_unlock(&writing->mutex);
+	}
+	free(buffer);
+
+	SetThreadProgress(threadArgHeader, 100);
+
+	return NULL;
+}
+
+int WritePPMRows(PPMWriter *writer, const Image *image, uint_fast32_t y,
+			uint_fast32_t nbRows, Threads *threads)
+{
 	int res = 0;
 
-	file = fopen(fileName,"wb");
-	if (!file) {
-		FractalNow_open_werror(fileName);
+	if (image->width != writer->width ||
+		image->bytesPerComponent != writer->bytesPerComponent) {
+		FractalNow_error("Image does not match PPM file being written.\n");
+	}
+	if (y+nbRows > image->height || writer->nbRows+nbRows > writer->height) {
+		FractalNow_error("Too many rows written in PPM file.\n");
+	}
+	if (image->width == 0 || nbRows == 0) {
+		writer->nbRows += nbRows;
+		return 0;
 	}
 
-	fprintf(file,"P6\n%"PRIuFAST32" %"PRIuFAST32"\n%"PRIu16"\n",
-		image->width, image->height, (uint16_t)UINT16_MAX);
-
-	if (image->width != 0 && image->height != 0) {
-		uint8_t *bytes = ImageToBytesArray(image);
-		fwrite(bytes, 6, image->width*image->height, file);
-		free(bytes);
+	size_t rowSize = image->width*3*image->bytesPerComponent;
+	uint_fast32_t chunkRows = (rowSize >= PPM_CHUNK_SIZE) ? 1 : PPM_CHUNK_SIZE / rowSize;
+	if (chunkRows > nbRows) {
+		chunkRows = nbRows;
+	}
+	uint_fast32_t nbChunks = (nbRows+chunkRows-1) / chunkRows;
+	uint_fast32_t nbThreadsNeeded = (nbChunks < threads->N) ? nbChunks : threads->N;
+
+	PPMRowsWriting writing;
+	writing.file = writer->file;
+	writing.nextChunk = 0;
+	writing.failed = 0;
+	pthread_mutex_init(&writing.mutex, NULL);
+	pthread_cond_init(&writing.turnCond, NULL);
+
+	WritePPMRowsArguments *arg;
+	arg = (WritePPMRowsArguments *)safeMalloc("arguments", nbThreadsNeeded *
+							sizeof(WritePPMRowsArguments));
+	for (uint_fast32_t i = 0; i < nbThreadsNeeded; ++i) {
+		arg[i].threadId = i;
+		arg[i].nbThreads = nbThreadsNeeded;
+		arg[i].image = image;
+		arg[i].y = y;
+		arg[i].nbRows = nbRows;
+		arg[i].chunkRows = chunkRows;
+		arg[i].writing = &writing;
 	}
+	Task *task = CreateTask(NULL, nbThreadsNeeded, arg, sizeof(WritePPMRowsArguments),
+					WritePPMRowsThreadRoutine, NULL);
+	free(arg);
+	int unused = ExecuteTaskBlocking(task, threads);
+	UNUSED(unused);
 
-	end:
-	if (file && fclose(file)) {
-		FractalNow_close_errmsg(fileName);
-		res = 1;
+	pthread_mutex_destroy(&writing.mutex);
+	pthread_cond_destroy(&writing.turnCond);
+
+	if (writing.failed) {
+		FractalNow_write_werror(writer->fileName);
 	}
+	writer->nbRows += nbRows;
 
+	end:
 	return res;
-
 }
 
-int ExportPPM(const char *fileName, const Image *image)
+int ClosePPMWriter(PPMWriter *writer)
 {
 	int res = 0;
 
-	FractalNow_message(stdout, T_NORMAL, "Exporting PPM \'%s\'...\n", fileName);
-
-	switch (image->bytesPerComponent) {
-	case 1:
-		res = aux_ExportPPM8(fileName, image);
-		break;
-	case 2:
-		res = aux_ExportPPM16(fileName, image);
-		break;
-	default:
-		FractalNow_error("Invalid image bytes per component.\n");
-		break;
+	if (writer->nbRows != writer->height) {
+		FractalNow_message(stderr, T_QUIET, "Only %"PRIuFAST32" rows out of %"
+			PRIuFAST32" written in \'%s\'.\n", writer->nbRows, writer->height,
+			writer->fileName);
+		res = 1;
+	}
+	if (fclose(writer->file)) {
+		FractalNow_close_errmsg(writer->fileName);
+		res = 1;
 	}
 
-	FractalNow_message(stdout, T_NORMAL, "Exporting PPM \'%s\' : %s.\n", fileName,
-				(res == 0) ? "DONE" : "FAILED");
+	FractalNow_message(stdout, T_NORMAL, "Exporting PPM \'%s\' : %s.\n",
+				writer->fileName, (res == 0) ? "DONE" : "FAILED");
 
 	return res;
 }
-
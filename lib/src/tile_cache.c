@@ -0,0 +1,712 @@
+/*
+ *  tile_cache.c -- part of FractalNow
+ *
+ *  Copyright (c) 2012 Marc Pegon <pe.marc@free.fr>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "tile_cache.h"
+#include "float_precision.h"
+#include "fractal.h"
+#include "misc.h"
+#include "uirectangle.h"
+#include <math.h>
+#include <string.h>
+
+/* Relative difference under which pixel spans are considered equal. */
+#define TILE_LEVEL_SPAN_TOLERANCE (1E-9)
+/* Distance to a whole number of pixels under which views are aligned. */
+#define TILE_LEVEL_OFFSET_TOLERANCE (1E-3)
+/* Views further away from level origin (in pixels) are never aligned. */
+#define TILE_LEVEL_MAX_OFFSET (1E15)
+
+static inline size_t GetTileColorsSize(uint_fast8_t bytesPerComponent)
+{
+	return TILE_SIZE*TILE_SIZE*4*bytesPerComponent;
+}
+
+static inline size_t GetTileDataSize(uint_fast8_t bytesPerComponent)
+{
+	return GetTileColorsSize(bytesPerComponent) + TILE_SIZE*TILE_SIZE*sizeof(double);
+}
+
+static inline int_fast64_t FloorDiv(int_fast64_t a, int_fast64_t b)
+{
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+/* Hash bucket of tile (level, x, y). */
+static inline uint_fast32_t GetTileBucket(const TileCache *cache, uint_fast32_t level,
+					int_fast64_t x, int_fast64_t y)
+{
+	uint_fast64_t h = (uint_fast64_t)x * UINT64_C(0x9E3779B97F4A7C15) ^
+			(uint_fast64_t)y * UINT64_C(0xC2B2AE3D27D4EB4F) ^
+			(uint_fast64_t)level * UINT64_C(0x165667B19E3779F9);
+	return (uint_fast32_t)(h >> 32 ^ h) & cache->bucketMask;
+}
+
+int CreateTileCache(TileCache *cache, uint_fast32_t size, uint_fast32_t spillSize)
+{
+	int res = 0;
+
+	cache->size = size;
+	cache->spillSize = spillSize;
+	cache->hasParameters = 0;
+	cache->bytesPerComponent = 1;
+	cache->colorGeneration = 0;
+	cache->nbLevels = 0;
+	cache->level = NULL;
+	cache->nbTiles = 0;
+	cache->tile = NULL;
+	/* At least one bucket per tile that can be cached. */
+	uint_fast32_t nbBuckets = 1;
+	while (nbBuckets < size + spillSize) {
+		nbBuckets *= 2;
+	}
+	cache->bucketMask = nbBuckets-1;
+	cache->bucket = (uint_fast32_t *)safeMalloc("tile cache buckets",
+						nbBuckets * sizeof(uint_fast32_t));
+	for (uint_fast32_t i = 0; i < nbBuckets; ++i) {
+		cache->bucket[i] = NO_TILE;
+	}
+	cache->memoryTiles.first = NO_TILE;
+	cache->memoryTiles.last = NO_TILE;
+	cache->spilledTiles.first = NO_TILE;
+	cache->spilledTiles.last = NO_TILE;
+	cache->nbTilesInMemory = 0;
+	cache->spillFile = NULL;
+	cache->nbSpillSlots = 0;
+	cache->nbFreeSpillSlots = 0;
+	cache->freeSpillSlot = NULL;
+	if (spillSize != 0) {
+		cache->spillFile = tmpfile();
+		if (cache->spillFile == NULL) {
+			cache->spillSize = 0;
+			res = 1;
+		} else {
+			cache->freeSpillSlot = (uint_fast32_t *)safeMalloc("tile cache spill slots",
+						spillSize * sizeof(uint_fast32_t));
+		}
+	}
+
+	return res;
+}
+
+/* Compare the rendering parameters that only change tiles colors. */
+static int CompareRenderingColors(const RenderingParameters *param1,
+					const RenderingParameters *param2)
+{
+	const Gradient *gradient1 = &param1->gradient;
+	const Gradient *gradient2 = &param2->gradient;
+	int res = (param1->transferFunction != param2->transferFunction ||
+		param1->multiplier != param2->multiplier ||
+		param1->offset != param2->offset ||
+		gradient1->size != gradient2->size ||
+		gradient1->nbStops != gradient2->nbStops);
+	for (uint_fast32_t i = 0; !res && i < gradient1->nbStops; ++i) {
+		res = (gradient1->positionStop[i] != gradient2->positionStop[i] ||
+			CompareColors(gradient1->colorStop[i], gradient2->colorStop[i]));
+	}
+
+	return res;
+}
+
+static int isTileCacheUsable(const TileCache *cache, const Image *image,
+				const Fractal *fractal, const RenderingParameters *render)
+{
+	return (cache->hasParameters && cache->bytesPerComponent == image->bytesPerComponent &&
+		!PartCompareFractals(&cache->fractal, fractal) &&
+		!PartCompareRenderingParameters(&cache->render, render));
+}
+
+/* Start new color generation if colors have changed. */
+static void UpdateTileCacheColors(TileCache *cache, const RenderingParameters *render)
+{
+	if (CompareRenderingColors(&cache->render, render)) {
+		FreeRenderingParameters(cache->render);
+		cache->render = CopyRenderingParameters(render);
+		++cache->colorGeneration;
+	}
+}
+
+/* LRU list tile belongs to (depends on whether its data is in memory). */
+static inline TileList *GetTileList(TileCache *cache, const Tile *tile)
+{
+	return (tile->data == NULL) ? &cache->spilledTiles : &cache->memoryTiles;
+}
+
+static void UnlinkTile(TileCache *cache, TileList *list, uint_fast32_t index)
+{
+	Tile *tile = &cache->tile[index];
+	if (tile->previous == NO_TILE) {
+		list->first = tile->next;
+	} else {
+		cache->tile[tile->previous].next = tile->next;
+	}
+	if (tile->next == NO_TILE) {
+		list->last = tile->previous;
+	} else {
+		cache->tile[tile->next].previous = tile->previous;
+	}
+}
+
+/* Add tile at the end of list (most recently used). */
+static void AppendTile(TileCache *cache, TileList *list, uint_fast32_t index)
+{
+	Tile *tile = &cache->tile[index];
+	tile->previous = list->last;
+	tile->next = NO_TILE;
+	if (list->last == NO_TILE) {
+		list->first = index;
+	} else {
+		cache->tile[list->last].next = index;
+	}
+	list->last = index;
+}
+
+/* Make tile (whose data must be in memory) the most recently used one. */
+static void TouchTile(TileCache *cache, uint_fast32_t index)
+{
+	UnlinkTile(cache, &cache->memoryTiles, index);
+	AppendTile(cache, &cache->memoryTiles, index);
+}
+
+/* Move last tile of array to index (tile at index must have been
+ * unlinked), updating everything that refers to it.
+ */
+static void MoveLastTile(TileCache *cache, uint_fast32_t index)
+{
+	uint_fast32_t last = cache->nbTiles;
+	Tile *tile = &cache->tile[index];
+	*tile = cache->tile[last];
+
+	TileList *list = GetTileList(cache, tile);
+	if (tile->previous == NO_TILE) {
+		list->first = index;
+	} else {
+		cache->tile[tile->previous].next = index;
+	}
+	if (tile->next == NO_TILE) {
+		list->last = index;
+	} else {
+		cache->tile[tile->next].previous = index;
+	}
+
+	uint_fast32_t *p = &cache->bucket[GetTileBucket(cache, tile->level, tile->x, tile->y)];
+	while (*p != last) {
+		p = &cache->tile[*p].nextInBucket;
+	}
+	*p = index;
+}
+
+static void RemoveTile(TileCache *cache, uint_fast32_t index)
+{
+	Tile *tile = &cache->tile[index];
+	UnlinkTile(cache, GetTileList(cache, tile), index);
+	uint_fast32_t *p = &cache->bucket[GetTileBucket(cache, tile->level, tile->x, tile->y)];
+	while (*p != index) {
+		p = &cache->tile[*p].nextInBucket;
+	}
+	*p = tile->nextInBucket;
+
+	if (tile->data != NULL) {
+		free(tile->data);
+		--cache->nbTilesInMemory;
+	} else {
+		cache->freeSpillSlot[cache->nbFreeSpillSlots++] = tile->spillSlot;
+	}
+	--cache->level[tile->level].nbTiles;
+	if (index != --cache->nbTiles) {
+		MoveLastTile(cache, index);
+	}
+}
+
+static void ClearTileCache(TileCache *cache)
+{
+	while (cache->nbTiles > 0) {
+		RemoveTile(cache, cache->nbTiles-1);
+	}
+	cache->nbSpillSlots = 0;
+	cache->nbFreeSpillSlots = 0;
+	if (cache->spillFile != NULL) {
+		rewind(cache->spillFile);
+	}
+}
+
+/* Reset cache (emptied) if parameters differ from cache ones. */
+static void SetTileCacheParameters(TileCache *cache, const Image *image,
+				const Fractal *fractal, const RenderingParameters *render)
+{
+	if (isTileCacheUsable(cache, image, fractal, render)) {
+		UpdateTileCacheColors(cache, render);
+	} else {
+		ClearTileCache(cache);
+		if (cache->hasParameters) {
+			FreeFractal(cache->fractal);
+			FreeRenderingParameters(cache->render);
+		}
+		cache->fractal = CopyFractal(fractal);
+		cache->render = CopyRenderingParameters(render);
+		cache->bytesPerComponent = image->bytesPerComponent;
+		cache->hasParameters = 1;
+		++cache->colorGeneration;
+	}
+}
+
+/* Get view offset (in pixels) from level origin.
+ * Return 1 if view belongs to level, 0 otherwise.
+ */
+static int GetTileLevelOffset(const TileLevel *level, const BiggestFloat x1,
+				const BiggestFloat y1, const BiggestFloat pixelSpanX,
+				const BiggestFloat pixelSpanY, int_fast64_t *offsetX,
+				int_fast64_t *offsetY)
+{
+	int res = 0;
+	BiggestFloat tmp;
+	initBiggestF(tmp);
+
+	subBiggestF(tmp, pixelSpanX, level->pixelSpanX);
+	divBiggestF(tmp, tmp, level->pixelSpanX);
+	double errX = toDoubleBiggestF(tmp);
+	subBiggestF(tmp, pixelSpanY, level->pixelSpanY);
+	divBiggestF(tmp, tmp, level->pixelSpanY);
+	double errY = toDoubleBiggestF(tmp);
+	if (fabs(errX) <= TILE_LEVEL_SPAN_TOLERANCE && fabs(errY) <= TILE_LEVEL_SPAN_TOLERANCE) {
+		subBiggestF(tmp, x1, level->x1);
+		divBiggestF(tmp, tmp, level->pixelSpanX);
+		double dx = toDoubleBiggestF(tmp);
+		subBiggestF(tmp, y1, level->y1);
+		divBiggestF(tmp, tmp, level->pixelSpanY);
+		double dy = toDoubleBiggestF(tmp);
+		double rx = round(dx), ry = round(dy);
+		if (fabs(rx) < TILE_LEVEL_MAX_OFFSET && fabs(ry) < TILE_LEVEL_MAX_OFFSET &&
+			fabs(dx-rx) <= TILE_LEVEL_OFFSET_TOLERANCE &&
+			fabs(dy-ry) <= TILE_LEVEL_OFFSET_TOLERANCE) {
+			*offsetX = (int_fast64_t)rx;
+			*offsetY = (int_fast64_t)ry;
+			res = 1;
+		}
+	}
+
+	clearBiggestF(tmp);
+
+	return res;
+}
+
+/* Get level of view (created if necessary when create is 1).
+ * Return cache->nbLevels if view belongs to no level.
+ */
+static uint_fast32_t GetTileLevel(TileCache *cache, const Fractal *fractal,
+				uint_fast32_t width, uint_fast32_t height, int create,
+				int_fast64_t *offsetX, int_fast64_t *offsetY)
+{
+	BiggestFloat pixelSpanX, pixelSpanY;
+	initBiggestF(pixelSpanX);
+	initBiggestF(pixelSpanY);
+	div_uiBiggestF(pixelSpanX, fractal->spanX, width);
+	div_uiBiggestF(pixelSpanY, fractal->spanY, height);
+
+	uint_fast32_t res = cache->nbLevels;
+	uint_fast32_t freeLevel = cache->nbLevels;
+	for (uint_fast32_t i = 0; i < cache->nbLevels; ++i) {
+		TileLevel *level = &cache->level[i];
+		if (level->nbTiles == 0) {
+			if (freeLevel == cache->nbLevels) {
+				freeLevel = i;
+			}
+		} else if (GetTileLevelOffset(level, fractal->x1, fractal->y1, pixelSpanX,
+						pixelSpanY, offsetX, offsetY)) {
+			res = i;
+			break;
+		}
+	}
+	if (res == cache->nbLevels && create) {
+		if (freeLevel == cache->nbLevels) {
+			cache->level = (TileLevel *)safeRealloc("tile levels", cache->level,
+					(cache->nbLevels+1) * sizeof(TileLevel));
+			TileLevel *level = &cache->level[cache->nbLevels++];
+			initBiggestF(level->x1);
+			initBiggestF(level->y1);
+			initBiggestF(level->pixelSpanX);
+			initBiggestF(level->pixelSpanY);
+			level->nbTiles = 0;
+		}
+		TileLevel *level = &cache->level[freeLevel];
+		assignBiggestF(level->x1, fractal->x1);
+		assignBiggestF(level->y1, fractal->y1);
+		assignBiggestF(level->pixelSpanX, pixelSpanX);
+		assignBiggestF(level->pixelSpanY, pixelSpanY);
+		*offsetX = 0;
+		*offsetY = 0;
+		res = freeLevel;
+	}
+
+	clearBiggestF(pixelSpanX);
+	clearBiggestF(pixelSpanY);
+
+	return res;
+}
+
+/* Return cache->nbTiles if tile is not in cache. */
+static uint_fast32_t FindTile(const TileCache *cache, uint_fast32_t level,
+				int_fast64_t x, int_fast64_t y)
+{
+	uint_fast32_t res = cache->bucket[GetTileBucket(cache, level, x, y)];
+	while (res != NO_TILE) {
+		const Tile *tile = &cache->tile[res];
+		if (tile->x == x && tile->y == y && tile->level == level) {
+			break;
+		}
+		res = tile->nextInBucket;
+	}
+
+	return (res == NO_TILE) ? cache->nbTiles : res;
+}
+
+/* Get slot of spill file to write a tile to.
+ * Least recently used spilled tile is dropped if spill file is full.
+ * Return 1 in case of success, 0 otherwise.
+ */
+static int GetSpillSlot(TileCache *cache, uint_fast32_t *slot)
+{
+	if (cache->nbFreeSpillSlots == 0 && cache->nbSpillSlots == cache->spillSize &&
+		cache->spilledTiles.first != NO_TILE) {
+		RemoveTile(cache, cache->spilledTiles.first);
+	}
+
+	int res = 1;
+	if (cache->nbFreeSpillSlots > 0) {
+		*slot = cache->freeSpillSlot[--cache->nbFreeSpillSlots];
+	} else if (cache->nbSpillSlots < cache->spillSize) {
+		*slot = cache->nbSpillSlots++;
+	} else {
+		res = 0;
+	}
+
+	return res;
+}
+
+/* Spill (or drop) least recently used tiles until there are no more
+ * tiles in memory than cache size.
+ */
+static void EnforceTileCacheSize(TileCache *cache)
+{
+	size_t dataSize = GetTileDataSize(cache->bytesPerComponent);
+	while (cache->nbTilesInMemory > cache->size) {
+		uint_fast32_t slot;
+		int spill = (cache->spillFile != NULL && GetSpillSlot(cache, &slot));
+
+		/* Spilled tiles were all used before tiles in memory, so
+		 * that spilled tiles list stays ordered.
+		 */
+		uint_fast32_t lru = cache->memoryTiles.first;
+		Tile *tile = &cache->tile[lru];
+		if (spill) {
+			spill = (fseek(cache->spillFile, (long)slot * dataSize, SEEK_SET) == 0 &&
+				fwrite(tile->data, dataSize, 1, cache->spillFile) == 1);
+			if (!spill) {
+				cache->freeSpillSlot[cache->nbFreeSpillSlots++] = slot;
+			}
+		}
+		if (spill) {
+			UnlinkTile(cache, &cache->memoryTiles, lru);
+			free(tile->data);
+			tile->data = NULL;
+			tile->spillSlot = slot;
+			--cache->nbTilesInMemory;
+			AppendTile(cache, &cache->spilledTiles, lru);
+		} else {
+			RemoveTile(cache, lru);
+		}
+	}
+}
+
+/* Read spilled tile back into memory.
+ * Tile is dropped (and 0 returned) if it cannot be read.
+ */
+static int LoadTile(TileCache *cache, uint_fast32_t index)
+{
+	Tile *tile = &cache->tile[index];
+	if (tile->data != NULL) {
+		return 1;
+	}
+
+	size_t dataSize = GetTileDataSize(cache->bytesPerComponent);
+	uint8_t *data = (uint8_t *)safeMalloc("tile data", dataSize);
+	if (fseek(cache->spillFile, (long)tile->spillSlot * dataSize, SEEK_SET) != 0 ||
+		fread(data, dataSize, 1, cache->spillFile) != 1) {
+		free(data);
+		RemoveTile(cache, index);
+		return 0;
+	}
+	cache->freeSpillSlot[cache->nbFreeSpillSlots++] = tile->spillSlot;
+	UnlinkTile(cache, &cache->spilledTiles, index);
+	tile->data = data;
+	++cache->nbTilesInMemory;
+	AppendTile(cache, &cache->memoryTiles, index);
+
+	return 1;
+}
+
+void StoreImageTiles(TileCache *cache, const Image *image, const ValueBuffer *values,
+			const Fractal *fractal, const RenderingParameters *render)
+{
+	if (image->width < TILE_SIZE || image->height < TILE_SIZE ||
+		values->width != image->width || values->height != image->height) {
+		return;
+	}
+	SetTileCacheParameters(cache, image, fractal, render);
+
+	int_fast64_t offsetX, offsetY;
+	uint_fast32_t level = GetTileLevel(cache, fractal, image->width, image->height, 1,
+						&offsetX, &offsetY);
+	size_t colorsSize = GetTileColorsSize(cache->bytesPerComponent);
+	size_t dataSize = GetTileDataSize(cache->bytesPerComponent);
+	size_t pixelSize = 4*cache->bytesPerComponent;
+
+	/* Tiles lying entirely inside image. */
+	int_fast64_t tileX1 = FloorDiv(offsetX + TILE_SIZE - 1, TILE_SIZE);
+	int_fast64_t tileX2 = FloorDiv(offsetX + image->width, TILE_SIZE);
+	int_fast64_t tileY1 = FloorDiv(offsetY + TILE_SIZE - 1, TILE_SIZE);
+	int_fast64_t tileY2 = FloorDiv(offsetY + image->height, TILE_SIZE);
+	for (int_fast64_t y = tileY1; y < tileY2; ++y) {
+		for (int_fast64_t x = tileX1; x < tileX2; ++x) {
+			uint_fast32_t index = FindTile(cache, level, x, y);
+			if (index == cache->nbTiles) {
+				cache->tile = (Tile *)safeRealloc("tiles", cache->tile,
+						(cache->nbTiles+1) * sizeof(Tile));
+				Tile *tile = &cache->tile[cache->nbTiles++];
+				tile->level = level;
+				tile->x = x;
+				tile->y = y;
+				tile->data = (uint8_t *)safeMalloc("tile data", dataSize);
+				tile->spillSlot = 0;
+				uint_fast32_t *bucket = &cache->bucket[GetTileBucket(cache,
+								level, x, y)];
+				tile->nextInBucket = *bucket;
+				*bucket = index;
+				AppendTile(cache, &cache->memoryTiles, index);
+				++cache->nbTilesInMemory;
+				++cache->level[level].nbTiles;
+			} else if (cache->tile[index].data == NULL) {
+				/* Overwritten : spilled data is obsolete. */
+				Tile *tile = &cache->tile[index];
+				cache->freeSpillSlot[cache->nbFreeSpillSlots++] = tile->spillSlot;
+				UnlinkTile(cache, &cache->spilledTiles, index);
+				tile->data = (uint8_t *)safeMalloc("tile data", dataSize);
+				AppendTile(cache, &cache->memoryTiles, index);
+				++cache->nbTilesInMemory;
+			} else {
+				TouchTile(cache, index);
+			}
+			Tile *tile = &cache->tile[index];
+			uint_fast32_t x1 = x*TILE_SIZE - offsetX;
+			uint_fast32_t y1 = y*TILE_SIZE - offsetY;
+			double *tileValues = (double *)(tile->data + colorsSize);
+			for (uint_fast32_t j = 0; j < TILE_SIZE; ++j) {
+				memcpy(tile->data + j*TILE_SIZE*pixelSize,
+					image->data + ((y1+j)*image->width + x1)*pixelSize,
+					TILE_SIZE*pixelSize);
+				memcpy(tileValues + j*TILE_SIZE,
+					values->values + (y1+j)*values->width + x1,
+					TILE_SIZE*sizeof(double));
+			}
+			tile->colorGeneration = cache->colorGeneration;
+
+			EnforceTileCacheSize(cache);
+		}
+	}
+}
+
+/* Recompute tile colors from its values. */
+static void RecolorTile(const TileCache *cache, Tile *tile, const ColorMap *colorMap)
+{
+	Image image;
+	CreateImage2(&image, tile->data, TILE_SIZE, TILE_SIZE, cache->bytesPerComponent);
+	const double *value = (const double *)(tile->data +
+				GetTileColorsSize(cache->bytesPerComponent));
+	for (uint_fast32_t j = 0; j < TILE_SIZE; ++j) {
+		for (uint_fast32_t i = 0; i < TILE_SIZE; ++i) {
+			PutPixelUnsafe(&image, i, j, GetColorMapColor(colorMap,
+						value[j*TILE_SIZE+i]));
+		}
+	}
+	FreeImage(image);
+	tile->colorGeneration = cache->colorGeneration;
+}
+
+/* Get largest rectangle of image (in pixels) made of restored tiles.
+ * Return 1 if there is one, 0 otherwise.
+ */
+static int GetRestoredRegion(const uint8_t *restored, uint_fast32_t nbTilesX,
+				uint_fast32_t nbTilesY, int_fast64_t offsetX,
+				int_fast64_t offsetY, int_fast64_t tileX1, int_fast64_t tileY1,
+				uint_fast32_t width, uint_fast32_t height, UIRectangle *region)
+{
+	uint_fast32_t *columnHeight = (uint_fast32_t *)safeCalloc("restored column heights",
+						nbTilesX, sizeof(uint_fast32_t));
+	uint_fast64_t bestArea = 0;
+	for (uint_fast32_t j = 0; j < nbTilesY; ++j) {
+		for (uint_fast32_t i = 0; i < nbTilesX; ++i) {
+			columnHeight[i] = restored[j*nbTilesX+i] ? columnHeight[i]+1 : 0;
+		}
+		int_fast64_t y2 = (tileY1 + j + 1) * TILE_SIZE - offsetY - 1;
+		for (uint_fast32_t i = 0; i < nbTilesX; ++i) {
+			uint_fast32_t h = columnHeight[i];
+			if (h == 0) {
+				continue;
+			}
+			uint_fast32_t l = i, r = i;
+			while (l > 0 && columnHeight[l-1] >= h) {
+				--l;
+			}
+			while (r+1 < nbTilesX && columnHeight[r+1] >= h) {
+				++r;
+			}
+			int_fast64_t x1 = (tileX1 + l) * TILE_SIZE - offsetX;
+			int_fast64_t x2 = (tileX1 + r + 1) * TILE_SIZE - offsetX - 1;
+			int_fast64_t y1 = y2 + 1 - (int_fast64_t)h * TILE_SIZE;
+			x1 = (x1 < 0) ? 0 : x1;
+			y1 = (y1 < 0) ? 0 : y1;
+			x2 = (x2 >= (int_fast64_t)width) ? (int_fast64_t)width-1 : x2;
+			int_fast64_t bottom = (y2 >= (int_fast64_t)height) ?
+						(int_fast64_t)height-1 : y2;
+			uint_fast64_t area = (x2-x1+1) * (bottom-y1+1);
+			if (area > bestArea) {
+				bestArea = area;
+				InitUIRectangle(region, x1, y1, x2, bottom);
+			}
+		}
+	}
+	free(columnHeight);
+
+	return (bestArea > 0);
+}
+
+int RestoreImageTiles(TileCache *cache, Image *image, ValueBuffer *values,
+			const Fractal *fractal, const RenderingParameters *render,
+			UIRectangle *region)
+{
+	if (image->width == 0 || image->height == 0 ||
+		!isTileCacheUsable(cache, image, fractal, render)) {
+		return 0;
+	}
+	int_fast64_t offsetX, offsetY;
+	uint_fast32_t level = GetTileLevel(cache, fractal, image->width, image->height, 0,
+						&offsetX, &offsetY);
+	if (level == cache->nbLevels) {
+		return 0;
+	}
+	UpdateTileCacheColors(cache, render);
+
+	size_t colorsSize = GetTileColorsSize(cache->bytesPerComponent);
+	size_t pixelSize = 4*cache->bytesPerComponent;
+	int_fast64_t tileX1 = FloorDiv(offsetX, TILE_SIZE);
+	int_fast64_t tileX2 = FloorDiv(offsetX + image->width - 1, TILE_SIZE);
+	int_fast64_t tileY1 = FloorDiv(offsetY, TILE_SIZE);
+	int_fast64_t tileY2 = FloorDiv(offsetY + image->height - 1, TILE_SIZE);
+	uint_fast32_t nbTilesX = tileX2 - tileX1 + 1;
+	uint_fast32_t nbTilesY = tileY2 - tileY1 + 1;
+	uint8_t *restored = (uint8_t *)safeCalloc("restored tiles", nbTilesX*nbTilesY,
+							sizeof(uint8_t));
+	int valuesReset = 0;
+	int colorMapCreated = 0;
+	ColorMap colorMap;
+	for (uint_fast32_t j = 0; j < nbTilesY; ++j) {
+		for (uint_fast32_t i = 0; i < nbTilesX; ++i) {
+			int_fast64_t x = tileX1 + i, y = tileY1 + j;
+			uint_fast32_t index = FindTile(cache, level, x, y);
+			if (index == cache->nbTiles || !LoadTile(cache, index)) {
+				continue;
+			}
+			if (!valuesReset) {
+				if (values->width != image->width || values->height != image->height) {
+					FreeValueBuffer(values);
+					CreateValueBuffer(values, image->width, image->height);
+				} else {
+					ResetValueBufferSamples(values);
+				}
+				values->maxValue = (double)fractal->maxIter+1;
+				valuesReset = 1;
+			}
+			Tile *tile = &cache->tile[index];
+			if (tile->colorGeneration != cache->colorGeneration) {
+				if (!colorMapCreated) {
+					CreateColorMap(&colorMap, &cache->render, values->maxValue);
+					colorMapCreated = 1;
+				}
+				RecolorTile(cache, tile, &colorMap);
+			}
+
+			/* Copy part of tile inside image. */
+			int_fast64_t x1 = x*TILE_SIZE - offsetX, y1 = y*TILE_SIZE - offsetY;
+			uint_fast32_t srcX = (x1 < 0) ? -x1 : 0;
+			uint_fast32_t srcY = (y1 < 0) ? -y1 : 0;
+			uint_fast32_t dstX = x1 + srcX, dstY = y1 + srcY;
+			uint_fast32_t w = TILE_SIZE - srcX, h = TILE_SIZE - srcY;
+			if (dstX + w > image->width) {
+				w = image->width - dstX;
+			}
+			if (dstY + h > image->height) {
+				h = image->height - dstY;
+			}
+			const double *tileValues = (const double *)(tile->data + colorsSize);
+			for (uint_fast32_t k = 0; k < h; ++k) {
+				memcpy(image->data + ((dstY+k)*image->width + dstX)*pixelSize,
+					tile->data + ((srcY+k)*TILE_SIZE + srcX)*pixelSize,
+					w*pixelSize);
+				memcpy(values->values + (dstY+k)*values->width + dstX,
+					tileValues + (srcY+k)*TILE_SIZE + srcX,
+					w*sizeof(double));
+			}
+			TouchTile(cache, index);
+			restored[j*nbTilesX+i] = 1;
+
+			EnforceTileCacheSize(cache);
+		}
+	}
+	if (colorMapCreated) {
+		FreeColorMap(&colorMap);
+	}
+
+	int res = GetRestoredRegion(restored, nbTilesX, nbTilesY, offsetX, offsetY,
+					tileX1, tileY1, image->width, image->height, region);
+	free(restored);
+
+	return res;
+}
+
+void FreeTileCache(TileCache *cache)
+{
+	ClearTileCache(cache);
+	free(cache->tile);
+	free(cache->bucket);
+	for (uint_fast32_t i = 0; i < cache->nbLevels; ++i) {
+		clearBiggestF(cache->level[i].x1);
+		clearBiggestF(cache->level[i].y1);
+		clearBiggestF(cache->level[i].pixelSpanX);
+		clearBiggestF(cache->level[i].pixelSpanY);
+	}
+	free(cache->level);
+	if (cache->hasParameters) {
+		FreeFractal(cache->fractal);
+		FreeRenderingParameters(cache->render);
+	}
+	if (cache->spillFile != NULL) {
+		fclose(cache->spillFile);
+	}
+	free(cache->freeSpillSlot);
+}
@@ -22,6 +22,11 @@
 #include "misc.h"
 #include <stdlib.h>
 
+/* Width (in rectangles) of the rings used to order rectangles around
+ * focus point.
+ */
+#define FOCUS_RING_WIDTH (uint_fast32_t)(2)
+
 inline void InitUIRectangle(UIRectangle *rectangle, uint_fast32_t x1, uint_fast32_t y1, uint_fast32_t x2, uint_fast32_t y2)
 {
 	rectangle->x1 = x1;
@@ -75,6 +80,130 @@ void CutUIRectangleMaxSize(UIRectangle src, uint_fast32_t size, UIRectangle **ou
 	}
 }
 
+/* Index of point (x,y) along the Hilbert curve filling a n*n square
+ * (n being a power of 2).
+ */
+static uint_fast64_t HilbertIndex(uint_fast32_t n, uint_fast32_t x, uint_fast32_t y)
+{
+	uint_fast64_t res = 0;
+	uint_fast32_t rx, ry, tmp;
+	for (uint_fast32_t s = n/2; s > 0; s /= 2) {
+		rx = (x & s) > 0;
+		ry = (y & s) > 0;
+		res += (uint_fast64_t)s * s * ((3 * rx) ^ ry);
+		if (ry == 0) {
+			if (rx == 1) {
+				x = n-1 - x;
+				y = n-1 - y;
+			}
+			tmp = x;
+			x = y;
+			y = tmp;
+		}
+	}
+
+	return res;
+}
+
+typedef struct s_FocusKey {
+	uint_fast32_t ring;
+	uint_fast64_t hilbertIndex;
+	uint_fast32_t index;
+} FocusKey;
+
+static int CompareFocusKeys(const void *a, const void *b)
+{
+	const FocusKey *k1 = (const FocusKey *)a;
+	const FocusKey *k2 = (const FocusKey *)b;
+
+	if (k1->ring != k2->ring) {
+		return (k1->ring < k2->ring) ? -1 : 1;
+	} else if (k1->hilbertIndex != k2->hilbertIndex) {
+		return (k1->hilbertIndex < k2->hilbertIndex) ? -1 : 1;
+	} else {
+		return 0;
+	}
+}
+
+static inline uint_fast32_t uiAbsDiff(uint_fast32_t a, uint_fast32_t b)
+{
+	return (a > b) ? a-b : b-a;
+}
+
+void CutUIRectangleMaxSizeFocus(UIRectangle src, uint_fast32_t size, uint_fast32_t focusX,
+				uint_fast32_t focusY, UIRectangle **out, uint_fast32_t *out_size)
+{
+	UIRectangle *rectangles;
+	uint_fast32_t nbRectangles;
+	CutUIRectangleMaxSize(src, size, &rectangles, &nbRectangles);
+
+	uint_fast32_t nb_x = (src.x2 - src.x1) / size + 1;
+	uint_fast32_t nb_y = (src.y2 - src.y1) / size + 1;
+	uint_fast32_t n = 1;
+	while (n < nb_x || n < nb_y) {
+		n *= 2;
+	}
+
+	focusX = (focusX < src.x1) ? src.x1 : (focusX > src.x2) ? src.x2 : focusX;
+	focusY = (focusY < src.y1) ? src.y1 : (focusY > src.y2) ? src.y2 : focusY;
+	uint_fast32_t focusI = (focusX - src.x1) / size;
+	uint_fast32_t focusJ = (focusY - src.y1) / size;
+
+	FocusKey *key = (FocusKey *)safeMalloc("focus keys", nbRectangles * sizeof(FocusKey));
+	uint_fast32_t i, j, dist;
+	for (uint_fast32_t k = 0; k < nbRectangles; ++k) {
+		i = (rectangles[k].x1 - src.x1) / size;
+		j = (rectangles[k].y1 - src.y1) / size;
+		dist = uiAbsDiff(i, focusI);
+		if (uiAbsDiff(j, focusJ) > dist) {
+			dist = uiAbsDiff(j, focusJ);
+		}
+		key[k].ring = dist / FOCUS_RING_WIDTH;
+		key[k].hilbertIndex = HilbertIndex(n, i, j);
+		key[k].index = k;
+	}
+	qsort(key, nbRectangles, sizeof(FocusKey), CompareFocusKeys);
+
+	*out_size = nbRectangles;
+	*out = (UIRectangle *)safeMalloc("rectangles", nbRectangles * sizeof(UIRectangle));
+	for (uint_fast32_t k = 0; k < nbRectangles; ++k) {
+		(*out)[k] = rectangles[key[k].index];
+	}
+
+	free(key);
+	free(rectangles);
+}
+
+uint_fast32_t SubtractUIRectangle(UIRectangle rectangle, const UIRectangle *hole, UIRectangle *out)
+{
+	if (hole->x1 > rectangle.x2 || hole->x2 < rectangle.x1 ||
+		hole->y1 > rectangle.y2 || hole->y2 < rectangle.y1) {
+		out[0] = rectangle;
+		return 1;
+	}
+
+	uint_fast32_t res = 0;
+	/* Top and bottom strips take the whole width of rectangle,
+	 * left and right strips are between them.
+	 */
+	if (hole->y1 > rectangle.y1) {
+		InitUIRectangle(&out[res++], rectangle.x1, rectangle.y1, rectangle.x2, hole->y1-1);
+	}
+	if (hole->y2 < rectangle.y2) {
+		InitUIRectangle(&out[res++], rectangle.x1, hole->y2+1, rectangle.x2, rectangle.y2);
+	}
+	uint_fast32_t y1 = (hole->y1 > rectangle.y1) ? hole->y1 : rectangle.y1;
+	uint_fast32_t y2 = (hole->y2 < rectangle.y2) ? hole->y2 : rectangle.y2;
+	if (hole->x1 > rectangle.x1) {
+		InitUIRectangle(&out[res++], rectangle.x1, y1, hole->x1-1, y2);
+	}
+	if (hole->x2 < rectangle.x2) {
+		InitUIRectangle(&out[res++], hole->x2+1, y1, rectangle.x2, y2);
+	}
+
+	return res;
+}
+
 int CutUIRectangleInHalf(UIRectangle rectangle, UIRectangle *out1, UIRectangle *out2)
 {
 	uint_fast32_t width = rectangle.x2 - rectangle.x1;